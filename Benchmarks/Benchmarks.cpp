@@ -0,0 +1,211 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Semantics/Operations.h"
+#include "Syntaxes/SyntaxAnalyser.h"
+
+static size_t allocationsCount = 0;
+
+void* operator new(size_t size)
+{
+	++allocationsCount;
+	if (auto ptr = std::malloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+static void PrintResult(const std::string& name, long long ns, size_t allocations, size_t unitsCount, const std::string& unitName)
+{
+	std::cout << std::left << std::setw(24) << name
+		<< std::right << std::setw(10) << ns / 1000000 << " ms"
+		<< std::setw(10) << std::fixed << std::setprecision(1) << static_cast<double>(ns) / unitsCount << " ns/" << unitName
+		<< std::setw(10) << std::setprecision(2) << static_cast<double>(allocations) / unitsCount << " allocs/" << unitName
+		<< std::endl;
+}
+
+static void RunBenchmark(const std::string& name, const std::string& src, size_t unitsCount, const std::string& unitName,
+	ExecutionEngine engine = ExecutionEngine::Interpreter, size_t osrThreshold = 0)
+{
+	std::stringstream ss(src);
+	SyntaxAnalyser analyser(ss);
+	analyser.SetExecutionEngine(engine);
+	analyser.SetOsrThreshold(osrThreshold);
+
+	const auto startAllocations = allocationsCount;
+	const auto startTime = std::chrono::steady_clock::now();
+	analyser.Program();
+	const auto endTime = std::chrono::steady_clock::now();
+	const auto allocations = allocationsCount - startAllocations;
+
+	const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+	static const char* const suffixes[] = { "", " bytecode", " jit", " aot" };
+	const auto suffix = osrThreshold > 0 ? " osr" : suffixes[static_cast<int>(engine)];
+	PrintResult(name + suffix, ns, allocations, unitsCount, unitName);
+}
+
+// Every iteration evaluates an expression of 18 operands
+static void ExpressionBenchmark(int iterations, ExecutionEngine engine)
+{
+	std::stringstream src;
+	src << "int res; void main() { for (int i = 0; i < " << iterations << "; ++i) "
+		<< "res = 1 + 2 * 3 - 4 / 2 + (5 % 3) * 7 - -8 + i * (9 - 10) + 11 == 12 + 13 * 14 <= -15 + i; }";
+	RunBenchmark("Expression", src.str(), static_cast<size_t>(iterations) * 18, "operand", engine);
+}
+
+// Every iteration declares 64 variables in one scope, each one reads the first and the previous
+static void ScopeBenchmark(int iterations, ExecutionEngine engine)
+{
+	const int declarationsCount = 64;
+	std::stringstream src;
+	src << "void main() { for (int i = 0; i < " << iterations << "; ++i) { int v0 = i;";
+	for (int i = 1; i < declarationsCount; ++i)
+		src << " int v" << i << " = v0 + v" << i - 1 << ";";
+	src << " } }";
+	RunBenchmark("Scope", src.str(), static_cast<size_t>(iterations) * declarationsCount, "decl", engine);
+}
+
+// Every iteration runs a block without declarations and a block with one
+static void LoopBenchmark(int iterations, ExecutionEngine engine, size_t osrThreshold = 0)
+{
+	std::stringstream src;
+	src << "int res = 0; void main() { for (int i = 0; i < " << iterations << "; ++i) "
+		<< "{ { res = res + i; } { int t = i; res = res - t; } } }";
+	RunBenchmark("Loop", src.str(), static_cast<size_t>(iterations), "iter", engine, osrThreshold);
+}
+
+// Every iteration calls a function with two params and one local
+static void CallBenchmark(int iterations, ExecutionEngine engine)
+{
+	std::stringstream src;
+	src << "int res; void add(int a, int b) { int sum = a + b; res = sum; } "
+		<< "void main() { for (int i = 0; i < " << iterations << "; ++i) add(i, 1); }";
+	RunBenchmark("Call", src.str(), static_cast<size_t>(iterations), "call", engine);
+}
+
+// Stream that drops everything, so only formatting is measured
+class NullBuffer : public std::streambuf
+{
+protected:
+	int overflow(int c) override { return c; }
+	std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// Tree of global variables printed in every format
+static void PrintBenchmark(int declarationsCount)
+{
+	std::stringstream src;
+	for (int i = 0; i < declarationsCount; ++i)
+		src << "int v" << i << " = " << i << ";";
+	src << "void main() {}";
+	SyntaxAnalyser analyser(src);
+	analyser.Program();
+
+	NullBuffer nullBuffer;
+	std::ostream out(&nullBuffer);
+	const std::pair<const char*, TreeFormat> formats[] = {
+		{ "Print text", TreeFormat::Text }, { "Print json", TreeFormat::JsonLines }, { "Print binary", TreeFormat::Binary } };
+	for (const auto& format : formats)
+	{
+		const auto startAllocations = allocationsCount;
+		const auto startTime = std::chrono::steady_clock::now();
+		analyser.GetSemTree()->Print(out, format.second);
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+		PrintResult(format.first, ns, allocationsCount - startAllocations, declarationsCount, "node");
+	}
+}
+
+// Type and operator switches done on every evaluation, as operations were performed before kernels
+static DataValue SwitchOperation(DataValue leftValue, DataValue rightValue, LexemeType operation)
+{
+	if (rightValue.type != leftValue.type)
+		rightValue = leftValue.type == DataType::Long ? DataValue(static_cast<long long>(rightValue.intVal))
+			: DataValue(static_cast<int>(rightValue.longVal));
+
+	DataValue resValue;
+	if (leftValue.type == DataType::Long)
+		switch (operation) {
+		case LexemeType::Plus: resValue.longVal = leftValue.longVal + rightValue.longVal; break;
+		case LexemeType::Minus: resValue.longVal = leftValue.longVal - rightValue.longVal; break;
+		case LexemeType::Mul: resValue.longVal = leftValue.longVal * rightValue.longVal; break;
+		case LexemeType::Div: resValue.longVal = leftValue.longVal / rightValue.longVal; break;
+		case LexemeType::L: resValue.longVal = leftValue.longVal < rightValue.longVal; break;
+		default: resValue.longVal = leftValue.longVal == rightValue.longVal; break;
+		}
+	else
+		switch (operation) {
+		case LexemeType::Plus: resValue.intVal = leftValue.intVal + rightValue.intVal; break;
+		case LexemeType::Minus: resValue.intVal = leftValue.intVal - rightValue.intVal; break;
+		case LexemeType::Mul: resValue.intVal = leftValue.intVal * rightValue.intVal; break;
+		case LexemeType::Div: resValue.intVal = leftValue.intVal / rightValue.intVal; break;
+		case LexemeType::L: resValue.intVal = leftValue.intVal < rightValue.intVal; break;
+		default: resValue.intVal = leftValue.intVal == rightValue.intVal; break;
+		}
+	resValue.type = leftValue.type;
+	return resValue;
+}
+
+// Same mix of typed operations evaluated by the switches and by kernels selected beforehand
+static void KernelBenchmark(int rounds)
+{
+	const LexemeType operations[] = { LexemeType::Plus, LexemeType::Minus, LexemeType::Mul, LexemeType::Div, LexemeType::L, LexemeType::E };
+	const size_t operationsCount = 4096;
+	std::vector<DataValue> lefts, rights;
+	std::vector<LexemeType> ops;
+	std::vector<BinaryOperation> kernels;
+	for (size_t i = 0; i < operationsCount; ++i)
+	{
+		lefts.push_back(i % 3 == 0 ? DataValue(static_cast<long long>(i)) : DataValue(static_cast<int>(i)));
+		rights.push_back(i % 5 == 0 ? DataValue(static_cast<long long>(i % 7 + 1)) : DataValue(static_cast<int>(i % 7 + 1)));
+		ops.push_back(operations[i * 7 % 6]);
+		kernels.push_back(SelectBinaryOperation(lefts[i].type, rights[i].type, ops[i]));
+	}
+
+	long long checksum = 0;
+	auto startTime = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round)
+		for (size_t i = 0; i < operationsCount; ++i)
+			checksum += SwitchOperation(lefts[i], rights[i], ops[i]).intVal;
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	PrintResult("Switch", ns, 0, operationsCount * rounds, "op");
+
+	startTime = std::chrono::steady_clock::now();
+	for (int round = 0; round < rounds; ++round)
+		for (size_t i = 0; i < operationsCount; ++i)
+			checksum -= kernels[i](lefts[i], rights[i]).intVal;
+	ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	PrintResult("Kernel", ns, 0, operationsCount * rounds, "op");
+
+	if (checksum != 0)
+		std::cout << "Kernels and switches disagree" << std::endl;
+}
+
+int main()
+{
+	for (const auto engine : { ExecutionEngine::Interpreter, ExecutionEngine::Bytecode, ExecutionEngine::Jit, ExecutionEngine::Aot })
+	{
+		ExpressionBenchmark(100000, engine);
+		ScopeBenchmark(20000, engine);
+		LoopBenchmark(100000, engine);
+		CallBenchmark(100000, engine);
+	}
+	LoopBenchmark(100000, ExecutionEngine::Interpreter, SyntaxAnalyser::DEFAULT_OSR_THRESHOLD);
+	KernelBenchmark(2000);
+	PrintBenchmark(200000);
+	return 0;
+}
@@ -0,0 +1,246 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "AotMachine.h"
+#include "CTranslator.h"
+#include "Cache/BinaryFile.h"
+#include "Cache/ProgramCache.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDirectory(path) _mkdir(path)
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define MakeDirectory(path) mkdir(path, 0700)
+#endif
+
+namespace
+{
+	// Layout of struct lexan_context
+	struct AotContext
+	{
+		int64_t maxDepth;
+		uint64_t stackLimit;
+		int64_t depth;
+		int64_t errorPosition;
+		int64_t errorIndex;
+		int64_t errorDepth;
+	};
+
+	// Builds the library with the compiler from the CC variable or the one of the system, output is dropped
+#ifdef _WIN32
+	bool RunCompiler(const std::string& sourcePath, const std::string& libraryPath)
+	{
+		// The command goes through cmd, so the quoted paths must hold nothing it would interpret
+		const auto isQuotable = [](const std::string& path) { return path.find_first_of("\"%^&|<>!") == std::string::npos; };
+		if (!isQuotable(sourcePath) || !isQuotable(libraryPath))
+			return false;
+
+		const auto compiler = std::getenv("CC");
+		std::stringstream command;
+		command << (compiler != nullptr ? compiler : "cl") << " /nologo /O2 /LD /w \"" << sourcePath
+			<< "\" /Fe\"" << libraryPath << "\" /Fo\"" << libraryPath << ".obj\" >nul 2>&1";
+		return std::system(command.str().c_str()) == 0;
+	}
+#else
+	bool RunCompiler(const std::string& sourcePath, const std::string& libraryPath)
+	{
+		// The compiler is run without a shell, so nothing in the paths is interpreted.
+		// CC may name a launcher and flags too, its words are split on blanks
+		const auto compiler = std::getenv("CC");
+		std::istringstream words(compiler != nullptr ? compiler : "");
+		std::vector<std::string> args;
+		for (std::string word; words >> word;)
+			args.push_back(word);
+		if (args.empty())
+			args.push_back("cc");
+		for (const auto flag : { "-O2", "-shared", "-fPIC", "-w", "-o" })
+			args.push_back(flag);
+		args.push_back(libraryPath);
+		args.push_back(sourcePath[0] == '-' ? "./" + sourcePath : sourcePath);	// Not an option
+
+		std::vector<char*> argv;
+		for (auto& arg : args)
+			argv.push_back(&arg[0]);
+		argv.push_back(nullptr);
+
+		const auto pid = fork();
+		if (pid < 0)
+			return false;
+		if (pid == 0)
+		{
+			const auto null = open("/dev/null", O_WRONLY);
+			if (null >= 0)
+			{
+				dup2(null, STDOUT_FILENO);
+				dup2(null, STDERR_FILENO);
+			}
+			execvp(argv[0], argv.data());
+			_exit(127);
+		}
+
+		int status;
+		while (waitpid(pid, &status, 0) < 0)
+			if (errno != EINTR)
+				return false;
+		return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+#endif
+
+	// Creates the directory and its missing parents. Libraries in it are loaded into the process,
+	// so it must belong to the user and nobody else may access it; the profile of the user on
+	// Windows is private already
+	bool MakePrivateDirectory(const std::string& directory)
+	{
+		for (auto slash = directory.find('/', 1); slash != std::string::npos; slash = directory.find('/', slash + 1))
+			MakeDirectory(directory.substr(0, slash).c_str());
+		MakeDirectory(directory.c_str());
+#ifdef _WIN32
+		return true;
+#else
+		struct stat status;
+		return lstat(directory.c_str(), &status) == 0 && S_ISDIR(status.st_mode) && status.st_uid == geteuid()
+			&& (status.st_mode & 077) == 0;
+#endif
+	}
+}
+
+AotMachine::AotMachine(const BytecodeProgram& program, size_t maxCallDepth, std::uintptr_t stackLimit)
+	: program(program), maxCallDepth(maxCallDepth), stackLimit(stackLimit)
+{}
+
+std::string AotMachine::GetDefaultDirectory()
+{
+#ifdef _WIN32
+	const auto temp = std::getenv("TEMP");
+	return std::string(temp != nullptr ? temp : ".") + "/lexan-aot";
+#else
+	const auto cache = std::getenv("XDG_CACHE_HOME");
+	if (cache != nullptr && *cache == '/')
+		return std::string(cache) + "/lexan-aot";
+	const auto home = std::getenv("HOME");
+	if (home != nullptr && *home == '/')
+		return std::string(home) + "/.cache/lexan-aot";
+	const auto temp = std::getenv("TMPDIR");
+	return std::string(temp != nullptr ? temp : "/tmp") + "/lexan-aot-" + std::to_string(geteuid());
+#endif
+}
+
+bool AotMachine::Compile(const std::string& directory)
+{
+	if (!MakePrivateDirectory(directory))
+		return false;
+
+	const auto source = CTranslator(program).Translate();
+	std::stringstream path;
+	path << directory << '/' << std::hex;
+	path.width(16);
+	path.fill('0');
+	path << ProgramCache::HashSource(source);
+	libraryPath = path.str() + SharedLibrary::EXTENSION;
+	sourcePath = path.str() + ".c";
+
+	// The hash only names the files, a library is loaded when it was built from the same source
+	isCached = IsBuiltFrom(source) && Load();
+	if (isCached)
+		return true;
+	return Build(source) && Load();
+}
+
+bool AotMachine::IsBuiltFrom(const std::string& source) const
+{
+	std::ifstream in(sourcePath, std::ios::binary);
+	if (!in)
+		return false;
+	std::stringstream builtSource;
+	builtSource << in.rdbuf();
+	return builtSource.str() == source;
+}
+
+bool AotMachine::Build(const std::string& source) const
+{
+	const auto tmpPath = GetTempPath(libraryPath);
+	const auto tmpSourcePath = tmpPath + ".c";
+	{
+		std::ofstream out(tmpSourcePath, std::ios::binary | std::ios::trunc);
+		if (!(out << source))
+			return false;
+	}
+	const auto isBuilt = RunCompiler(tmpSourcePath, tmpPath);
+	std::remove((tmpPath + ".obj").c_str());
+	if (!isBuilt)
+	{
+		std::remove(tmpSourcePath.c_str());
+		std::remove(tmpPath.c_str());
+		return false;
+	}
+	// Both appear atomically, the source after the library it was built into
+	ReplaceFile(tmpPath, libraryPath);
+	ReplaceFile(tmpSourcePath, sourcePath);
+	return true;
+}
+
+bool AotMachine::Load()
+{
+	if (!library.Load(libraryPath))
+		return false;
+
+	const auto version = static_cast<const int*>(library.GetSymbol("lexan_abi_version"));
+	const auto size = static_cast<const size_t*>(library.GetSymbol("lexan_globals_size"));
+	const auto assigned = static_cast<const size_t*>(library.GetSymbol("lexan_assigned_offset"));
+	offsets = static_cast<const size_t*>(library.GetSymbol("lexan_global_offsets"));
+	entry = reinterpret_cast<int(*)(void*, void*)>(library.GetSymbol("lexan_run"));
+	if (version == nullptr || *version != CTranslator::ABI_VERSION || size == nullptr || assigned == nullptr
+		|| offsets == nullptr || entry == nullptr)
+		return false;
+
+	assignedOffset = *assigned;
+	globals.assign((*size + sizeof(int64_t) - 1) / sizeof(int64_t), 0);
+	return true;
+}
+
+void AotMachine::Run()
+{
+	AotContext context{ static_cast<int64_t>(maxCallDepth), stackLimit, 0, 0, 0, 0 };
+	const auto error = static_cast<NativeError>(entry(globals.data(), &context));
+	if (error == NativeError::None)
+		return;
+
+	errorPosition = static_cast<size_t>(context.errorPosition);
+	ThrowNativeError(program, error, static_cast<uint64_t>(context.errorIndex), static_cast<uint64_t>(context.errorDepth));
+}
+
+DataValue AotMachine::GetGlobal(size_t index) const
+{
+	const auto field = reinterpret_cast<const char*>(globals.data()) + offsets[index];
+	if (program.Globals[index].Type == DataType::Long)
+		return DataValue(ReadRecord<long long>(field, 0));
+	return DataValue(ReadRecord<int32_t>(field, 0));
+}
+
+void AotMachine::SetGlobal(size_t index, DataValue value)
+{
+	const auto field = reinterpret_cast<char*>(globals.data()) + offsets[index];
+	if (program.Globals[index].Type == DataType::Long)
+	{
+		const auto longVal = value.type == DataType::Long ? value.longVal : static_cast<long long>(value.intVal);
+		std::memcpy(field, &longVal, sizeof(longVal));
+	}
+	else
+	{
+		const auto intVal = value.type == DataType::Long ? static_cast<int32_t>(value.longVal) : value.intVal;
+		std::memcpy(field, &intVal, sizeof(intVal));
+	}
+	reinterpret_cast<char*>(globals.data())[assignedOffset + index] = 1;
+}
+
+bool AotMachine::IsGlobalAssigned(size_t index) const
+{
+	return reinterpret_cast<const char*>(globals.data())[assignedOffset + index] != 0;
+}
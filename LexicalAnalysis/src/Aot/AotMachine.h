@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SharedLibrary.h"
+#include "Bytecode/Bytecode.h"
+#include "Semantics/Node/DataValue.h"
+
+// Runs a bytecode program translated to C and built by the system compiler into a library.
+// Libraries are kept with their source in a directory only the user may access, named by the
+// hash of the source, so a program that was run before is loaded without building it once its
+// stored source matches. Globals live in the struct the library exports.
+class AotMachine
+{
+public:
+	// stackLimit is the lowest address calls may take the native stack to, 0 if it is unknown
+	AotMachine(const BytecodeProgram& program, size_t maxCallDepth, std::uintptr_t stackLimit);
+
+	// False if the library can be neither loaded nor built, or others may access the directory
+	bool Compile(const std::string& directory);
+	void Run();
+
+	DataValue GetGlobal(size_t index) const;
+	void SetGlobal(size_t index, DataValue value);
+	bool IsGlobalAssigned(size_t index) const;
+
+	size_t GetErrorPosition() const { return errorPosition; }
+	bool IsCached() const { return isCached; }
+	const std::string& GetLibraryPath() const { return libraryPath; }
+	const std::string& GetSourcePath() const { return sourcePath; }
+
+	// Cache directory of the user
+	static std::string GetDefaultDirectory();
+
+private:
+	bool IsBuiltFrom(const std::string& source) const;
+	bool Build(const std::string& source) const;
+	bool Load();
+
+	const BytecodeProgram& program;
+	size_t maxCallDepth;
+	std::uintptr_t stackLimit;
+
+	SharedLibrary library;
+	std::string libraryPath, sourcePath;
+	bool isCached = false;
+
+	int (*entry)(void* globals, void* context) = nullptr;
+	const size_t* offsets = nullptr;						// Field of every global in the struct
+	size_t assignedOffset = 0;
+	std::vector<int64_t> globals;							// Storage of the struct
+	size_t errorPosition = 0;
+};
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <cstdint>
+#include "CTranslator.h"
+#include "Semantics/Operations.h"
+
+namespace
+{
+	const char* const PRELUDE = R"(/* Generated from bytecode, do not edit */
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define LEXAN_EXPORT __declspec(dllexport)
+#else
+#define LEXAN_EXPORT __attribute__((visibility("default")))
+#endif
+
+struct lexan_context
+{
+	int64_t max_depth;
+	uint64_t stack_limit;
+	int64_t depth;
+	int64_t error_position;
+	int64_t error_index;
+	int64_t error_depth;
+};
+
+)";
+
+	const char* GetOperator(BinaryOpCode operation)
+	{
+		static const char* const operators[] = { "+", "-", "*", "/", "%", "==", "!=", ">", "<", "<=", ">=" };
+		return operators[static_cast<int>(operation)];
+	}
+
+	std::string Stack(int depth)
+	{
+		return "s" + std::to_string(depth);
+	}
+
+	std::string Constant(int64_t value)
+	{
+		return value == INT64_MIN ? "INT64_MIN" : "INT64_C(" + std::to_string(value) + ")";
+	}
+}
+
+CTranslator::CTranslator(const BytecodeProgram& program)
+	: program(program)
+{}
+
+std::string CTranslator::GetGlobalField(size_t index) const
+{
+	return "g" + std::to_string(index) + "_" + program.Globals[index].Id;
+}
+
+std::string CTranslator::Translate()
+{
+	out.str("");
+	out << PRELUDE;
+
+	const auto& globals = program.Globals;
+	out << "struct lexan_globals\n{\n";
+	for (size_t i = 0; i < globals.size(); i++)
+		out << '\t' << (globals[i].Type == DataType::Long ? "int64_t " : "int32_t ") << GetGlobalField(i) << ";\n";
+	out << "\tunsigned char assigned[" << std::max<size_t>(globals.size(), 1) << "];\n};\n\n";
+
+	out << "LEXAN_EXPORT const int lexan_abi_version = " << ABI_VERSION << ";\n"
+		<< "LEXAN_EXPORT const size_t lexan_globals_size = sizeof(struct lexan_globals);\n"
+		<< "LEXAN_EXPORT const size_t lexan_assigned_offset = offsetof(struct lexan_globals, assigned);\n"
+		<< "LEXAN_EXPORT const size_t lexan_global_offsets[] = { ";
+	for (size_t i = 0; i < globals.size(); i++)
+		out << "offsetof(struct lexan_globals, " << GetGlobalField(i) << "), ";
+	out << "0 };\n\n";
+
+	out << "static int lexan_fail(struct lexan_context* ctx, int error, int64_t index, int64_t position, int64_t depth)\n"
+		<< "{\n\tctx->error_index = index;\n\tctx->error_position = position;\n\tctx->error_depth = depth;\n\treturn error;\n}\n\n";
+
+	const auto declare = [this](size_t index)
+	{
+		out << "static int f" << index << "(struct lexan_context* ctx, struct lexan_globals* g";
+		for (size_t i = 0; i < program.Functions[index].ParamsCount; i++)
+			out << ", int64_t a" << i;
+		out << ')';
+	};
+	for (size_t i = 0; i < program.Functions.size(); i++)
+	{
+		declare(i);
+		out << ";\t/* " << program.Functions[i].Id << " */\n";
+	}
+	for (size_t i = 0; i < program.Functions.size(); i++)
+	{
+		out << '\n';
+		declare(i);
+		out << "\n{\n";
+		TranslateFunction(i);
+		out << "}\n";
+	}
+
+	out << "\nLEXAN_EXPORT int lexan_run(struct lexan_globals* g, struct lexan_context* ctx)\n{\n\treturn f0(ctx, g);\n}\n";
+	return out.str();
+}
+
+void CTranslator::Fail(NativeError error, uint64_t index, size_t position, const char* depth)
+{
+	out << "return lexan_fail(ctx, " << static_cast<int>(error) << ", " << index << ", " << position << ", " << depth << ");";
+}
+
+void CTranslator::TranslateFunction(size_t index)
+{
+	const auto& function = program.Functions[index];
+	const auto& code = function.Code;
+	const auto depths = GetStackDepths(program, function);
+
+	std::vector<bool> isTarget(code.size()), isChecked(function.LocalsCount);
+	auto hasCalls = false;
+	for (const auto& instr : code)
+	{
+		if (instr.Op == OpCode::Jump || instr.Op == OpCode::JumpIfZero || instr.Op == OpCode::JumpIfNotZero)
+			isTarget[instr.A] = true;
+		else if (instr.Op == OpCode::ClearLocal)
+			isChecked[instr.A] = true;
+		hasCalls = hasCalls || instr.Op == OpCode::Call;
+	}
+
+	for (size_t i = 0; i < function.LocalsCount; i++)
+	{
+		out << "\tint64_t l" << i << " = " << (i < function.ParamsCount ? "a" + std::to_string(i) : "0") << ";\n";
+		if (isChecked[i])
+			out << "\tunsigned char c" << i << " = 0;\n";
+	}
+	const auto maxDepth = *std::max_element(depths.begin(), depths.end());
+	for (int i = 0; i <= maxDepth; i++)
+		out << "\tint64_t " << Stack(i) << ";\n";
+	if (hasCalls)
+		out << "\tint r;\n\tchar probe;\t/* Address on the native stack */\n";
+
+	for (size_t ip = 0; ip < code.size(); ip++)
+	{
+		if (isTarget[ip])
+			out << "L" << ip << ":;\n";
+		const auto depth = depths[ip];
+		if (depth < 0)
+			continue;
+
+		const auto& instr = code[ip];
+		const auto position = function.Positions[ip];
+		const auto top = Stack(depth - 1), next = Stack(depth);
+		out << '\t';
+		switch (instr.Op)
+		{
+		case OpCode::Const:
+			out << next << " = " << Constant(instr.B) << ';';
+			break;
+		case OpCode::LoadLocalChecked:
+			out << "if (!c" << instr.A << ") ";
+			Fail(NativeError::Program, static_cast<uint64_t>(instr.B), position);
+			out << "\n\t";
+			// fallthrough
+		case OpCode::LoadLocal:
+			out << next << " = l" << instr.A << ';';
+			break;
+		case OpCode::StoreLocal:
+			out << 'l' << instr.A << " = " << top << ';';
+			if (isChecked[instr.A])
+				out << " c" << instr.A << " = 1;";
+			break;
+		case OpCode::ClearLocal:
+			out << 'c' << instr.A << " = 0;";
+			break;
+		case OpCode::LoadGlobalChecked:
+			out << "if (!g->assigned[" << instr.A << "]) ";
+			Fail(NativeError::Program, static_cast<uint64_t>(instr.B), position);
+			out << "\n\t";
+			// fallthrough
+		case OpCode::LoadGlobal:
+			out << next << " = g->" << GetGlobalField(instr.A) << ';';
+			break;
+		case OpCode::StoreGlobal:
+			out << "g->" << GetGlobalField(instr.A) << " = "
+				<< (program.Globals[instr.A].Type == DataType::Long ? "" : "(int32_t)") << top << ';'
+				<< " g->assigned[" << instr.A << "] = 1;";
+			break;
+		case OpCode::Dup:
+			out << next << " = " << top << ';';
+			break;
+		case OpCode::Pop:
+			out << "/* pop */";
+			break;
+		case OpCode::ToInt:
+			out << top << " = (int32_t)" << top << ';';
+			break;
+		case OpCode::MinusInt:
+			out << top << " = (int32_t)(0u - (uint32_t)" << top << ");";
+			break;
+		case OpCode::IncInt:
+			out << top << " = (int32_t)((uint32_t)" << top << " + 1u);";
+			break;
+		case OpCode::DecInt:
+			out << top << " = (int32_t)((uint32_t)" << top << " - 1u);";
+			break;
+		case OpCode::MinusLong:
+			out << top << " = (int64_t)(0u - (uint64_t)" << top << ");";
+			break;
+		case OpCode::IncLong:
+			out << top << " = (int64_t)((uint64_t)" << top << " + 1u);";
+			break;
+		case OpCode::DecLong:
+			out << top << " = (int64_t)((uint64_t)" << top << " - 1u);";
+			break;
+		case OpCode::Jump:
+			out << "goto L" << instr.A << ';';
+			break;
+		case OpCode::JumpIfZero:
+			out << "if (" << top << " == 0) goto L" << instr.A << ';';
+			break;
+		case OpCode::JumpIfNotZero:
+			out << "if (" << top << " != 0) goto L" << instr.A << ';';
+			break;
+		case OpCode::Call:
+		{
+			const auto paramsCount = static_cast<int>(program.Functions[instr.A].ParamsCount);
+			out << "if (ctx->depth >= ctx->max_depth || (uintptr_t)&probe < ctx->stack_limit) ";
+			Fail(NativeError::StackOverflow, instr.A, position, "ctx->depth + 1");
+			out << "\n\tctx->depth++;\n\tr = f" << instr.A << "(ctx, g";
+			for (int i = depth - paramsCount; i < depth; i++)
+				out << ", " << Stack(i);
+			out << ");\n\tctx->depth--;\n\tif (r != 0) return r;";
+			break;
+		}
+		case OpCode::Return:
+			out << "return 0;";
+			break;
+		case OpCode::Fail:
+			Fail(NativeError::Program, instr.A, position);
+			break;
+		default:
+			TranslateBinary(instr.Op, depth, position);
+			break;
+		}
+		out << '\n';
+	}
+}
+
+void CTranslator::TranslateBinary(OpCode code, int depth, size_t position)
+{
+	const auto isLong = code >= OpCode::AddLong;
+	const auto first = isLong ? OpCode::AddLong : OpCode::AddInt;
+	const auto operation = static_cast<BinaryOpCode>(static_cast<int>(code) - static_cast<int>(first));
+	const auto left = Stack(depth - 2), right = Stack(depth - 1);
+	const std::string type = isLong ? "int64_t" : "int32_t", unsignedType = isLong ? "uint64_t" : "uint32_t";
+
+	switch (operation)
+	{
+	case BinaryOpCode::Add:
+	case BinaryOpCode::Sub:
+	case BinaryOpCode::Mul:
+		out << left << " = (" << type << ")((" << unsignedType << ')' << left << ' ' << GetOperator(operation)
+			<< " (" << unsignedType << ')' << right << ");";
+		break;
+	case BinaryOpCode::Div:
+	case BinaryOpCode::Modul:
+		out << "if (" << right << " == 0) ";
+		Fail(NativeError::DivisionOnZero, 0, position);
+		out << "\n\t" << left << " = (" << type << ')' << left << ' ' << GetOperator(operation)
+			<< " (" << type << ')' << right << ';';
+		break;
+	default:
+		out << left << " = " << left << ' ' << GetOperator(operation) << ' ' << right << ';';
+		break;
+	}
+}
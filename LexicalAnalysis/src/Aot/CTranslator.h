@@ -0,0 +1,35 @@
+#pragma once
+#include <sstream>
+#include <string>
+
+#include "Bytecode/Bytecode.h"
+
+// Lowers a bytecode program to a C translation unit.
+// Operands of every function become C locals named by their stack depth and jumps become
+// gotos, so the C compiler sees plain scalar code. Int operations wrap through unsigned
+// arithmetic as the kernels do, and a division checks its divisor first.
+// Errors are returned up the call chain, never thrown. The unit exports:
+//   struct lexan_globals            a field for every global and their assigned flags
+//   lexan_run(globals, context)     runs the first function, returns a NativeError
+//   lexan_global_offsets[]          offset of every field, for the loader
+//   lexan_assigned_offset, lexan_globals_size, lexan_abi_version
+class CTranslator
+{
+public:
+	explicit CTranslator(const BytecodeProgram& program);
+
+	std::string Translate();
+
+	// Changes whenever the exported layout does
+	static const int ABI_VERSION = 1;
+
+private:
+	void TranslateFunction(size_t index);
+	void TranslateBinary(OpCode code, int depth, size_t position);
+	void Fail(NativeError error, uint64_t index, size_t position, const char* depth = "0");
+
+	std::string GetGlobalField(size_t index) const;
+
+	const BytecodeProgram& program;
+	std::ostringstream out;
+};
@@ -0,0 +1,43 @@
+#include "SharedLibrary.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+const char* const SharedLibrary::EXTENSION = ".dll";
+#else
+#include <dlfcn.h>
+const char* const SharedLibrary::EXTENSION = ".so";
+#endif
+
+SharedLibrary::~SharedLibrary()
+{
+	if (handle == nullptr)
+		return;
+#ifdef _WIN32
+	FreeLibrary(static_cast<HMODULE>(handle));
+#else
+	dlclose(handle);
+#endif
+}
+
+bool SharedLibrary::Load(const std::string& path)
+{
+#ifdef _WIN32
+	handle = LoadLibraryA(path.c_str());
+#else
+	handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+	return handle != nullptr;
+}
+
+void* SharedLibrary::GetSymbol(const std::string& name) const
+{
+	if (handle == nullptr)
+		return nullptr;
+#ifdef _WIN32
+	return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name.c_str()));
+#else
+	return dlsym(handle, name.c_str());
+#endif
+}
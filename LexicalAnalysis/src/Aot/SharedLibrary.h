@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+// Library loaded into the process, unloaded with the object
+class SharedLibrary
+{
+public:
+	SharedLibrary() = default;
+	SharedLibrary(const SharedLibrary&) = delete;
+	SharedLibrary& operator=(const SharedLibrary&) = delete;
+	~SharedLibrary();
+
+	bool Load(const std::string& path);
+	void* GetSymbol(const std::string& name) const;
+
+	static const char* const EXTENSION;
+
+private:
+	void* handle = nullptr;
+};
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include "Bytecode.h"
+#include "Exceptions/AnalysisExceptions.h"
+
+namespace
+{
+	// Longest path of edges from each function, UNBOUNDED_CALLS if it reaches a cycle
+	class LongestPaths
+	{
+	public:
+		explicit LongestPaths(const std::vector<std::vector<size_t>>& edges)
+			: edges(edges), lengths(edges.size()), states(edges.size())
+		{
+			for (size_t i = 0; i < edges.size(); i++)
+				Visit(i);
+		}
+
+		std::vector<size_t> GetLengths() { return std::move(lengths); }
+
+	private:
+		enum State { New, Visiting, Visited };
+
+		size_t Visit(size_t i)
+		{
+			if (states[i] == Visiting)
+				return UNBOUNDED_CALLS;
+			if (states[i] == New)
+			{
+				states[i] = Visiting;
+				size_t length = 0;
+				for (const auto next : edges[i])
+				{
+					const auto nextLength = Visit(next);
+					length = nextLength == UNBOUNDED_CALLS || length == UNBOUNDED_CALLS
+						? UNBOUNDED_CALLS : std::max(length, nextLength + 1);
+				}
+				lengths[i] = length;
+				states[i] = Visited;
+			}
+			return lengths[i];
+		}
+
+		const std::vector<std::vector<size_t>>& edges;
+		std::vector<size_t> lengths;
+		std::vector<State> states;
+	};
+
+	std::vector<std::vector<size_t>> GetCallEdges(const BytecodeProgram& program, bool isToCallers)
+	{
+		std::vector<std::vector<size_t>> edges(program.Functions.size());
+		for (size_t i = 0; i < program.Functions.size(); i++)
+			for (const auto& instr : program.Functions[i].Code)
+				if (instr.Op == OpCode::Call)
+				{
+					if (isToCallers)
+						edges[instr.A].push_back(i);
+					else
+						edges[i].push_back(instr.A);
+				}
+		return edges;
+	}
+}
+
+const char* GetOpCodeName(OpCode code)
+{
+	static const char* const names[] = {
+#define BYTECODE_NAME(name) #name,
+		BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+	};
+	return code < OpCode::Count ? names[static_cast<size_t>(code)] : "Unknown";
+}
+
+std::vector<int> GetStackDepths(const BytecodeProgram& program, const BytecodeFunction& function)
+{
+	const auto& code = function.Code;
+	std::vector<int> depths(code.size(), -1);
+	std::vector<size_t> pending{ 0 };
+	depths[0] = 0;
+
+	const auto reach = [&](size_t ip, int depth)
+	{
+		if (ip < code.size() && depths[ip] < 0)
+		{
+			depths[ip] = depth;
+			pending.push_back(ip);
+		}
+	};
+	while (!pending.empty())
+	{
+		const auto ip = pending.back();
+		pending.pop_back();
+		const auto& instr = code[ip];
+		auto depth = depths[ip];
+
+		switch (instr.Op)
+		{
+		case OpCode::Return: case OpCode::Fail:
+			continue;
+		case OpCode::Jump:
+			reach(instr.A, depth);
+			continue;
+		case OpCode::JumpIfZero: case OpCode::JumpIfNotZero:
+			reach(instr.A, depth - 1);
+			reach(ip + 1, depth - 1);
+			continue;
+		case OpCode::Call:
+			depth -= static_cast<int>(program.Functions[instr.A].ParamsCount);
+			break;
+		case OpCode::Const: case OpCode::LoadLocal: case OpCode::LoadLocalChecked:
+		case OpCode::LoadGlobal: case OpCode::LoadGlobalChecked: case OpCode::Dup:
+			depth++;
+			break;
+		case OpCode::StoreLocal: case OpCode::StoreGlobal: case OpCode::Pop:
+			depth--;
+			break;
+		default:
+			if (instr.Op >= OpCode::AddInt && instr.Op <= OpCode::GreaterEqualLong)
+				depth--;
+			break;
+		}
+		reach(ip + 1, depth);
+	}
+	return depths;
+}
+
+std::vector<size_t> GetCallHeights(const BytecodeProgram& program)
+{
+	return LongestPaths(GetCallEdges(program, false)).GetLengths();
+}
+
+std::vector<size_t> GetCallDepths(const BytecodeProgram& program)
+{
+	return LongestPaths(GetCallEdges(program, true)).GetLengths();
+}
+
+void RemoveUncalledFunctions(BytecodeProgram& program)
+{
+	auto& functions = program.Functions;
+	std::vector<bool> isCalled(functions.size());
+	std::vector<size_t> pending{ 0 };
+	isCalled[0] = true;
+	while (!pending.empty())
+	{
+		const auto index = pending.back();
+		pending.pop_back();
+		for (const auto& instr : functions[index].Code)
+			if (instr.Op == OpCode::Call && !isCalled[instr.A])
+			{
+				isCalled[instr.A] = true;
+				pending.push_back(instr.A);
+			}
+	}
+
+	std::vector<uint32_t> newIndices(functions.size());
+	size_t count = 0;
+	for (size_t i = 0; i < functions.size(); i++)
+		if (isCalled[i])
+		{
+			newIndices[i] = static_cast<uint32_t>(count);
+			if (count != i)
+				functions[count] = std::move(functions[i]);
+			count++;
+		}
+	functions.resize(count);
+
+	for (auto& function : functions)
+		for (auto& instr : function.Code)
+			if (instr.Op == OpCode::Call)
+				instr.A = newIndices[instr.A];
+}
+
+void ThrowNativeError(const BytecodeProgram& program, NativeError error, uint64_t index, uint64_t depth)
+{
+	switch (error)
+	{
+	case NativeError::DivisionOnZero:
+		throw DivisionOnZeroException();
+	case NativeError::StackOverflow:
+		throw StackOverflowException(program.Functions[index].Id, static_cast<size_t>(depth));
+	default:
+		std::rethrow_exception(program.Errors[index]);
+	}
+}
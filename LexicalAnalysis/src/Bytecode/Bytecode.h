@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "Semantics/SymbolTable.h"
+#include "Types/DataType.h"
+
+// Code of the stack machine the analysed functions are compiled to.
+// Values are 64-bit; an int is kept sign-extended, so widening it costs nothing and only
+// narrowing to int needs an instruction. Operations are typed by the compiler and check no tags.
+// A is a slot, a function, a jump target or an error; B is a constant or an error.
+#define BYTECODE_OPCODES(X)																\
+	X(Const)					/* push B */											\
+	X(LoadLocal)				/* push slot A of the frame */							\
+	X(LoadLocalChecked)			/* same, error B if the slot is not assigned */			\
+	X(StoreLocal)				/* pop into slot A */									\
+	X(ClearLocal)				/* slot A is declared again without a value */			\
+	X(LoadGlobal)				/* push global A */										\
+	X(LoadGlobalChecked)		/* same, error B if the global is not assigned */		\
+	X(StoreGlobal)				/* pop into global A */									\
+	X(Dup)																				\
+	X(Pop)																				\
+	X(ToInt)					/* truncate the top to int */							\
+	X(AddInt) X(SubInt) X(MulInt) X(DivInt) X(ModulInt)									\
+	X(EqualInt) X(NotEqualInt) X(GreaterInt) X(LessInt) X(LessEqualInt) X(GreaterEqualInt)	\
+	X(AddLong) X(SubLong) X(MulLong) X(DivLong) X(ModulLong)							\
+	X(EqualLong) X(NotEqualLong) X(GreaterLong) X(LessLong) X(LessEqualLong) X(GreaterEqualLong)	\
+	X(MinusInt) X(IncInt) X(DecInt)														\
+	X(MinusLong) X(IncLong) X(DecLong)													\
+	X(Jump)						/* to A */												\
+	X(JumpIfZero)				/* pop, to A if zero */									\
+	X(JumpIfNotZero)			/* pop, to A if not zero */								\
+	X(Call)						/* function A, its params are on the top */				\
+	X(Return)																			\
+	X(Fail)						/* throw error A */
+
+enum class OpCode : uint8_t
+{
+#define BYTECODE_ENUM(name) name,
+	BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+	Count
+};
+
+const char* GetOpCodeName(OpCode code);
+
+struct Instruction
+{
+	OpCode Op;
+	uint32_t A;
+	int64_t B;
+};
+
+struct BytecodeFunction
+{
+	std::string Id;
+	const Node* FuncNode = nullptr;				// Function of the semantic tree, none for a loop
+	size_t ParamsCount = 0;
+	size_t LocalsCount = 0;						// Params are the first locals
+	size_t StackSize = 0;						// Deepest operand stack above the locals
+	std::vector<Instruction> Code;
+	std::vector<size_t> Positions;				// Scanner position of each instruction, for diagnostics
+};
+
+struct BytecodeGlobal
+{
+	std::string Id;
+	DataType Type;
+	Address Addr;								// Variable of the semantic tree the value comes from
+};
+
+struct BytecodeProgram
+{
+	std::vector<BytecodeFunction> Functions;	// The first one is run
+	std::vector<BytecodeGlobal> Globals;
+	std::vector<std::exception_ptr> Errors;		// Errors the interpreter finds only at run time
+};
+
+// Depth of the operand stack before each instruction, -1 if it is never reached
+std::vector<int> GetStackDepths(const BytecodeProgram& program, const BytecodeFunction& function);
+
+const size_t UNBOUNDED_CALLS = SIZE_MAX;
+
+// Longest chain of calls made below each function, UNBOUNDED_CALLS if it reaches recursion
+std::vector<size_t> GetCallHeights(const BytecodeProgram& program);
+// Deepest frame each function may run in, the first one runs in 0; UNBOUNDED_CALLS under recursion.
+// A call of callee from caller cannot overflow the stack if depths[caller] + heights[callee] < maxCallDepth.
+std::vector<size_t> GetCallDepths(const BytecodeProgram& program);
+// Functions the first one no longer reaches are removed, calls are renumbered
+void RemoveUncalledFunctions(BytecodeProgram& program);
+
+// Native code cannot throw through its frames, it returns one of these instead
+enum class NativeError : uint64_t
+{
+	None, Program, DivisionOnZero, StackOverflow
+};
+
+// Throws what the interpreter throws for the error; index is the error of the program
+// or the function whose call overflowed the stack
+[[noreturn]] void ThrowNativeError(const BytecodeProgram& program, NativeError error, uint64_t index, uint64_t depth);
@@ -0,0 +1,518 @@
+#include <algorithm>
+#include <array>
+#include "Compiler.h"
+#include "Exceptions/AnalysisExceptions.h"
+#include "Syntaxes/SyntaxAnalyser.h"
+
+namespace
+{
+	int GetStackEffect(OpCode code)
+	{
+		switch (code)
+		{
+		case OpCode::Const: case OpCode::LoadLocal: case OpCode::LoadLocalChecked:
+		case OpCode::LoadGlobal: case OpCode::LoadGlobalChecked: case OpCode::Dup:
+			return 1;
+		case OpCode::StoreLocal: case OpCode::StoreGlobal: case OpCode::Pop:
+		case OpCode::JumpIfZero: case OpCode::JumpIfNotZero:
+			return -1;
+		default:
+			return code >= OpCode::AddInt && code <= OpCode::GreaterEqualLong ? -1 : 0;
+		}
+	}
+
+	OpCode GetBinaryCode(DataType type, BinaryOpCode operation)
+	{
+		const auto first = type == DataType::Long ? OpCode::AddLong : OpCode::AddInt;
+		return static_cast<OpCode>(static_cast<int>(first) + static_cast<int>(operation));
+	}
+
+	OpCode GetPrefixCode(DataType type, PrefixOpCode operation)
+	{
+		const auto first = type == DataType::Long ? OpCode::MinusLong : OpCode::MinusInt;
+		return static_cast<OpCode>(static_cast<int>(first) + static_cast<int>(operation) - static_cast<int>(PrefixOpCode::Minus));
+	}
+}
+
+Compiler::Compiler(Scanner& scanner, SemanticTree& semTree)
+	: scanner(scanner), semTree(semTree)
+{}
+
+BytecodeProgram Compiler::Compile(const Node* funcNode)
+{
+	const auto savedPos = scanner.GetCurPos();
+	GetFunctionIndex(funcNode);
+	CompileCallees();
+	scanner.SetCurPos(savedPos);
+	return std::move(program);
+}
+
+BytecodeProgram Compiler::CompileLoop(size_t bodyPos, size_t stepPos, size_t condPos, const std::vector<bool>& assignedSlots)
+{
+	const auto savedPos = scanner.GetCurPos();
+	functionNodes.push_back(nullptr);						// The loop takes the place of the entry
+
+	function = BytecodeFunction();
+	function.Id = "for";
+	function.LocalsCount = assignedSlots.size();
+	checkedSlots.resize(assignedSlots.size());
+	std::transform(assignedSlots.begin(), assignedSlots.end(), checkedSlots.begin(), [](bool isAssigned) { return !isAssigned; });
+	stackDepth = 0;
+
+	scanner.SetCurPos(bodyPos);
+	Stat();
+	scanner.SetCurPos(stepPos);
+	Discard(AssignExpr());
+	scanner.SetCurPos(condPos);
+	Condition(OpCode::JumpIfNotZero, 0);
+	Emit(OpCode::Return);
+	program.Functions.push_back(std::move(function));
+
+	CompileCallees();
+	scanner.SetCurPos(savedPos);
+	return std::move(program);
+}
+
+void Compiler::CompileCallees()
+{
+	for (auto i = program.Functions.size(); i < functionNodes.size(); i++)		// Calls append the functions they reach
+	{
+		CompileFunction(functionNodes[i], i == 0);
+		program.Functions.push_back(std::move(function));
+	}
+}
+
+size_t Compiler::GetFunctionIndex(const Node* funcNode)
+{
+	const auto found = functionIndices.find(funcNode);
+	if (found != functionIndices.end())
+		return found->second;
+
+	functionIndices.emplace(funcNode, functionNodes.size());
+	functionNodes.push_back(funcNode);
+	return functionNodes.size() - 1;
+}
+
+void Compiler::CompileFunction(const Node* funcNode, bool isEntry)
+{
+	function = BytecodeFunction();
+	function.Id = funcNode->Data.GetIdentifier();
+	function.FuncNode = funcNode;
+	function.ParamsCount = funcNode->Data.Func.ParamsCount;
+	function.LocalsCount = function.ParamsCount;
+	checkedSlots.assign(function.ParamsCount, isEntry);		// Nobody passes arguments to the entry
+	stackDepth = 0;
+
+	semTree.EnterFunction(funcNode, nullptr, 0);
+	scanner.SetCurPos(semTree.GetFunctionPos(funcNode));
+	if (isEntry)
+		for (size_t slot = 0; slot < function.ParamsCount; slot++)
+			Emit(OpCode::ClearLocal, static_cast<uint32_t>(slot));
+	CompStat();
+	Emit(OpCode::Return);
+	semTree.LeaveFunction();
+}
+
+void Compiler::DataDecl()
+{
+	const auto type = LexemeStringToDataType(scanner.NextScan().str);		// Scan Type
+	const Lexeme* lex;
+	do
+	{
+		const auto address = semTree.AddVariable(type, scanner.NextScan().str);	// Scan Id
+		const auto slot = address.Index;
+		if (slot >= checkedSlots.size())
+			checkedSlots.resize(slot + 1);
+		function.LocalsCount = std::max(function.LocalsCount, slot + 1);
+
+		checkedSlots[slot] = true;				// The initializer sees the variable already declared
+		const auto declarationStart = function.Code.size();
+		lex = &scanner.NextScan();											// Scan '=', ',', ';'
+		if (lex->type == LexemeType::Assign)
+		{
+			EmitValue(AssignExpr(), type);
+			EmitStore(address);
+
+			// Expressions have no jumps, the clearing can be put before the initializer that needs it
+			const auto readsItself = std::any_of(function.Code.begin() + declarationStart, function.Code.end(),
+				[slot](const Instruction& instruction) { return instruction.Op == OpCode::LoadLocalChecked && instruction.A == slot; });
+			if (readsItself)
+			{
+				const auto clearPos = function.Positions[declarationStart];
+				function.Code.insert(function.Code.begin() + declarationStart, { OpCode::ClearLocal, static_cast<uint32_t>(slot), 0 });
+				function.Positions.insert(function.Positions.begin() + declarationStart, clearPos);
+			}
+			checkedSlots[slot] = false;
+
+			lex = &scanner.NextScan();										// Scan  ',', ';'
+		}
+		else
+			Emit(OpCode::ClearLocal, static_cast<uint32_t>(slot));
+	} while (lex->type == LexemeType::Comma);
+}
+
+void Compiler::Stat()
+{
+	const auto lexType = scanner.LookForward(1).type;
+	if (SyntaxAnalyser::IsDataType(lexType))
+		DataDecl();
+	else if (lexType == LexemeType::OpenBrace)
+		CompStat();
+	else if (lexType == LexemeType::For)
+		For();
+	else {
+		if (lexType != LexemeType::Semi)
+			Discard(AssignExpr());
+		scanner.NextScan();							// Scan ;
+	}
+}
+
+void Compiler::CompStat()
+{
+	scanner.NextScan();								// Scan {
+	semTree.EnterScope();
+	while (scanner.LookForward(1).type != LexemeType::CloseBrace)
+		Stat();
+	scanner.NextScan();								// Scan }
+	semTree.LeaveScope();
+}
+
+// The condition is checked before the first iteration and after each step:
+//     init; cond; JumpIfZero end; body: stat; step; cond; JumpIfNotZero body; end:
+// A declaration as the body is in the scope of the loop, so the second iteration fails as it
+// declares the first id again:
+//     init; cond; JumpIfZero end; decl; step; cond; JumpIfZero end; Fail; end:
+void Compiler::For()
+{
+	scanner.NextScan();								// Scan for
+	scanner.NextScan();								// Scan (
+	semTree.EnterScope();
+
+	DataDecl();
+
+	const auto condPos = scanner.GetCurPos();
+	Condition(OpCode::JumpIfZero, 0);
+	const auto exitJump = function.Code.size() - 1;
+	scanner.NextScan();								// Scan ;
+
+	const auto stepPos = scanner.GetCurPos();
+	const auto codeSize = function.Code.size();
+	const auto savedDepth = stackDepth;
+	AssignExpr();									// Only to pass the step, it is compiled after the body
+	function.Code.resize(codeSize);
+	function.Positions.resize(codeSize);
+	stackDepth = savedDepth;
+	scanner.NextScan();								// Scan )
+
+	const auto bodyStart = function.Code.size();
+	const auto isDeclarationBody = SyntaxAnalyser::IsDataType(scanner.LookForward(1).type);
+	const auto redeclarationPos = scanner.GetCurPos() + 2;			// Right after the type and the id
+	Stat();
+	const auto statEndPos = scanner.GetCurPos();
+
+	scanner.SetCurPos(stepPos);
+	Discard(AssignExpr());
+	scanner.SetCurPos(condPos);
+	if (isDeclarationBody)
+	{
+		Condition(OpCode::JumpIfZero, 0);
+		const auto secondExitJump = function.Code.size() - 1;
+		scanner.SetCurPos(redeclarationPos);
+		const auto& id = scanner.GetLastLexeme().str;
+		Emit(OpCode::Fail, AddError(std::make_exception_ptr(RedefinedIdentifierException(id))));
+		function.Code[secondExitJump].A = static_cast<uint32_t>(function.Code.size());
+	}
+	else
+		Condition(OpCode::JumpIfNotZero, bodyStart);
+	function.Code[exitJump].A = static_cast<uint32_t>(function.Code.size());
+
+	scanner.SetCurPos(statEndPos);
+	semTree.LeaveScope();
+}
+
+void Compiler::Condition(OpCode jump, size_t target)
+{
+	EmitValue(AssignExpr(), DataType::Int);		// The interpreter casts the condition to int
+	Emit(jump, static_cast<uint32_t>(target));
+}
+
+void Compiler::FuncCall()
+{
+	const auto idPos = scanner.GetCurPos();
+	const auto funcNode = semTree.ResolveFunction(scanner.NextScan().str, idPos);	// Scan Id, main
+	scanner.NextScan();												// Scan (
+
+	std::vector<DataType> paramTypes;
+	auto paramNode = funcNode->Child->Siblink;
+	for (int i = 0; i < funcNode->Data.Func.ParamsCount; i++, paramNode = paramNode->Siblink)
+		paramTypes.push_back(paramNode->GetDataType());
+
+	const auto depthBefore = stackDepth;
+	size_t argsCount = 0;
+	auto voidParamType = DataType::Unknown;							// Param the first void argument is passed to
+	if (scanner.LookForward(1).type != LexemeType::ClosePar)
+	{
+		do
+		{
+			const auto arg = AssignExpr();
+			const auto paramType = argsCount < paramTypes.size() ? paramTypes[argsCount] : DataType::Unknown;
+			if (arg.Type == DataType::Void)
+			{
+				if (voidParamType == DataType::Unknown)
+					voidParamType = paramType;
+			}
+			else if (arg.Type == DataType::Long && paramType == DataType::Int)
+				Emit(OpCode::ToInt);
+			argsCount++;
+		} while (scanner.NextScan().type == LexemeType::Comma);		// Scan , )
+	}
+	else
+		scanner.NextScan();
+
+	// Arguments are evaluated before they are checked, as the interpreter does
+	if (argsCount != paramTypes.size())
+		Emit(OpCode::Fail, AddError(std::make_exception_ptr(
+			WrongArgsCountException(paramTypes.size(), argsCount, funcNode->Data.GetIdentifier()))));
+	else if (voidParamType != DataType::Unknown)
+		Emit(OpCode::Fail, AddError(std::make_exception_ptr(UncastableVariableException(DataType::Void, voidParamType))));
+	else
+		Emit(OpCode::Call, static_cast<uint32_t>(GetFunctionIndex(funcNode)));
+	stackDepth = depthBefore;
+}
+
+Compiler::Operand Compiler::AssignExpr()
+{
+	if (scanner.LookForward(2).type != LexemeType::Assign)
+		return BinaryExpr();
+
+	const auto idPos = scanner.GetCurPos();
+	const auto address = semTree.ResolveVariable(scanner.NextScan().str, idPos);	// Scan Id
+	scanner.NextScan();												// Scan =
+
+	const auto type = GetVariableType(address);
+	EmitValue(BinaryExpr(), type);
+	Emit(OpCode::Dup);
+	EmitStore(address);
+	return { type, address };
+}
+
+Compiler::Operand Compiler::BinaryExpr()
+{
+	std::array<DataType, SyntaxAnalyser::BINARY_PRECEDENCE_LEVELS + 1> types;
+	std::array<size_t, SyntaxAnalyser::BINARY_PRECEDENCE_LEVELS> opsPos;
+	int opsCount = 0;
+
+	const auto& lexemes = scanner.GetLexemes();
+	auto first = PrefixExpr();
+	types[0] = first.Type;
+	while (true)
+	{
+		const auto precedence = SyntaxAnalyser::GetBinaryPrecedence(scanner.LookForward(1).type);
+
+		while (opsCount > 0 && SyntaxAnalyser::GetBinaryPrecedence(lexemes[opsPos[opsCount - 1]].type) >= precedence)
+		{
+			--opsCount;
+			EmitBinary(types[opsCount], types[opsCount + 1], opsPos[opsCount]);
+		}
+
+		if (precedence == 0)
+			return { types[0], first.Variable };
+
+		first.Variable = Address();
+		opsPos[opsCount++] = scanner.GetCurPos();
+		scanner.NextScan();												// Scan binary operation
+		types[opsCount] = PrefixExpr().Type;
+	}
+}
+
+Compiler::Operand Compiler::PrefixExpr()
+{
+	const auto firstOpPos = scanner.GetCurPos();
+	int opsCount = 0;
+	while (SyntaxAnalyser::IsPrefixOperation(scanner.LookForward(1).type) && opsCount < SyntaxAnalyser::MAX_PREFIX_OPERATIONS)
+	{
+		scanner.NextScan();											// Scan ++, --, +, -
+		opsCount++;
+	}
+
+	auto operand = SyntaxAnalyser::IsPrefixOperation(scanner.LookForward(1).type) ? PrefixExpr() : PostfixExpr();
+
+	const auto& lexemes = scanner.GetLexemes();
+	while (opsCount > 0)
+	{
+		const auto pos = firstOpPos + --opsCount;
+		const auto operation = lexemes[pos].type;
+		if (SelectPrefixOperation(operand.Type, operation) == nullptr)
+			throw InvalidOperandsException(operand.Type, LexemeTypeToString(operation));
+
+		const auto code = GetPrefixOpCode(operation);
+		if (code != PrefixOpCode::Plus)
+			Emit(GetPrefixCode(operand.Type, code));
+		if (code == PrefixOpCode::Inc || code == PrefixOpCode::Dec)
+		{
+			if (operand.Variable.IsResolved())
+			{
+				Emit(OpCode::Dup);
+				EmitStore(operand.Variable);
+			}
+		}
+		else
+			operand.Variable = Address();
+	}
+	return operand;
+}
+
+Compiler::Operand Compiler::PostfixExpr()
+{
+	const auto lexType = scanner.LookForward(1).type;
+	if ((lexType == LexemeType::Id || lexType == LexemeType::Main)
+		&& scanner.LookForward(2).type == LexemeType::OpenPar)
+	{
+		FuncCall();
+		return { DataType::Void, Address() };
+	}
+	return PrimExpr();
+}
+
+Compiler::Operand Compiler::PrimExpr()
+{
+	const auto pos = scanner.GetCurPos();
+	const auto& lex = scanner.NextScan();							// Scan DecNum, HexNum, OctNum, Id, Main (
+
+	if (lex.type == LexemeType::OpenPar)
+	{
+		const auto operand = AssignExpr();
+		scanner.NextScan();											// Scan )
+		return operand;
+	}
+
+	if (lex.type == LexemeType::Id || lex.type == LexemeType::Main)
+	{
+		const auto address = semTree.ResolveVariable(lex.str, pos);
+		EmitLoad(address, lex.str);
+		return { GetVariableType(address), address };
+	}
+
+	if (lex.type == LexemeType::DecimNum || lex.type == LexemeType::HexNum
+		|| lex.type == LexemeType::OctNum)
+	{
+		const auto value = semTree.ConvertNumLexemeToValue(lex);
+		Emit(OpCode::Const, 0, value.type == DataType::Long ? value.longVal : value.intVal);
+		return { value.type, Address() };
+	}
+
+	throw ExpectedExpressionException(lex);
+}
+
+size_t Compiler::Emit(OpCode code, uint32_t a, int64_t b)
+{
+	function.Code.push_back({ code, a, b });
+	function.Positions.push_back(scanner.GetCurPos());
+	stackDepth += GetStackEffect(code);
+	function.StackSize = std::max(function.StackSize, stackDepth);
+	return function.Code.size() - 1;
+}
+
+void Compiler::EmitBinary(DataType leftType, DataType rightType, size_t opPos)
+{
+	const auto operation = scanner.GetLexemes()[opPos].type;
+	if (SelectBinaryOperation(leftType, rightType, operation) == nullptr)
+		throw InvalidOperandsException(leftType, rightType, LexemeTypeToString(operation));
+
+	if (leftType == DataType::Int && rightType == DataType::Long)
+		Emit(OpCode::ToInt);										// Right operand takes the type of the left one
+	Emit(GetBinaryCode(leftType, GetBinaryOpCode(operation)));
+}
+
+void Compiler::EmitLoad(const Address& address, const std::string& id)
+{
+	if (address.IsGlobal)
+	{
+		const auto index = GetGlobalIndex(address);
+		if (checkedGlobals[index])
+			Emit(OpCode::LoadGlobalChecked, index, GetUnassignedError(id));
+		else
+			Emit(OpCode::LoadGlobal, index);
+		return;
+	}
+
+	const auto slot = static_cast<uint32_t>(address.Index);
+	if (checkedSlots[slot])
+		Emit(OpCode::LoadLocalChecked, slot, GetUnassignedError(id));
+	else
+		Emit(OpCode::LoadLocal, slot);
+}
+
+void Compiler::EmitStore(const Address& address)
+{
+	if (address.IsGlobal)
+		Emit(OpCode::StoreGlobal, GetGlobalIndex(address));
+	else
+		Emit(OpCode::StoreLocal, static_cast<uint32_t>(address.Index));
+}
+
+void Compiler::EmitValue(const Operand& operand, DataType type)
+{
+	if (operand.Type == DataType::Void)
+	{
+		Emit(OpCode::Fail, AddError(std::make_exception_ptr(UncastableVariableException(DataType::Void, type))));
+		stackDepth++;												// The value the failed code would leave
+	}
+	else if (operand.Type == DataType::Long && type == DataType::Int)
+		Emit(OpCode::ToInt);
+}
+
+void Compiler::Discard(const Operand& operand)
+{
+	if (operand.Type == DataType::Void)
+		return;
+
+	// A store left its value for the enclosing expression; there is none
+	auto& code = function.Code;
+	const auto size = code.size();
+	const auto isStore = size >= 2 && code[size - 2].Op == OpCode::Dup
+		&& (code[size - 1].Op == OpCode::StoreLocal || code[size - 1].Op == OpCode::StoreGlobal);
+	if (isStore)
+	{
+		code.erase(code.end() - 2);
+		function.Positions.erase(function.Positions.end() - 2);
+		stackDepth--;
+	}
+	else
+		Emit(OpCode::Pop);
+}
+
+uint32_t Compiler::AddError(std::exception_ptr error)
+{
+	program.Errors.push_back(std::move(error));
+	return static_cast<uint32_t>(program.Errors.size() - 1);
+}
+
+uint32_t Compiler::GetUnassignedError(const std::string& id)
+{
+	const auto found = unassignedErrors.find(id);
+	if (found != unassignedErrors.end())
+		return found->second;
+
+	const auto index = AddError(std::make_exception_ptr(UsingUninitializedVariableException(id)));
+	unassignedErrors.emplace(id, index);
+	return index;
+}
+
+uint32_t Compiler::GetGlobalIndex(const Address& address)
+{
+	const auto found = globalIndices.find(address.Index);
+	if (found != globalIndices.end())
+		return found->second;
+
+	const auto index = static_cast<uint32_t>(program.Globals.size());
+	program.Globals.push_back({ semTree.GetVariableIdentifier(address), GetVariableType(address), address });
+	checkedGlobals.push_back(!semTree.IsVariableInitialized(address));	// Assigned globals stay assigned
+	globalIndices.emplace(address.Index, index);
+	return index;
+}
+
+DataType Compiler::GetVariableType(const Address& address) const
+{
+	return semTree.GetVariableType(address);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Lexical/Scanner.h"
+#include "Semantics/SemanticTree.h"
+
+// Compiles a function and every function it may call to bytecode.
+// Bodies are parsed again from their lexemes while the semantic tree enters their frames
+// as a call does, so names resolve to the same globals and slots as in the interpreter.
+// The typing pass has already reported everything it can; errors the interpreter finds
+// only while running (arguments, void values, unassigned variables) are compiled to
+// instructions that raise them at the same place.
+class Compiler
+{
+public:
+	Compiler(Scanner& scanner, SemanticTree& semTree);
+
+	BytecodeProgram Compile(const Node* funcNode);
+
+	// Rest of a running for loop from its body on: body, step, condition, back to the body.
+	// Names resolve in the current frame, whose slots become the locals of the first function;
+	// assignedSlots tells which of them hold values now.
+	BytecodeProgram CompileLoop(size_t bodyPos, size_t stepPos, size_t condPos, const std::vector<bool>& assignedSlots);
+
+private:
+	struct Operand
+	{
+		DataType Type;
+		Address Variable;						// Resolved if the value is a variable
+	};
+
+	size_t GetFunctionIndex(const Node* funcNode);
+	void CompileFunction(const Node* funcNode, bool isEntry);
+	void CompileCallees();
+
+	void DataDecl();
+	void Stat();
+	void CompStat();
+	void For();
+	void Condition(OpCode jump, size_t target);
+	void FuncCall();
+
+	Operand AssignExpr();
+	Operand BinaryExpr();
+	Operand PrefixExpr();
+	Operand PostfixExpr();
+	Operand PrimExpr();
+
+	// Instructions remember the scanner position: the interpreter is there when it runs the same code
+	size_t Emit(OpCode code, uint32_t a = 0, int64_t b = 0);
+	void EmitBinary(DataType leftType, DataType rightType, size_t opPos);
+	void EmitLoad(const Address& address, const std::string& id);
+	void EmitStore(const Address& address);
+	// Value of the type the operand is assigned to; a void one fails as the cast of the interpreter does
+	void EmitValue(const Operand& operand, DataType type);
+	void Discard(const Operand& operand);
+
+	uint32_t AddError(std::exception_ptr error);
+	uint32_t GetUnassignedError(const std::string& id);
+	uint32_t GetGlobalIndex(const Address& address);
+	DataType GetVariableType(const Address& address) const;
+
+	Scanner& scanner;
+	SemanticTree& semTree;
+
+	BytecodeProgram program;
+	std::vector<const Node*> functionNodes;					// Index -> function, compiled in order
+	std::unordered_map<const Node*, size_t> functionIndices;
+	std::unordered_map<size_t, uint32_t> globalIndices;		// Index of the address -> global
+	std::vector<bool> checkedGlobals;
+	std::unordered_map<std::string, uint32_t> unassignedErrors;
+
+	BytecodeFunction function;								// Function being compiled
+	std::vector<bool> checkedSlots;							// Slot holds a variable declared without a value
+	size_t stackDepth = 0;
+};
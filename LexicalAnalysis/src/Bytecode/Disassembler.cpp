@@ -0,0 +1,68 @@
+#include "Disassembler.h"
+
+namespace
+{
+	std::string GetErrorText(const std::exception_ptr& error)
+	{
+		try
+		{
+			std::rethrow_exception(error);
+		}
+		catch (const std::exception& ex)
+		{
+			return ex.what();
+		}
+	}
+
+	void PrintOperands(const BytecodeProgram& program, const Instruction& instruction, std::ostream& out)
+	{
+		switch (instruction.Op)
+		{
+		case OpCode::Const:
+			out << '\t' << instruction.B;
+			break;
+		case OpCode::LoadLocal: case OpCode::StoreLocal: case OpCode::ClearLocal:
+		case OpCode::Jump: case OpCode::JumpIfZero: case OpCode::JumpIfNotZero:
+			out << '\t' << instruction.A;
+			break;
+		case OpCode::LoadLocalChecked:
+			out << '\t' << instruction.A << "\t; " << GetErrorText(program.Errors[static_cast<size_t>(instruction.B)]);
+			break;
+		case OpCode::LoadGlobal: case OpCode::StoreGlobal: case OpCode::LoadGlobalChecked:
+			out << '\t' << instruction.A << "\t; " << program.Globals[instruction.A].Id;
+			break;
+		case OpCode::Call:
+			out << '\t' << instruction.A << "\t; " << program.Functions[instruction.A].Id;
+			break;
+		case OpCode::Fail:
+			out << '\t' << instruction.A << "\t; " << GetErrorText(program.Errors[instruction.A]);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void Disassemble(const BytecodeProgram& program, std::ostream& out)
+{
+	for (size_t i = 0; i < program.Globals.size(); i++)
+	{
+		const auto& global = program.Globals[i];
+		out << "global " << i << ' ' << DataTypeToString(global.Type) << ' ' << global.Id << '\n';
+	}
+
+	for (size_t i = 0; i < program.Functions.size(); i++)
+	{
+		const auto& function = program.Functions[i];
+		out << "function " << i << ' ' << function.Id << ": params " << function.ParamsCount
+			<< ", locals " << function.LocalsCount << ", stack " << function.StackSize << '\n';
+		for (size_t pos = 0; pos < function.Code.size(); pos++)
+		{
+			const auto& instruction = function.Code[pos];
+			out << '\t' << pos << '\t' << GetOpCodeName(instruction.Op);
+			PrintOperands(program, instruction, out);
+			out << '\n';
+		}
+	}
+	out.flush();
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <iostream>
+
+#include "Bytecode.h"
+
+// Listing of the compiled functions: one instruction per line with its index,
+// operands resolved to names of globals and functions, and the text of errors
+void Disassemble(const BytecodeProgram& program, std::ostream& out = std::cout);
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <climits>
+#include "Effects.h"
+
+namespace
+{
+	bool IsJump(OpCode code)
+	{
+		return code == OpCode::Jump || code == OpCode::JumpIfZero || code == OpCode::JumpIfNotZero;
+	}
+
+	bool IsOrdering(OpCode code)
+	{
+		switch (code)
+		{
+		case OpCode::GreaterInt: case OpCode::LessInt: case OpCode::LessEqualInt: case OpCode::GreaterEqualInt:
+		case OpCode::GreaterLong: case OpCode::LessLong: case OpCode::LessEqualLong: case OpCode::GreaterEqualLong:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool IsDivision(OpCode code)
+	{
+		return code == OpCode::DivInt || code == OpCode::ModulInt || code == OpCode::DivLong || code == OpCode::ModulLong;
+	}
+
+	std::vector<bool> GetJumpTargets(const std::vector<Instruction>& code)
+	{
+		std::vector<bool> isTarget(code.size() + 1);
+		for (const auto& instr : code)
+			if (IsJump(instr.Op))
+				isTarget[instr.A] = true;
+		return isTarget;
+	}
+
+	// Value of the constant pushed right before ip, if nothing jumps between them
+	bool GetPushedConstant(const std::vector<Instruction>& code, const std::vector<bool>& isTarget, size_t ip, int64_t& value)
+	{
+		if (ip == 0 || isTarget[ip] || code[ip - 1].Op != OpCode::Const)
+			return false;
+		value = code[ip - 1].B;
+		return true;
+	}
+
+	// A divisor other than 0 and -1 neither raises nor overflows
+	bool IsSafeDivision(const std::vector<Instruction>& code, const std::vector<bool>& isTarget, size_t ip)
+	{
+		int64_t divisor;
+		if (!GetPushedConstant(code, isTarget, ip, divisor))
+			return false;
+		const auto isLong = code[ip].Op == OpCode::DivLong || code[ip].Op == OpCode::ModulLong;
+		if (!isLong)
+			divisor = static_cast<int>(divisor);
+		return divisor != 0 && divisor != -1;
+	}
+
+	// The loop of the backward jump at jumpIp, as the compiler lays out for:
+	//     body: ...; LoadLocal c; Const s; AddInt; StoreLocal c; LoadLocal c; Const b; LessInt; JumpIfNotZero body
+	bool IsCountedLoop(const std::vector<Instruction>& code, const std::vector<bool>& isTarget, size_t jumpIp,
+		CountedLoop* loop = nullptr)
+	{
+		const auto at = [&](size_t ip, OpCode op) { return ip < code.size() && code[ip].Op == op; };
+		if (!at(jumpIp, OpCode::JumpIfNotZero))
+			return false;
+
+		auto ip = jumpIp;
+		if (ip > 0 && at(ip - 1, OpCode::ToInt))
+			--ip;
+		if (ip < 3 || !IsOrdering(code[ip - 1].Op))
+			return false;
+		const auto compare = code[ip - 1].Op;
+		const auto isLong = compare >= OpCode::GreaterLong;
+		if (!at(ip - 2, OpCode::Const) || !at(ip - 3, OpCode::LoadLocal))
+			return false;
+		const auto counter = code[ip - 3].A;
+		auto bound = code[ip - 2].B;
+		const auto boundIp = ip - 2;
+		ip -= 3;
+
+		// Step: LoadLocal c; IncInt | DecInt | Const s; AddInt | SubInt; StoreLocal c
+		if (ip < 3 || code[ip - 1].Op != OpCode::StoreLocal || code[ip - 1].A != counter)
+			return false;
+		int64_t step;
+		const auto stepOp = code[ip - 2].Op;
+		size_t stepStart;
+		if (stepOp == (isLong ? OpCode::IncLong : OpCode::IncInt) || stepOp == (isLong ? OpCode::DecLong : OpCode::DecInt))
+		{
+			step = stepOp == OpCode::IncInt || stepOp == OpCode::IncLong ? 1 : -1;
+			stepStart = ip - 3;
+		}
+		else if ((stepOp == (isLong ? OpCode::AddLong : OpCode::AddInt) || stepOp == (isLong ? OpCode::SubLong : OpCode::SubInt))
+			&& ip >= 4 && at(ip - 3, OpCode::Const))
+		{
+			step = isLong ? code[ip - 3].B : static_cast<int>(code[ip - 3].B);
+			if (stepOp == OpCode::SubInt || stepOp == OpCode::SubLong)
+			{
+				if (step == LLONG_MIN)
+					return false;
+				step = -step;
+			}
+			stepStart = ip - 4;
+		}
+		else
+			return false;
+		if (!at(stepStart, OpCode::LoadLocal) || code[stepStart].A != counter || code[jumpIp].A > stepStart)
+			return false;
+
+		// Every iteration makes the step, nothing else in the loop stores the counter
+		for (auto i = stepStart + 1; i <= jumpIp; i++)
+			if (isTarget[i])
+				return false;
+		for (auto i = static_cast<size_t>(code[jumpIp].A); i < stepStart; i++)
+			if (code[i].Op == OpCode::StoreLocal && code[i].A == counter)
+				return false;
+
+		// The counter moves towards the bound and the step that passes it does not wrap
+		const auto low = static_cast<uint64_t>(isLong ? LLONG_MIN : INT_MIN);
+		const auto high = static_cast<uint64_t>(isLong ? LLONG_MAX : INT_MAX);
+		if (!isLong)
+			bound = static_cast<int>(bound);
+		const auto last = static_cast<uint64_t>(bound);
+		const auto distance = step > 0 ? static_cast<uint64_t>(step) : 0 - static_cast<uint64_t>(step);
+		bool isCounted;
+		switch (compare)
+		{
+		case OpCode::LessInt: case OpCode::LessLong:
+			isCounted = step > 0 && (last == low || distance <= high - (last - 1));
+			break;
+		case OpCode::LessEqualInt: case OpCode::LessEqualLong:
+			isCounted = step > 0 && distance <= high - last;
+			break;
+		case OpCode::GreaterInt: case OpCode::GreaterLong:
+			isCounted = step < 0 && (last == high || distance <= (last + 1) - low);
+			break;
+		case OpCode::GreaterEqualInt: case OpCode::GreaterEqualLong:
+			isCounted = step < 0 && distance <= last - low;
+			break;
+		default:
+			isCounted = false;
+			break;
+		}
+		if (isCounted && loop != nullptr)
+			*loop = { counter, step, bound, compare, boundIp };
+		return isCounted;
+	}
+
+	FunctionEffects GetOwnEffects(const BytecodeProgram& program, const BytecodeFunction& function)
+	{
+		FunctionEffects effects;
+		effects.ReadGlobals.resize(program.Globals.size());
+		effects.WrittenGlobals.resize(program.Globals.size());
+
+		const auto& code = function.Code;
+		const auto isTarget = GetJumpTargets(code);
+		for (size_t ip = 0; ip < code.size(); ip++)
+		{
+			const auto& instr = code[ip];
+			switch (instr.Op)
+			{
+			case OpCode::LoadGlobalChecked:
+				effects.MayFail = true;
+				effects.ReadGlobals[instr.A] = true;
+				break;
+			case OpCode::LoadGlobal:
+				effects.ReadGlobals[instr.A] = true;
+				break;
+			case OpCode::StoreGlobal:
+				effects.WrittenGlobals[instr.A] = true;
+				break;
+			case OpCode::LoadLocalChecked: case OpCode::Fail:
+				effects.MayFail = true;
+				break;
+			default:
+				if (IsDivision(instr.Op) && !IsSafeDivision(code, isTarget, ip))
+					effects.MayFail = true;
+				else if (IsJump(instr.Op) && instr.A <= ip && !IsCountedLoop(code, isTarget, ip))
+					effects.MayNotTerminate = true;
+				break;
+			}
+		}
+		return effects;
+	}
+
+	bool Merge(std::vector<bool>& to, const std::vector<bool>& from)
+	{
+		auto isChanged = false;
+		for (size_t i = 0; i < to.size(); i++)
+			if (from[i] && !to[i])
+				to[i] = isChanged = true;
+		return isChanged;
+	}
+}
+
+bool GetCountedLoop(const std::vector<Instruction>& code, size_t jumpIp, CountedLoop& loop)
+{
+	return IsCountedLoop(code, GetJumpTargets(code), jumpIp, &loop);
+}
+
+bool FunctionEffects::IsEffectFree() const
+{
+	return !MayFail && !MayNotTerminate && std::none_of(WrittenGlobals.begin(), WrittenGlobals.end(), [](bool isWritten) { return isWritten; });
+}
+
+std::vector<FunctionEffects> AnalyseEffects(const BytecodeProgram& program)
+{
+	const auto& functions = program.Functions;
+	const auto heights = GetCallHeights(program);
+	std::vector<FunctionEffects> effects;
+	for (size_t i = 0; i < functions.size(); i++)
+	{
+		effects.push_back(GetOwnEffects(program, functions[i]));
+		if (heights[i] == UNBOUNDED_CALLS)
+			effects.back().MayNotTerminate = true;
+	}
+
+	for (auto isChanged = true; isChanged; )
+	{
+		isChanged = false;
+		for (size_t i = 0; i < functions.size(); i++)
+			for (const auto& instr : functions[i].Code)
+				if (instr.Op == OpCode::Call && instr.A != i)
+				{
+					auto& caller = effects[i];
+					const auto& callee = effects[instr.A];
+					isChanged |= Merge(caller.ReadGlobals, callee.ReadGlobals);
+					isChanged |= Merge(caller.WrittenGlobals, callee.WrittenGlobals);
+					isChanged |= callee.MayFail && !caller.MayFail;
+					caller.MayFail |= callee.MayFail;
+					isChanged |= callee.MayNotTerminate && !caller.MayNotTerminate;
+					caller.MayNotTerminate |= callee.MayNotTerminate;
+				}
+	}
+	return effects;
+}
+
+size_t RemoveEffectFreeCalls(BytecodeProgram& program, size_t maxCallDepth)
+{
+	const auto effects = AnalyseEffects(program);
+	const auto heights = GetCallHeights(program), depths = GetCallDepths(program);
+	size_t removedCount = 0;
+	for (size_t index = 0; index < program.Functions.size(); index++)
+	{
+		auto& function = program.Functions[index];
+		const auto isRemoved = [&](const Instruction& instr)
+		{
+			return instr.Op == OpCode::Call && instr.A != 0 && effects[instr.A].IsEffectFree()
+				&& depths[index] != UNBOUNDED_CALLS && depths[index] + heights[instr.A] < maxCallDepth;
+		};
+		if (std::none_of(function.Code.begin(), function.Code.end(), isRemoved))
+			continue;
+
+		// The arguments are still evaluated, as the interpreter does before it checks them
+		std::vector<Instruction> code;
+		std::vector<size_t> positions, newIndices(function.Code.size() + 1);
+		for (size_t ip = 0; ip < function.Code.size(); ip++)
+		{
+			newIndices[ip] = code.size();
+			const auto& instr = function.Code[ip];
+			if (!isRemoved(instr))
+			{
+				code.push_back(instr);
+				positions.push_back(function.Positions[ip]);
+				continue;
+			}
+			for (size_t param = 0; param < program.Functions[instr.A].ParamsCount; param++)
+			{
+				code.push_back({ OpCode::Pop, 0, 0 });
+				positions.push_back(function.Positions[ip]);
+			}
+			removedCount++;
+		}
+		newIndices[function.Code.size()] = code.size();
+
+		for (auto& instr : code)
+			if (IsJump(instr.Op))
+				instr.A = static_cast<uint32_t>(newIndices[instr.A]);
+		function.Code = std::move(code);
+		function.Positions = std::move(positions);
+	}
+
+	if (removedCount != 0)
+		RemoveUncalledFunctions(program);
+	return removedCount;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+#include "Bytecode.h"
+
+// What running a function may do besides changing its own locals, with the functions it calls
+struct FunctionEffects
+{
+	std::vector<bool> ReadGlobals, WrittenGlobals;
+	bool MayFail = false;						// Raises an error of the program, division by zero among them
+	bool MayNotTerminate = false;				// Has a loop it is not known to leave, or reaches recursion
+
+	// Its call changes nothing but the depth of the stack, so only a call that overflows it can be told
+	bool IsEffectFree() const;
+};
+
+// Functions are void, so they act only on globals. Sets grow along the calls until nothing changes.
+// A loop is known to end if its step adds a constant to a counter nothing else in the loop stores,
+// right before the condition compares the counter with a constant it moves towards without wrapping.
+std::vector<FunctionEffects> AnalyseEffects(const BytecodeProgram& program);
+
+// Loop of a backward jump that surely ends: its step adds Step to the local Counter, then the
+// condition compares it with Bound, the constant at BoundIp right before the comparison
+struct CountedLoop
+{
+	uint32_t Counter;
+	int64_t Step, Bound;
+	OpCode Compare;
+	size_t BoundIp;
+};
+bool GetCountedLoop(const std::vector<Instruction>& code, size_t jumpIp, CountedLoop& loop);
+
+// Calls of effect-free functions are replaced with pops of their arguments where no chain of
+// maxCallDepth calls can pass through them; returns the number of calls removed
+size_t RemoveEffectFreeCalls(BytecodeProgram& program, size_t maxCallDepth);
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include "Inliner.h"
+
+namespace
+{
+	bool IsJump(OpCode code)
+	{
+		return code == OpCode::Jump || code == OpCode::JumpIfZero || code == OpCode::JumpIfNotZero;
+	}
+
+	bool IsLocal(OpCode code)
+	{
+		return code == OpCode::LoadLocal || code == OpCode::LoadLocalChecked
+			|| code == OpCode::StoreLocal || code == OpCode::ClearLocal;
+	}
+
+	void PostOrder(const BytecodeProgram& program, size_t index, std::vector<bool>& isVisited, std::vector<size_t>& order)
+	{
+		isVisited[index] = true;
+		for (const auto& instr : program.Functions[index].Code)
+			if (instr.Op == OpCode::Call && !isVisited[instr.A])
+				PostOrder(program, instr.A, isVisited, order);
+		order.push_back(index);
+	}
+
+	// Code of the callee without its final return, in place of the call whose operands start at depth.
+	// Its locals start at offset; inlined calls run one after another, so they all share the slots.
+	void InlineCall(BytecodeFunction& caller, const BytecodeFunction& callee, uint32_t offset, size_t position, int depth,
+		std::vector<Instruction>& code, std::vector<size_t>& positions)
+	{
+		for (auto param = callee.ParamsCount; param-- > 0; )
+		{
+			code.push_back({ OpCode::StoreLocal, static_cast<uint32_t>(offset + param), 0 });
+			positions.push_back(position);
+		}
+
+		const auto start = static_cast<uint32_t>(code.size());
+		const auto size = callee.Code.size() - (callee.Code.back().Op == OpCode::Return ? 1 : 0);
+		for (size_t ip = 0; ip < size; ip++)
+		{
+			auto instr = callee.Code[ip];
+			if (IsLocal(instr.Op))
+				instr.A += offset;
+			else if (IsJump(instr.Op))
+				instr.A += start;
+			else if (instr.Op == OpCode::Return)
+				instr = { OpCode::Jump, static_cast<uint32_t>(start + size), 0 };
+			code.push_back(instr);
+			positions.push_back(callee.Positions[ip]);
+		}
+
+		caller.LocalsCount = std::max(caller.LocalsCount, offset + callee.LocalsCount);
+		const auto operandsDepth = static_cast<size_t>(depth) - callee.ParamsCount;
+		caller.StackSize = std::max(caller.StackSize, operandsDepth + callee.StackSize);
+	}
+}
+
+std::vector<InlinedCall> InlineCalls(BytecodeProgram& program, const InlineThresholds& thresholds, size_t maxCallDepth)
+{
+	auto& functions = program.Functions;
+	const auto count = functions.size();
+	std::vector<size_t> callsCounts(count);
+	for (const auto& function : functions)
+		for (const auto& instr : function.Code)
+			if (instr.Op == OpCode::Call)
+				callsCounts[instr.A]++;
+
+	const auto heights = GetCallHeights(program), depths = GetCallDepths(program);
+	const auto isInlinable = [&](size_t caller, size_t callee)
+	{
+		const auto& code = functions[callee].Code;
+		const auto size = code.size() - 1;
+		const auto isSmall = size <= thresholds.MaxSize || (callsCounts[callee] == 1 && size <= thresholds.MaxSingleCallSize);
+		return callee != 0 && isSmall && heights[callee] != UNBOUNDED_CALLS && depths[caller] != UNBOUNDED_CALLS
+			&& depths[caller] + heights[callee] < maxCallDepth;
+	};
+
+	std::vector<InlinedCall> inlinedCalls;
+	std::vector<bool> isVisited(count);
+	std::vector<size_t> order;
+	PostOrder(program, 0, isVisited, order);
+	for (const auto index : order)
+	{
+		auto& function = functions[index];
+		const auto isInlined = [&](const Instruction& instr) { return instr.Op == OpCode::Call && isInlinable(index, instr.A); };
+		if (std::none_of(function.Code.begin(), function.Code.end(), isInlined))
+			continue;
+
+		const auto stackDepths = GetStackDepths(program, function);
+		const auto offset = static_cast<uint32_t>(function.LocalsCount);
+		std::vector<Instruction> code;
+		std::vector<size_t> positions, newIndices(function.Code.size() + 1);
+		for (size_t ip = 0; ip < function.Code.size(); ip++)
+		{
+			newIndices[ip] = code.size();
+			const auto& instr = function.Code[ip];
+			if (isInlined(instr) && stackDepths[ip] >= 0)
+			{
+				InlineCall(function, functions[instr.A], offset, function.Positions[ip], stackDepths[ip], code, positions);
+				inlinedCalls.push_back({ function.Id, functions[instr.A].Id, function.Positions[ip] });
+			}
+			else
+			{
+				code.push_back(instr);
+				positions.push_back(function.Positions[ip]);
+			}
+		}
+		newIndices[function.Code.size()] = code.size();
+
+		// Jumps of the caller still hold its old indices, the inlined ones are already moved
+		for (size_t ip = 0; ip < function.Code.size(); ip++)
+			if (IsJump(function.Code[ip].Op))
+				code[newIndices[ip]].A = static_cast<uint32_t>(newIndices[function.Code[ip].A]);
+		function.Code = std::move(code);
+		function.Positions = std::move(positions);
+	}
+
+	if (!inlinedCalls.empty())
+		RemoveUncalledFunctions(program);
+	return inlinedCalls;
+}
+
+void PrintInlineReport(const std::vector<InlinedCall>& calls, const std::vector<Lexeme>& lexemes, std::ostream& out)
+{
+	for (const auto& call : calls)
+	{
+		const auto& lex = lexemes[call.Position > 0 ? call.Position - 1 : 0];
+		out << "(" << lex.row << ", " << lex.column << "): " << call.Callee << " inlined into " << call.Caller << '\n';
+	}
+	out.flush();
+}
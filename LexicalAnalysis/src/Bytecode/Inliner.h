@@ -0,0 +1,31 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Lexical/Lexeme.h"
+
+// Sizes are in instructions of the function, with the functions it calls already inlined
+struct InlineThresholds
+{
+	size_t MaxSize = 32;						// Inlined at every call
+	size_t MaxSingleCallSize = 512;				// Inlined at the only place it is called from
+};
+
+struct InlinedCall
+{
+	std::string Caller, Callee;
+	size_t Position;							// Scanner position of the call
+};
+
+// Replaces calls of small functions with their code, callees before their callers, and drops the
+// functions nothing calls afterwards. The arguments are stored to new slots of the caller, after
+// its own locals, so they are copied as the params of a call are and the variables of the callee
+// shadow nothing; its return jumps past its code. A function that is recursive or calls a recursive
+// one is never inlined, nor is a call a chain of maxCallDepth calls may pass through, so the stack
+// overflows exactly where it did.
+std::vector<InlinedCall> InlineCalls(BytecodeProgram& program, const InlineThresholds& thresholds, size_t maxCallDepth);
+
+// A line per inlined call: the position of the call as errors are reported, the caller and the callee
+void PrintInlineReport(const std::vector<InlinedCall>& calls, const std::vector<Lexeme>& lexemes, std::ostream& out = std::cout);
@@ -0,0 +1,147 @@
+#include <climits>
+#include "Optimizer.h"
+#include "Semantics/Operations.h"
+
+namespace
+{
+	bool IsBinary(OpCode code)
+	{
+		return code >= OpCode::AddInt && code <= OpCode::GreaterEqualLong;
+	}
+
+	bool IsPrefix(OpCode code)
+	{
+		return code == OpCode::ToInt || (code >= OpCode::MinusInt && code <= OpCode::DecLong);
+	}
+
+	bool IsJump(OpCode code)
+	{
+		return code == OpCode::Jump || code == OpCode::JumpIfZero || code == OpCode::JumpIfNotZero;
+	}
+
+	template <class T, class Op>
+	int64_t Apply(int64_t left, int64_t right)
+	{
+		return Op::template Apply<T>(static_cast<T>(left), static_cast<T>(right));
+	}
+
+	template <class T>
+	bool TryBinary(BinaryOpCode operation, int64_t left, int64_t right, int64_t& result)
+	{
+		const auto divisor = static_cast<T>(right);
+		const auto isDivision = operation == BinaryOpCode::Div || operation == BinaryOpCode::Modul;
+		if (isDivision && (divisor == 0 || (divisor == -1 && static_cast<T>(left) == (sizeof(T) == 4 ? INT_MIN : LLONG_MIN))))
+			return false;
+
+		using namespace Kernels;
+		static int64_t(* const kernels[])(int64_t, int64_t) = {
+			Apply<T, Add>, Apply<T, Sub>, Apply<T, Mul>, Apply<T, Div>, Apply<T, Modul>, Apply<T, Equal>,
+			Apply<T, NotEqual>, Apply<T, Greater>, Apply<T, Less>, Apply<T, LessEqual>, Apply<T, GreaterEqual>
+		};
+		result = kernels[static_cast<int>(operation)](left, right);
+		return true;
+	}
+
+	bool TryBinary(OpCode code, int64_t left, int64_t right, int64_t& result)
+	{
+		if (code >= OpCode::AddLong)
+			return TryBinary<long long>(static_cast<BinaryOpCode>(static_cast<int>(code) - static_cast<int>(OpCode::AddLong)),
+				left, right, result);
+		return TryBinary<int>(static_cast<BinaryOpCode>(static_cast<int>(code) - static_cast<int>(OpCode::AddInt)),
+			left, right, result);
+	}
+
+	int64_t ApplyPrefix(OpCode code, int64_t value)
+	{
+		using namespace Kernels;
+		switch (code)
+		{
+		case OpCode::ToInt: return static_cast<int>(value);
+		case OpCode::MinusInt: return Minus::Apply<int>(static_cast<int>(value));
+		case OpCode::IncInt: return Inc::Apply<int>(static_cast<int>(value));
+		case OpCode::DecInt: return Dec::Apply<int>(static_cast<int>(value));
+		case OpCode::MinusLong: return Minus::Apply<long long>(value);
+		case OpCode::IncLong: return Inc::Apply<long long>(value);
+		default: return Dec::Apply<long long>(value);
+		}
+	}
+
+	// Code is rewritten into a new vector; an instruction folds only with the ones written after
+	// the last jump target, so every target still starts the code it started
+	void FoldFunction(BytecodeFunction& function, const std::vector<bool>& isConstGlobal, const std::vector<int64_t>& globalValues)
+	{
+		const auto& code = function.Code;
+		std::vector<bool> isTarget(code.size() + 1);
+		for (const auto& instr : code)
+			if (IsJump(instr.Op))
+				isTarget[instr.A] = true;
+
+		std::vector<Instruction> folded;
+		std::vector<size_t> positions, newIndices(code.size() + 1);
+		size_t barrier = 0;											// Instructions before it cannot be folded
+		const auto isConst = [&](size_t fromEnd)
+		{
+			return folded.size() >= barrier + fromEnd && folded[folded.size() - fromEnd].Op == OpCode::Const;
+		};
+
+		for (size_t ip = 0; ip < code.size(); ip++)
+		{
+			newIndices[ip] = folded.size();
+			if (isTarget[ip])
+				barrier = folded.size();
+
+			auto instr = code[ip];
+			const auto isLoadGlobal = instr.Op == OpCode::LoadGlobal || instr.Op == OpCode::LoadGlobalChecked;
+			if (isLoadGlobal && isConstGlobal[instr.A])
+				instr = { OpCode::Const, 0, globalValues[instr.A] };
+
+			int64_t result;
+			if (IsPrefix(instr.Op) && isConst(1))
+				folded.back().B = ApplyPrefix(instr.Op, folded.back().B);
+			else if (IsBinary(instr.Op) && isConst(1) && isConst(2)
+				&& TryBinary(instr.Op, folded[folded.size() - 2].B, folded.back().B, result))
+			{
+				folded.pop_back();
+				positions.pop_back();
+				folded.back().B = result;
+			}
+			else if ((instr.Op == OpCode::JumpIfZero || instr.Op == OpCode::JumpIfNotZero) && isConst(1))
+			{
+				const auto isTaken = (folded.back().B == 0) == (instr.Op == OpCode::JumpIfZero);
+				if (isTaken)
+					folded.back() = { OpCode::Jump, instr.A, 0 };
+				else
+				{
+					folded.pop_back();
+					positions.pop_back();
+				}
+			}
+			else
+			{
+				folded.push_back(instr);
+				positions.push_back(function.Positions[ip]);
+			}
+		}
+		newIndices[code.size()] = folded.size();
+
+		for (auto& instr : folded)
+			if (IsJump(instr.Op))
+				instr.A = static_cast<uint32_t>(newIndices[instr.A]);
+		function.Code = std::move(folded);
+		function.Positions = std::move(positions);
+	}
+}
+
+void FoldConstants(BytecodeProgram& program, const std::vector<bool>& knownGlobals, const std::vector<int64_t>& globalValues)
+{
+	// A global keeps the value it starts with if nothing stores it
+	auto isConstGlobal = knownGlobals;
+	isConstGlobal.resize(program.Globals.size());
+	for (const auto& function : program.Functions)
+		for (const auto& instr : function.Code)
+			if (instr.Op == OpCode::StoreGlobal)
+				isConstGlobal[instr.A] = false;
+
+	for (auto& function : program.Functions)
+		FoldFunction(function, isConstGlobal, globalValues);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.h"
+
+// Folds operations on constants and conditional jumps on them, and replaces loads of the globals
+// no function of the program stores with their values. Results are computed by the kernels the
+// virtual machine runs, so int and long values wrap and truncate as they do at run time; an
+// operation that would fail is left in place to fail there.
+// knownGlobals tells which globals have globalValues when the program starts.
+void FoldConstants(BytecodeProgram& program,
+	const std::vector<bool>& knownGlobals = {}, const std::vector<int64_t>& globalValues = {});
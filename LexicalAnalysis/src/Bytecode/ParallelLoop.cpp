@@ -0,0 +1,187 @@
+#include "ParallelLoop.h"
+
+namespace
+{
+	enum class Update
+	{
+		None, Sum, Product
+	};
+
+	bool IsJump(OpCode code)
+	{
+		return code == OpCode::Jump || code == OpCode::JumpIfZero || code == OpCode::JumpIfNotZero;
+	}
+
+	bool IsLong(const CountedLoop& loop)
+	{
+		return loop.Compare >= OpCode::GreaterLong;
+	}
+
+	// Values on the top of the stack the instruction takes or reads
+	int GetOperandsCount(const BytecodeProgram& program, const Instruction& instr)
+	{
+		switch (instr.Op)
+		{
+		case OpCode::Const: case OpCode::LoadLocal: case OpCode::LoadLocalChecked: case OpCode::ClearLocal:
+		case OpCode::LoadGlobal: case OpCode::LoadGlobalChecked: case OpCode::Jump: case OpCode::Return: case OpCode::Fail:
+			return 0;
+		case OpCode::Call:
+			return static_cast<int>(program.Functions[instr.A].ParamsCount);
+		default:
+			return instr.Op >= OpCode::AddInt && instr.Op <= OpCode::GreaterEqualLong ? 2 : 1;
+		}
+	}
+
+	Update GetUpdate(OpCode code, DataType type)
+	{
+		const auto isLong = type == DataType::Long;
+		if (code == (isLong ? OpCode::AddLong : OpCode::AddInt) || code == (isLong ? OpCode::SubLong : OpCode::SubInt))
+			return Update::Sum;
+		if (code == (isLong ? OpCode::MulLong : OpCode::MulInt))
+			return Update::Product;
+		return Update::None;
+	}
+
+	// The global stored at storeIp as ++g, --g or g = g op e: the operation right before the store takes
+	// the value of LoadGlobal g, found at loadIp, and e, which is computed above it without jumps and
+	// without touching it
+	Update MatchUpdate(const BytecodeProgram& program, const std::vector<int>& depths, const std::vector<bool>& isTarget,
+		size_t storeIp, size_t& loadIp)
+	{
+		const auto& code = program.Functions[0].Code;
+		const auto global = code[storeIp].A;
+		if (storeIp < 2)
+			return Update::None;
+		const auto opIp = storeIp - 1;
+		const auto type = program.Globals[global].Type;
+		const auto op = code[opIp].Op;
+		if (op == (type == DataType::Long ? OpCode::IncLong : OpCode::IncInt)
+			|| op == (type == DataType::Long ? OpCode::DecLong : OpCode::DecInt))
+		{
+			loadIp = opIp - 1;
+			const auto isLoaded = code[loadIp].Op == OpCode::LoadGlobal && code[loadIp].A == global;
+			return isLoaded && !isTarget[opIp] && !isTarget[storeIp] ? Update::Sum : Update::None;
+		}
+
+		const auto update = GetUpdate(op, type);
+		const auto depth = depths[opIp];
+		if (update == Update::None || depth < 2)
+			return Update::None;
+
+		loadIp = opIp;
+		do
+		{
+			if (loadIp == 0 || depths[--loadIp] < 0)
+				return Update::None;
+		} while (depths[loadIp] > depth - 2);
+		if (depths[loadIp] != depth - 2 || code[loadIp].Op != OpCode::LoadGlobal || code[loadIp].A != global)
+			return Update::None;
+
+		for (auto ip = loadIp; ip <= storeIp; ip++)
+		{
+			const auto& instr = code[ip];
+			if (ip > loadIp && ip < opIp && depths[ip] - GetOperandsCount(program, instr) < depth - 1)
+				return Update::None;					// Takes the value of g before the operation
+			if (IsJump(instr.Op) || (ip > loadIp && isTarget[ip]))
+				return Update::None;
+			const auto isAccess = instr.Op == OpCode::LoadGlobal || instr.Op == OpCode::LoadGlobalChecked
+				|| instr.Op == OpCode::StoreGlobal;
+			if (ip > loadIp && ip < opIp && isAccess && instr.A == global)
+				return Update::None;
+		}
+		return update;
+	}
+}
+
+bool AnalyseParallelLoop(const BytecodeProgram& program, size_t privateSlots, size_t callsBudget, ParallelLoop& loop)
+{
+	const auto& code = program.Functions[0].Code;
+	const auto jumpIp = code.size() - 2;
+	if (code.size() < 2 || code.back().Op != OpCode::Return || code[jumpIp].A != 0
+		|| !GetCountedLoop(code, jumpIp, loop.Loop))
+		return false;
+
+	const auto effects = AnalyseEffects(program);
+	if (effects[0].MayFail || effects[0].MayNotTerminate)
+		return false;
+
+	// The callees only read globals, they must not see the partial results
+	const auto heights = GetCallHeights(program);
+	std::vector<bool> isReadByCallee(program.Globals.size()), isTarget(code.size() + 1);
+	for (const auto& instr : code)
+	{
+		if (instr.Op == OpCode::Call)
+		{
+			const auto& callee = effects[instr.A];
+			if (!callee.IsEffectFree() || heights[instr.A] >= callsBudget)
+				return false;
+			for (size_t i = 0; i < isReadByCallee.size(); i++)
+				isReadByCallee[i] = isReadByCallee[i] || callee.ReadGlobals[i];
+		}
+		else if ((instr.Op == OpCode::StoreLocal || instr.Op == OpCode::ClearLocal)
+			&& instr.A < privateSlots && instr.A != loop.Loop.Counter)
+			return false;
+		else if (IsJump(instr.Op))
+			isTarget[instr.A] = true;
+	}
+
+	const auto depths = GetStackDepths(program, program.Functions[0]);
+	std::vector<Update> updates(program.Globals.size(), Update::None);
+	std::vector<bool> isUpdateLoad(code.size());
+	for (size_t ip = 0; ip < code.size(); ip++)
+	{
+		if (code[ip].Op != OpCode::StoreGlobal)
+			continue;
+		const auto global = code[ip].A;
+		size_t loadIp;
+		const auto update = MatchUpdate(program, depths, isTarget, ip, loadIp);
+		if (update == Update::None || isReadByCallee[global] || (updates[global] != Update::None && updates[global] != update))
+			return false;
+		updates[global] = update;
+		isUpdateLoad[loadIp] = true;
+	}
+	for (size_t ip = 0; ip < code.size(); ip++)
+	{
+		const auto& instr = code[ip];
+		const auto isLoad = instr.Op == OpCode::LoadGlobal || instr.Op == OpCode::LoadGlobalChecked;
+		if (isLoad && updates[instr.A] != Update::None && !isUpdateLoad[ip])
+			return false;
+	}
+
+	loop.Reductions.clear();
+	for (size_t i = 0; i < updates.size(); i++)
+		if (updates[i] != Update::None)
+			loop.Reductions.push_back({ i, updates[i] == Update::Product });
+	return true;
+}
+
+uint64_t GetIterationsCount(const CountedLoop& loop, int64_t counter)
+{
+	const auto distance = loop.Step > 0 ? static_cast<uint64_t>(loop.Step) : 0 - static_cast<uint64_t>(loop.Step);
+	const auto span = loop.Step > 0 ? static_cast<uint64_t>(loop.Bound) - static_cast<uint64_t>(counter)
+		: static_cast<uint64_t>(counter) - static_cast<uint64_t>(loop.Bound);
+	switch (loop.Compare)
+	{
+	case OpCode::LessInt: case OpCode::LessLong: case OpCode::GreaterInt: case OpCode::GreaterLong:
+		return span / distance + (span % distance != 0 ? 1 : 0);
+	default:
+		return span / distance + 1;
+	}
+}
+
+int64_t AdvanceCounter(const CountedLoop& loop, int64_t counter, uint64_t iterations)
+{
+	const auto value = static_cast<uint64_t>(counter) + iterations * static_cast<uint64_t>(loop.Step);
+	return IsLong(loop) ? static_cast<int64_t>(value) : static_cast<int>(value);
+}
+
+BytecodeProgram LimitLoop(const BytecodeProgram& program, const CountedLoop& loop, int64_t end)
+{
+	auto limited = program;
+	auto& code = limited.Functions[0].Code;
+	const auto isLong = IsLong(loop);
+	code[loop.BoundIp].B = end;
+	code[loop.BoundIp + 1].Op = loop.Step > 0 ? (isLong ? OpCode::LessLong : OpCode::LessInt)
+		: (isLong ? OpCode::GreaterLong : OpCode::GreaterInt);
+	return limited;
+}
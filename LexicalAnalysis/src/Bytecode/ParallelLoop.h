@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Effects.h"
+
+struct Reduction
+{
+	size_t Global;
+	bool IsProduct;								// Otherwise a sum its iterations add to and subtract from
+};
+
+struct ParallelLoop
+{
+	CountedLoop Loop;
+	std::vector<Reduction> Reductions;
+};
+
+// Iterations of a loop compiled by CompileLoop that can run in any order and on several threads:
+// it is counted, nothing it runs raises or may not return, and no call overflows the stack within
+// callsBudget frames. Locals below privateSlots are only read, but for the counter; the others are
+// declared by the body, so every iteration assigns them anew. A global is either only read or only
+// updated as ++g, --g, g = g + e, g = g - e or g = g * e where nothing in e reads g, nor does any
+// function the loop calls. Sums and products of ints and longs wrap modulo 2^32 and 2^64, a ring,
+// so partial results of parts of the iterations started from 0 and 1 combine to the exact value.
+bool AnalyseParallelLoop(const BytecodeProgram& program, size_t privateSlots, size_t callsBudget, ParallelLoop& loop);
+
+// Iterations the loop runs from the counter value on, the condition has held for it
+uint64_t GetIterationsCount(const CountedLoop& loop, int64_t counter);
+// Counter value after the given number of iterations
+int64_t AdvanceCounter(const CountedLoop& loop, int64_t counter, uint64_t iterations);
+// The loop stopped when its counter reaches end, a value it takes after some iterations
+BytecodeProgram LimitLoop(const BytecodeProgram& program, const CountedLoop& loop, int64_t end);
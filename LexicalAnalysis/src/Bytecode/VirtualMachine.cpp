@@ -0,0 +1,291 @@
+#include <algorithm>
+#include "VirtualMachine.h"
+#include "Exceptions/AnalysisExceptions.h"
+#include "Semantics/Operations.h"
+
+// GCC and Clang jump from each handler straight to the next one through a table of labels,
+// so every instruction has its own indirect branch; others run a switch in a loop
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_THREADED_DISPATCH
+#endif
+
+VirtualMachine::VirtualMachine(const BytecodeProgram& program, size_t maxCallDepth, size_t baseDepth)
+	: program(program), maxCallDepth(maxCallDepth), baseDepth(baseDepth),
+	globals(program.Globals.size()), globalsAssigned(program.Globals.size())
+{
+	const auto& entry = program.Functions.front();
+	Reserve(std::max<size_t>(1024, entry.LocalsCount + entry.StackSize + 1));
+}
+
+void VirtualMachine::Run()
+{
+	failedFunction = nullptr;
+	try
+	{
+		Execute();
+	}
+	catch (...)
+	{
+		if (failedFunction != nullptr)
+			errorPosition = failedFunction->Positions[failedIp - failedFunction->Code.data()];
+		throw;
+	}
+}
+
+DataValue VirtualMachine::GetGlobal(size_t index) const
+{
+	if (program.Globals[index].Type == DataType::Long)
+		return DataValue(static_cast<long long>(globals[index]));
+	return DataValue(static_cast<int>(globals[index]));
+}
+
+void VirtualMachine::SetGlobal(size_t index, DataValue value)
+{
+	globals[index] = value.type == DataType::Long ? value.longVal : value.intVal;
+	globalsAssigned[index] = 1;
+}
+
+DataValue VirtualMachine::GetLocal(size_t slot, DataType type) const
+{
+	if (type == DataType::Long)
+		return DataValue(static_cast<long long>(stack[slot]));
+	return DataValue(static_cast<int>(stack[slot]));
+}
+
+void VirtualMachine::SetLocal(size_t slot, DataValue value)
+{
+	stack[slot] = value.type == DataType::Long ? value.longVal : value.intVal;
+	assigned[slot] = 1;
+}
+
+void VirtualMachine::Reserve(size_t size)
+{
+	if (size <= stack.size())
+		return;
+	size = std::max(size, stack.size() * 2);
+	stack.resize(size);
+	assigned.resize(size);
+}
+
+void VirtualMachine::Execute()
+{
+	const auto& functions = program.Functions;
+	auto function = &functions.front();
+	frames.clear();
+
+	auto stackData = stack.data();
+	auto assignedData = assigned.data();
+	const auto globalValues = globals.data();
+	const auto globalFlags = globalsAssigned.data();
+
+	size_t base = 0;
+	auto locals = stackData;
+	auto localsAssigned = assignedData;
+	auto sp = locals + function->LocalsCount - 1;				// Top of the operands
+	auto code = function->Code.data();
+	auto ip = code;
+
+#define VM_SAVE_POSITION() (failedFunction = function, failedIp = ip)
+#define VM_BINARY(name, T, Op)																\
+	VM_CASE(name)																			\
+		sp[-1] = Kernels::Op::Apply<T>(static_cast<T>(sp[-1]), static_cast<T>(sp[0]));		\
+		--sp; ++ip;																			\
+		VM_DISPATCH();
+#define VM_DIVISION(name, T, Op)															\
+	VM_CASE(name)																			\
+		VM_SAVE_POSITION();																	\
+		sp[-1] = Kernels::Op::Apply<T>(static_cast<T>(sp[-1]), static_cast<T>(sp[0]));		\
+		--sp; ++ip;																			\
+		VM_DISPATCH();
+#define VM_PREFIX(name, T, Op)																\
+	VM_CASE(name)																			\
+		sp[0] = Kernels::Op::Apply<T>(static_cast<T>(sp[0]));								\
+		++ip;																				\
+		VM_DISPATCH();
+
+#ifdef VM_THREADED_DISPATCH
+	static const void* const labels[] = {
+#define VM_LABEL(name) &&Op_##name,
+		BYTECODE_OPCODES(VM_LABEL)
+#undef VM_LABEL
+	};
+#define VM_CASE(name) Op_##name:
+#define VM_DISPATCH() goto *labels[static_cast<size_t>(ip->Op)]
+	VM_DISPATCH();
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_DISPATCH() continue
+	for (;;)
+	switch (ip->Op)
+	{
+#endif
+
+	VM_CASE(Const)
+		*++sp = ip->B;
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(LoadLocal)
+		*++sp = locals[ip->A];
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(LoadLocalChecked)
+		if (!localsAssigned[ip->A])
+		{
+			VM_SAVE_POSITION();
+			std::rethrow_exception(program.Errors[static_cast<size_t>(ip->B)]);
+		}
+		*++sp = locals[ip->A];
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(StoreLocal)
+		locals[ip->A] = *sp--;
+		localsAssigned[ip->A] = 1;
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(ClearLocal)
+		localsAssigned[ip->A] = 0;
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(LoadGlobal)
+		*++sp = globalValues[ip->A];
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(LoadGlobalChecked)
+		if (!globalFlags[ip->A])
+		{
+			VM_SAVE_POSITION();
+			std::rethrow_exception(program.Errors[static_cast<size_t>(ip->B)]);
+		}
+		*++sp = globalValues[ip->A];
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(StoreGlobal)
+		globalValues[ip->A] = *sp--;
+		globalFlags[ip->A] = 1;
+		++ip;
+		VM_DISPATCH();
+
+	VM_CASE(Dup)
+		sp[1] = sp[0];
+		++sp; ++ip;
+		VM_DISPATCH();
+
+	VM_CASE(Pop)
+		--sp; ++ip;
+		VM_DISPATCH();
+
+	VM_CASE(ToInt)
+		sp[0] = static_cast<int>(sp[0]);
+		++ip;
+		VM_DISPATCH();
+
+	VM_BINARY(AddInt, int, Add)
+	VM_BINARY(SubInt, int, Sub)
+	VM_BINARY(MulInt, int, Mul)
+	VM_DIVISION(DivInt, int, Div)
+	VM_DIVISION(ModulInt, int, Modul)
+	VM_BINARY(EqualInt, int, Equal)
+	VM_BINARY(NotEqualInt, int, NotEqual)
+	VM_BINARY(GreaterInt, int, Greater)
+	VM_BINARY(LessInt, int, Less)
+	VM_BINARY(LessEqualInt, int, LessEqual)
+	VM_BINARY(GreaterEqualInt, int, GreaterEqual)
+
+	VM_BINARY(AddLong, long long, Add)
+	VM_BINARY(SubLong, long long, Sub)
+	VM_BINARY(MulLong, long long, Mul)
+	VM_DIVISION(DivLong, long long, Div)
+	VM_DIVISION(ModulLong, long long, Modul)
+	VM_BINARY(EqualLong, long long, Equal)
+	VM_BINARY(NotEqualLong, long long, NotEqual)
+	VM_BINARY(GreaterLong, long long, Greater)
+	VM_BINARY(LessLong, long long, Less)
+	VM_BINARY(LessEqualLong, long long, LessEqual)
+	VM_BINARY(GreaterEqualLong, long long, GreaterEqual)
+
+	VM_PREFIX(MinusInt, int, Minus)
+	VM_PREFIX(IncInt, int, Inc)
+	VM_PREFIX(DecInt, int, Dec)
+	VM_PREFIX(MinusLong, long long, Minus)
+	VM_PREFIX(IncLong, long long, Inc)
+	VM_PREFIX(DecLong, long long, Dec)
+
+	VM_CASE(Jump)
+		ip = code + ip->A;
+		VM_DISPATCH();
+
+	VM_CASE(JumpIfZero)
+		ip = *sp-- == 0 ? code + ip->A : ip + 1;
+		VM_DISPATCH();
+
+	VM_CASE(JumpIfNotZero)
+		ip = *sp-- != 0 ? code + ip->A : ip + 1;
+		VM_DISPATCH();
+
+	VM_CASE(Call)
+	{
+		const auto callee = &functions[ip->A];
+		if (baseDepth + frames.size() >= maxCallDepth)
+		{
+			VM_SAVE_POSITION();
+			throw StackOverflowException(callee->Id, baseDepth + frames.size() + 1);
+		}
+		frames.push_back({ function, ip + 1, base });
+
+		base = static_cast<size_t>(sp - stackData) + 1 - callee->ParamsCount;
+		if (base + callee->LocalsCount + callee->StackSize >= stack.size())
+		{
+			Reserve(base + callee->LocalsCount + callee->StackSize + 1);
+			stackData = stack.data();
+			assignedData = assigned.data();
+		}
+		function = callee;
+		locals = stackData + base;
+		localsAssigned = assignedData + base;
+		sp = locals + function->LocalsCount - 1;
+		code = function->Code.data();
+		ip = code;
+		VM_DISPATCH();
+	}
+
+	VM_CASE(Return)
+	{
+		if (frames.empty())
+			return;
+
+		sp = locals - 1;									// Params of the call are popped with it
+		const auto& frame = frames.back();
+		function = frame.function;
+		base = frame.base;
+		locals = stackData + base;
+		localsAssigned = assignedData + base;
+		code = function->Code.data();
+		ip = frame.returnIp;
+		frames.pop_back();
+		VM_DISPATCH();
+	}
+
+	VM_CASE(Fail)
+		VM_SAVE_POSITION();
+		std::rethrow_exception(program.Errors[ip->A]);
+
+#ifndef VM_THREADED_DISPATCH
+	default:
+		return;
+	}
+#endif
+
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_SAVE_POSITION
+#undef VM_BINARY
+#undef VM_DIVISION
+#undef VM_PREFIX
+}
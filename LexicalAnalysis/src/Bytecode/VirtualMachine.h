@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Semantics/Node/DataValue.h"
+
+// Runs bytecode on a value stack and a call stack that live on the heap.
+// A frame is the params and locals of a call followed by its operands; the arguments the
+// caller pushed become the params in place. Globals are a table filled and read back by the owner.
+class VirtualMachine
+{
+public:
+	// Calls of the program start at baseDepth, the depth the caller of Run has reached
+	VirtualMachine(const BytecodeProgram& program, size_t maxCallDepth, size_t baseDepth = 0);
+
+	void Run();
+
+	DataValue GetGlobal(size_t index) const;
+	void SetGlobal(size_t index, DataValue value);
+	bool IsGlobalAssigned(size_t index) const { return globalsAssigned[index] != 0; }
+
+	// Slots of the first function, the one Run starts with
+	DataValue GetLocal(size_t slot, DataType type) const;
+	void SetLocal(size_t slot, DataValue value);
+	bool IsLocalAssigned(size_t slot) const { return assigned[slot] != 0; }
+
+	// Scanner position of the instruction that raised the last error
+	size_t GetErrorPosition() const { return errorPosition; }
+
+private:
+	struct Frame
+	{
+		const BytecodeFunction* function;
+		const Instruction* returnIp;
+		size_t base;
+	};
+
+	void Execute();
+	void Reserve(size_t size);
+
+	const BytecodeProgram& program;
+	size_t maxCallDepth;
+	size_t baseDepth;
+
+	std::vector<int64_t> globals;
+	std::vector<uint8_t> globalsAssigned;
+
+	std::vector<int64_t> stack;
+	std::vector<uint8_t> assigned;						// Flags of the slots of variables declared without a value
+	std::vector<Frame> frames;							// Callers of the running function
+
+	const BytecodeFunction* failedFunction = nullptr;
+	const Instruction* failedIp = nullptr;
+	size_t errorPosition = 0;
+};
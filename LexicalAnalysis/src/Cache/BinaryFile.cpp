@@ -0,0 +1,27 @@
+#include "BinaryFile.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <process.h>
+#define GetProcessId() _getpid()
+#else
+#include <unistd.h>
+#define GetProcessId() getpid()
+#endif
+
+std::string GetTempPath(const std::string& path)
+{
+	return path + "." + std::to_string(GetProcessId()) + ".tmp";
+}
+
+void ReplaceFile(const std::string& tmpPath, const std::string& path)
+{
+	// Rename does not replace existing files on Windows, so a stale file is removed first
+	if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(path.c_str());
+		if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+			std::remove(tmpPath.c_str());
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstring>
+#include <ostream>
+#include <string>
+
+// Helpers for the fixed-layout binary files of the cache and of snapshots
+
+template<class T>
+void WriteRecord(std::ostream& out, const T& value)
+{
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+T ReadRecord(const char* data, size_t offset)
+{
+	T value;
+	std::memcpy(&value, data + offset, sizeof(T));
+	return value;
+}
+
+// Name for writing a file of this process before it replaces path
+std::string GetTempPath(const std::string& path);
+
+// Moves the written file into place atomically, removes it on failure
+void ReplaceFile(const std::string& tmpPath, const std::string& path);
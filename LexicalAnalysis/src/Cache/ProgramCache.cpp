@@ -0,0 +1,168 @@
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "BinaryFile.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDirectory(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MakeDirectory(path) mkdir(path, 0700)
+#endif
+
+namespace
+{
+	const char MAGIC[4] = { 'L', 'X', 'A', 'C' };
+
+	struct EntryHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		uint32_t lexemesCount;
+		uint32_t checkedBodiesCount;
+		uint64_t stringsSize;
+	};
+
+	struct LexemeRecord
+	{
+		uint32_t type;
+		uint32_t row;
+		uint32_t column;
+		uint32_t endColumn;
+		uint32_t strOffset;
+		uint32_t strLength;
+	};
+
+	struct BodyRecord
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+}
+
+ProgramCache::ProgramCache(std::string directory, const std::string& source)
+	: directory(std::move(directory)),
+	sourceHash(HashSource(source)),
+	sourceSize(source.size())
+{}
+
+std::string ProgramCache::GetEntryPath() const
+{
+	std::stringstream path;
+	path << directory << '/' << std::hex;
+	path.width(16);
+	path.fill('0');
+	path << sourceHash << ".lxc";
+	return path.str();
+}
+
+bool ProgramCache::Load(std::vector<Lexeme>& lexemes, std::unordered_map<size_t, size_t>& checkedBodies) const
+{
+	const MappedFile file(GetEntryPath());
+	if (!file.IsOpen() || file.GetSize() < sizeof(EntryHeader))
+		return false;
+
+	const auto data = file.GetData();
+	const auto header = ReadRecord<EntryHeader>(data, 0);
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION
+		|| header.sourceHash != sourceHash || header.sourceSize != sourceSize)
+		return false;
+
+	const auto lexemesOffset = sizeof(EntryHeader);
+	const auto bodiesOffset = lexemesOffset + header.lexemesCount * sizeof(LexemeRecord);
+	const auto stringsOffset = bodiesOffset + header.checkedBodiesCount * sizeof(BodyRecord);
+	if (stringsOffset + header.stringsSize != file.GetSize())
+		return false;
+
+	const auto strings = data + stringsOffset;
+	lexemes.resize(header.lexemesCount);
+	for (size_t i = 0; i < header.lexemesCount; i++)
+	{
+		const auto record = ReadRecord<LexemeRecord>(data, lexemesOffset + i * sizeof(LexemeRecord));
+		if (static_cast<uint64_t>(record.strOffset) + record.strLength > header.stringsSize
+			|| record.type == 0 || record.type > static_cast<uint32_t>(LexemeType::Err))
+			return false;
+		lexemes[i].type = static_cast<LexemeType>(record.type);
+		lexemes[i].row = record.row;
+		lexemes[i].column = record.column;
+		lexemes[i].endColumn = record.endColumn;
+		lexemes[i].str.assign(strings + record.strOffset, record.strLength);
+	}
+
+	for (size_t i = 0; i < header.checkedBodiesCount; i++)
+	{
+		const auto record = ReadRecord<BodyRecord>(data, bodiesOffset + i * sizeof(BodyRecord));
+		if (record.begin >= record.end || record.end > header.lexemesCount)
+			return false;
+		checkedBodies[record.begin] = record.end;
+	}
+	return true;
+}
+
+void ProgramCache::Store(const std::vector<Lexeme>& lexemes, const std::unordered_map<size_t, size_t>& checkedBodies) const
+{
+	std::string strings;
+	for (const auto& lexeme : lexemes)
+		strings += lexeme.str;
+
+	EntryHeader header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = FORMAT_VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.lexemesCount = static_cast<uint32_t>(lexemes.size());
+	header.checkedBodiesCount = static_cast<uint32_t>(checkedBodies.size());
+	header.stringsSize = strings.size();
+
+	MakeDirectory(directory.c_str());
+	const auto path = GetEntryPath();
+	const auto tmpPath = GetTempPath(path);
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return;
+
+		WriteRecord(out, header);
+		uint32_t strOffset = 0;
+		for (const auto& lexeme : lexemes)
+		{
+			const LexemeRecord record = { static_cast<uint32_t>(lexeme.type), static_cast<uint32_t>(lexeme.row),
+				static_cast<uint32_t>(lexeme.column), static_cast<uint32_t>(lexeme.endColumn), strOffset,
+				static_cast<uint32_t>(lexeme.str.size()) };
+			WriteRecord(out, record);
+			strOffset += record.strLength;
+		}
+		for (const auto& body : checkedBodies)
+			WriteRecord(out, BodyRecord{ static_cast<uint32_t>(body.first), static_cast<uint32_t>(body.second) });
+		out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+		if (!out)
+		{
+			out.close();
+			std::remove(tmpPath.c_str());
+			return;
+		}
+	}
+
+	ReplaceFile(tmpPath, path);						// Entry appears atomically
+}
+
+uint64_t ProgramCache::HashSource(const std::string& source)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (const auto c : source)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Lexical/Lexeme.h"
+
+// Content-addressed on-disk cache of scanned programs.
+// An entry is keyed by the hash of the source text and keeps its lexemes together
+// with the function bodies that were already checked, so they can be skipped on a hit.
+class ProgramCache
+{
+public:
+	ProgramCache(std::string directory, const std::string& source);
+
+	bool Load(std::vector<Lexeme>& lexemes, std::unordered_map<size_t, size_t>& checkedBodies) const;
+	void Store(const std::vector<Lexeme>& lexemes, const std::unordered_map<size_t, size_t>& checkedBodies) const;
+
+	std::string GetEntryPath() const;
+
+	// Entries written with another version are ignored and overwritten
+	static const uint32_t FORMAT_VERSION = 3;
+
+	static uint64_t HashSource(const std::string& source);
+
+private:
+
+	std::string directory;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+};
@@ -0,0 +1,204 @@
+#include "Snapshot.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "BinaryFile.h"
+#include "MappedFile.h"
+
+namespace
+{
+	const char MAGIC[4] = { 'L', 'X', 'A', 'S' };
+
+	struct SnapshotHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t prefixHash;
+		uint64_t prefixLength;
+		uint32_t declarationsCount;
+		uint32_t recordsCount;
+		uint64_t stringsSize;
+	};
+
+	// A function record is followed by the records of its params
+	struct DeclarationRecord
+	{
+		uint32_t semanticType;
+		uint32_t dataType;
+		uint32_t isInitialized;
+		uint32_t paramsCount;
+		int64_t value;				// Value of a variable, body position of a function
+		uint32_t idOffset;
+		uint32_t idLength;
+	};
+
+	struct Declaration
+	{
+		DeclarationRecord record;
+		std::string id;
+	};
+
+	bool IsVariableType(uint32_t type)
+	{
+		return type == static_cast<uint32_t>(DataType::Int) || type == static_cast<uint32_t>(DataType::Long);
+	}
+}
+
+Snapshot::Snapshot(std::string path)
+	: path(std::move(path))
+{}
+
+size_t Snapshot::Restore(const std::vector<Lexeme>& lexemes, SemanticTree& semTree) const
+{
+	const MappedFile file(path);
+	if (!file.IsOpen() || file.GetSize() < sizeof(SnapshotHeader))
+		return 0;
+
+	const auto data = file.GetData();
+	const auto header = ReadRecord<SnapshotHeader>(data, 0);
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION
+		|| header.prefixLength == 0 || header.prefixLength >= lexemes.size()
+		|| header.prefixHash != HashLexemes(lexemes, header.prefixLength))
+		return 0;
+
+	const auto recordsOffset = sizeof(SnapshotHeader);
+	const auto stringsOffset = recordsOffset + static_cast<uint64_t>(header.recordsCount) * sizeof(DeclarationRecord);
+	if (stringsOffset + header.stringsSize != file.GetSize())
+		return 0;
+
+	// Whole image is validated before the tree is touched
+	std::vector<Declaration> declarations(header.recordsCount);
+	size_t paramsLeft = 0, topLevelCount = 0;
+	for (size_t i = 0; i < header.recordsCount; i++)
+	{
+		auto& declaration = declarations[i];
+		declaration.record = ReadRecord<DeclarationRecord>(data, recordsOffset + i * sizeof(DeclarationRecord));
+		const auto& record = declaration.record;
+		if (static_cast<uint64_t>(record.idOffset) + record.idLength > header.stringsSize || record.idLength == 0)
+			return 0;
+		declaration.id.assign(data + stringsOffset + record.idOffset, record.idLength);
+
+		if (paramsLeft > 0)
+		{
+			if (record.semanticType != static_cast<uint32_t>(SemanticType::Var) || !IsVariableType(record.dataType))
+				return 0;
+			--paramsLeft;
+		}
+		else if (record.semanticType == static_cast<uint32_t>(SemanticType::Func))
+		{
+			if (record.value <= 0 || static_cast<uint64_t>(record.value) >= header.prefixLength)
+				return 0;
+			paramsLeft = record.paramsCount;
+			++topLevelCount;
+		}
+		else if (record.semanticType == static_cast<uint32_t>(SemanticType::Var) && IsVariableType(record.dataType))
+			++topLevelCount;
+		else
+			return 0;
+	}
+	if (paramsLeft > 0 || topLevelCount != header.declarationsCount)
+		return 0;
+
+	for (size_t i = 0; i < declarations.size(); i++)
+	{
+		const auto& record = declarations[i].record;
+		if (record.semanticType == static_cast<uint32_t>(SemanticType::Func))
+		{
+			const auto funcNode = semTree.AddFunction(declarations[i].id);
+			for (uint32_t param = 0; param < record.paramsCount; param++)
+			{
+				const auto& paramDeclaration = declarations[++i];
+				semTree.AddParam(funcNode, paramDeclaration.id, static_cast<DataType>(paramDeclaration.record.dataType));
+			}
+			semTree.SetFunctionPos(funcNode, static_cast<size_t>(record.value));
+			semTree.LeaveFunctionScope(funcNode);
+			continue;
+		}
+
+		const auto type = static_cast<DataType>(record.dataType);
+		const auto address = semTree.AddVariable(type, declarations[i].id);
+		if (record.isInitialized)
+			semTree.SetVariableValue(address, type == DataType::Long ? DataValue(static_cast<long long>(record.value))
+				: DataValue(static_cast<int>(record.value)));
+	}
+	return static_cast<size_t>(header.prefixLength);
+}
+
+void Snapshot::Save(const std::vector<Lexeme>& lexemes, size_t pos, const SemanticTree& semTree) const
+{
+	std::vector<DeclarationRecord> records;
+	std::string strings;
+	const auto addRecord = [&](const Node* node, uint32_t paramsCount, int64_t value, bool isInitialized)
+	{
+		const auto& id = node->Data.GetIdentifier();
+		records.push_back({ static_cast<uint32_t>(node->GetSemanticType()), static_cast<uint32_t>(node->GetDataType()),
+			isInitialized, paramsCount, value, static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(id.size()) });
+		strings += id;
+	};
+
+	const auto declarations = semTree.GetDeclarations();
+	for (const auto node : declarations)
+	{
+		if (node->GetSemanticType() == SemanticType::Func)
+		{
+			const auto& func = node->Data.Func;
+			addRecord(node, static_cast<uint32_t>(func.ParamsCount), static_cast<int64_t>(func.Pos), false);
+			auto paramNode = node->Child->Siblink;
+			for (int i = 0; i < func.ParamsCount; i++, paramNode = paramNode->Siblink)
+				addRecord(paramNode, 0, 0, false);
+			continue;
+		}
+
+		const auto& var = node->Data.Var;
+		addRecord(node, 0, var.Type == DataType::Long ? var.Value.longVal : var.Value.intVal, var.IsInitialized);
+	}
+
+	SnapshotHeader header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = FORMAT_VERSION;
+	header.prefixHash = HashLexemes(lexemes, pos);
+	header.prefixLength = pos;
+	header.declarationsCount = static_cast<uint32_t>(declarations.size());
+	header.recordsCount = static_cast<uint32_t>(records.size());
+	header.stringsSize = strings.size();
+
+	const auto tmpPath = GetTempPath(path);
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+			return;
+
+		WriteRecord(out, header);
+		for (const auto& record : records)
+			WriteRecord(out, record);
+		out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+		if (!out)
+		{
+			out.close();
+			std::remove(tmpPath.c_str());
+			return;
+		}
+	}
+	ReplaceFile(tmpPath, path);
+}
+
+uint64_t Snapshot::HashLexemes(const std::vector<Lexeme>& lexemes, size_t count)
+{
+	// FNV-1a over types and texts, so changes of layout and comments keep the image valid
+	uint64_t hash = 14695981039346656037ULL;
+	const auto add = [&hash](unsigned char c)
+	{
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	};
+	for (size_t i = 0; i < count; i++)
+	{
+		add(static_cast<unsigned char>(lexemes[i].type));
+		for (const auto c : lexemes[i].str)
+			add(static_cast<unsigned char>(c));
+		add(0);
+	}
+	return hash;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Lexical/Lexeme.h"
+#include "Semantics/SemanticTree.h"
+
+// Binary image of the interpreter state at the start of a top-level declaration:
+// global variables with their values and the declared functions with their params.
+// The image is bound to the lexemes before that point, so a program that differs only
+// after it resumes there instead of evaluating its declarations again.
+// No call is active between top-level declarations, so there is no stack to keep.
+class Snapshot
+{
+public:
+	explicit Snapshot(std::string path);
+
+	// Returns position to resume from, or 0 if the image is missing or made for another program
+	size_t Restore(const std::vector<Lexeme>& lexemes, SemanticTree& semTree) const;
+	void Save(const std::vector<Lexeme>& lexemes, size_t pos, const SemanticTree& semTree) const;
+
+	const std::string& GetPath() const { return path; }
+
+	static const uint32_t FORMAT_VERSION = 1;
+
+private:
+	static uint64_t HashLexemes(const std::vector<Lexeme>& lexemes, size_t count);
+
+	std::string path;
+};
@@ -0,0 +1,238 @@
+#include "AnalysisDaemon.h"
+
+#include <chrono>
+#include <map>
+#include <sstream>
+
+#include "Json.h"
+#include "Exceptions/AnalysisExceptions.h"
+#include "Syntaxes/SyntaxAnalyser.h"
+
+namespace
+{
+	uint64_t HashAppend(uint64_t hash, const std::string& str)
+	{
+		// FNV-1a, strings are terminated so that concatenations do not collide
+		for (const auto c : str)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ULL;
+		}
+		hash ^= 0xFF;
+		hash *= 1099511628211ULL;
+		return hash;
+	}
+
+	uint64_t HashAppend(uint64_t hash, const Lexeme& lexeme)
+	{
+		return HashAppend(hash, std::to_string(static_cast<unsigned>(lexeme.type)) + lexeme.str);
+	}
+
+	const uint64_t HASH_SEED = 14695981039346656037ULL;
+}
+
+void AnalysisDaemon::Run(std::istream& in, std::ostream& out)
+{
+	std::string line;
+	while (!isShutdown && std::getline(in, line))
+	{
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+		out << HandleRequest(line) << std::endl;
+	}
+}
+
+std::string AnalysisDaemon::HandleRequest(const std::string& line)
+{
+	const auto startTime = std::chrono::steady_clock::now();
+
+	// The id is echoed as it was sent, a string one stays quoted
+	std::map<std::string, std::string> request, tokens;
+	std::string id = "null", result;
+	if (!Json::ParseObject(line, request, &tokens))
+		result = "\"ok\":false,\"error\":\"malformed request\"";
+	else
+	{
+		if (tokens.count("id"))
+			id = tokens["id"];
+		const auto& method = request["method"];
+		const auto& uri = request["uri"];
+		const auto document = documents.find(uri);
+		const auto isDocumentMethod = method == "check" || method == "run" || method == "close";
+
+		if (method == "open" || method == "change")
+		{
+			auto& doc = documents[uri];
+			doc.text = request["text"];
+			doc.checkResult = Analyse(doc, false);
+			doc.isChecked = true;
+			result = doc.checkResult;
+		}
+		else if (method == "shutdown")
+		{
+			isShutdown = true;
+			result = "\"ok\":true";
+		}
+		else if (!isDocumentMethod)
+			result = "\"ok\":false,\"error\":" + Json::Quote("unknown method " + method);
+		else if (document == documents.end())
+			result = "\"ok\":false,\"error\":" + Json::Quote("unknown document " + uri);
+		else if (method == "check")
+		{
+			if (!document->second.isChecked)
+			{
+				document->second.checkResult = Analyse(document->second, false);
+				document->second.isChecked = true;
+			}
+			result = document->second.checkResult;
+		}
+		else if (method == "run")
+			result = Analyse(document->second, true);
+		else
+		{
+			documents.erase(document);
+			result = "\"ok\":true";
+		}
+	}
+
+	const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+	return "{\"id\":" + id + "," + result + ",\"latencyUs\":" + std::to_string(latency.count()) + "}";
+}
+
+std::string AnalysisDaemon::Analyse(Document& document, bool isRun)
+{
+	std::stringstream ss(document.text);
+	SyntaxAnalyser analyser(ss);
+
+	const auto bodies = GetFunctionBodies(analyser.GetScanner()->GetLexemes());
+	std::unordered_map<size_t, size_t> knownBodies;
+	for (const auto& body : bodies)
+		if (document.checkedBodyKeys.count(body.key))
+			knownBodies[body.begin] = body.end;
+	const auto reusedCount = knownBodies.size();
+	analyser.SetCheckedBodies(std::move(knownBodies));
+
+	std::stringstream result;
+	result << "\"ok\":true,\"diagnostics\":[";
+	bool isSucceeded = false;
+	try
+	{
+		if (isRun)
+			analyser.Program();
+		else
+			analyser.Check();
+		isSucceeded = true;
+	}
+	catch (std::exception& ex)
+	{
+		const auto& lex = analyser.GetScanner()->GetLastLexeme();
+		result << "{\"row\":" << lex.row << ",\"column\":" << lex.endColumn << ",\"message\":" << Json::Quote(ex.what()) << "}";
+	}
+	result << "]";
+
+	// Keys of bodies no longer in the text are dropped, so they take no more than the text does.
+	// A failed analysis stops partway, the bodies it checked are kept but not counted
+	const auto& checkedBodies = analyser.GetCheckedBodies();
+	document.checkedBodyKeys.clear();
+	for (const auto& body : bodies)
+		if (checkedBodies.count(body.begin))
+			document.checkedBodyKeys.insert(body.key);
+	if (isSucceeded)
+		result << ",\"checkedBodies\":" << checkedBodies.size() - reusedCount;
+	result << ",\"reusedBodies\":" << reusedCount;
+
+	if (isRun && isSucceeded)
+	{
+		result << ",\"globals\":[";
+		const auto globals = analyser.GetSemTree()->GetGlobalVariables();
+		for (size_t i = 0; i < globals.size(); i++)
+		{
+			const auto varData = &globals[i]->Data.Var;
+			result << (i ? "," : "") << "{\"id\":" << Json::Quote(globals[i]->Data.GetIdentifier())
+				<< ",\"type\":" << Json::Quote(DataTypeToString(varData->Type)) << ",\"value\":";
+			if (!varData->IsInitialized)
+				result << "null";
+			else if (varData->Value.type == DataType::Long)
+				result << varData->Value.longVal;
+			else
+				result << varData->Value.intVal;
+			result << "}";
+		}
+		result << "]";
+	}
+	return result.str();
+}
+
+std::vector<AnalysisDaemon::FunctionBody> AnalysisDaemon::GetFunctionBodies(const std::vector<Lexeme>& lexemes)
+{
+	// Top-level declarations seen so far, a body can only refer to the ones above it
+	std::unordered_map<std::string, std::string> declarations;
+	std::string globalType;
+	int parDepth = 0;
+
+	std::vector<FunctionBody> bodies;
+	for (size_t i = 0; i < lexemes.size() && lexemes[i].type != LexemeType::End; i++)
+	{
+		if (i + 2 >= lexemes.size() || lexemes[i].type != LexemeType::Void || lexemes[i + 2].type != LexemeType::OpenPar
+			|| (lexemes[i + 1].type != LexemeType::Id && lexemes[i + 1].type != LexemeType::Main))
+		{
+			// Global variables: type id [= expr], id [= expr] ... ;
+			const auto type = lexemes[i].type;
+			if (type == LexemeType::Int || type == LexemeType::Long)
+				globalType = lexemes[i].str;
+			else if (type == LexemeType::Semi)
+				globalType.clear();
+			else if (type == LexemeType::OpenPar)
+				++parDepth;
+			else if (type == LexemeType::ClosePar)
+				--parDepth;
+			else if (type == LexemeType::Id && !globalType.empty() && parDepth == 0 && i > 0
+				&& (lexemes[i - 1].type == LexemeType::Comma || lexemes[i - 1].str == globalType))
+				declarations[lexemes[i].str] = "var " + globalType;
+			continue;
+		}
+
+		// Function: void id(params) { body }
+		const auto declBegin = i;
+		std::string signature = "func ";
+		auto pos = i + 3;
+		while (pos < lexemes.size() && lexemes[pos].type != LexemeType::ClosePar && lexemes[pos].type != LexemeType::End)
+		{
+			if (lexemes[pos].type == LexemeType::Int || lexemes[pos].type == LexemeType::Long)
+				signature += lexemes[pos].str + ",";
+			++pos;
+		}
+		if (pos + 1 >= lexemes.size() || lexemes[pos + 1].type != LexemeType::OpenBrace)
+			continue;
+
+		const auto begin = pos + 1;
+		int depth = 0;
+		for (pos = begin; pos < lexemes.size() && lexemes[pos].type != LexemeType::End; pos++)
+		{
+			if (lexemes[pos].type == LexemeType::OpenBrace)
+				++depth;
+			else if (lexemes[pos].type == LexemeType::CloseBrace && --depth == 0)
+				break;
+		}
+		if (depth != 0)
+			break;
+
+		const auto end = pos + 1;
+		declarations[lexemes[i + 1].str] = signature;
+
+		// Names in the body are resolved against the declarations above, so they are part of the key
+		auto key = HASH_SEED;
+		for (pos = declBegin; pos < end; pos++)
+		{
+			key = HashAppend(key, lexemes[pos]);
+			if (pos > begin && (lexemes[pos].type == LexemeType::Id || lexemes[pos].type == LexemeType::Main))
+			{
+				const auto declaration = declarations.find(lexemes[pos].str);
+				key = HashAppend(key, declaration != declarations.end() ? declaration->second : "?");
+			}
+		}
+		bodies.push_back({ begin, end, key });
+		i = end - 1;
+	}
+	return bodies;
+}
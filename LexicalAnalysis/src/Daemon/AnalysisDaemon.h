@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Lexical/Lexeme.h"
+
+// Long-running analysis server speaking line-delimited JSON.
+// Every request is an object {"id": .., "method": .., "uri": .., "text": ..} on its own line:
+//   open, change - store the document text and check it
+//   check        - check the stored document, answered from the last result if the text did not change
+//   run          - interpret the document and report its global variables
+//   close        - forget the document
+//   shutdown     - stop the daemon
+// Function bodies of a document that passed a check are remembered by a key built from their text
+// and the top-level declarations their names refer to, so later checks only re-check bodies whose
+// key changed. The text is still scanned and its declarations are still built anew every time.
+class AnalysisDaemon
+{
+public:
+	void Run(std::istream& in, std::ostream& out);
+	std::string HandleRequest(const std::string& line);
+
+	bool IsShutdown() const { return isShutdown; }
+
+private:
+	struct Document
+	{
+		std::string text;
+		bool isChecked = false;
+		std::string checkResult;
+		std::unordered_set<uint64_t> checkedBodyKeys;		// Of the bodies in the text last analysed
+	};
+
+	struct FunctionBody
+	{
+		size_t begin, end;
+		uint64_t key;
+	};
+
+	std::string Analyse(Document& document, bool isRun);
+	static std::vector<FunctionBody> GetFunctionBodies(const std::vector<Lexeme>& lexemes);
+
+	std::unordered_map<std::string, Document> documents;
+	bool isShutdown = false;
+};
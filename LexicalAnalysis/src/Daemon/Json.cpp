@@ -0,0 +1,165 @@
+#include "Json.h"
+
+#include <cstdio>
+
+bool Json::ParseObject(const std::string& text, std::map<std::string, std::string>& fields,
+	std::map<std::string, std::string>* tokens)
+{
+	size_t pos = 0;
+	SkipSpaces(text, pos);
+	if (pos >= text.size() || text[pos] != '{')
+		return false;
+	++pos;
+
+	SkipSpaces(text, pos);
+	if (pos < text.size() && text[pos] == '}')
+		return true;
+
+	while (true)
+	{
+		std::string key, value;
+		SkipSpaces(text, pos);
+		if (!ParseString(text, pos, key))
+			return false;
+
+		SkipSpaces(text, pos);
+		if (pos >= text.size() || text[pos] != ':')
+			return false;
+		++pos;
+
+		SkipSpaces(text, pos);
+		if (pos >= text.size())
+			return false;
+		const auto valueStart = pos;
+		if (text[pos] == '"' ? !ParseString(text, pos, value) : !ParseLiteral(text, pos, value))
+			return false;
+		fields[key] = value;
+		if (tokens)
+			(*tokens)[key] = text.substr(valueStart, pos - valueStart);
+
+		SkipSpaces(text, pos);
+		if (pos >= text.size())
+			return false;
+		if (text[pos] == '}')
+			return true;
+		if (text[pos] != ',')
+			return false;
+		++pos;
+	}
+}
+
+std::string Json::Quote(const std::string& str)
+{
+	std::string result = "\"";
+	for (const auto c : str)
+	{
+		switch (c)
+		{
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				result += escaped;
+			}
+			else
+				result += c;
+		}
+	}
+	return result + "\"";
+}
+
+void Json::SkipSpaces(const std::string& text, size_t& pos)
+{
+	while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\r' || text[pos] == '\n'))
+		++pos;
+}
+
+bool Json::ParseString(const std::string& text, size_t& pos, std::string& result)
+{
+	if (pos >= text.size() || text[pos] != '"')
+		return false;
+	++pos;
+
+	while (pos < text.size())
+	{
+		const auto c = text[pos++];
+		if (c == '"')
+			return true;
+		if (c != '\\')
+		{
+			result += c;
+			continue;
+		}
+
+		if (pos >= text.size())
+			return false;
+		switch (text[pos++])
+		{
+		case '"': result += '"'; break;
+		case '\\': result += '\\'; break;
+		case '/': result += '/'; break;
+		case 'b': result += '\b'; break;
+		case 'f': result += '\f'; break;
+		case 'n': result += '\n'; break;
+		case 'r': result += '\r'; break;
+		case 't': result += '\t'; break;
+		case 'u':
+		{
+			if (pos + 4 > text.size())
+				return false;
+			unsigned codePoint = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				const auto h = text[pos++];
+				codePoint <<= 4;
+				if ('0' <= h && h <= '9') codePoint |= h - '0';
+				else if ('a' <= h && h <= 'f') codePoint |= h - 'a' + 10;
+				else if ('A' <= h && h <= 'F') codePoint |= h - 'A' + 10;
+				else return false;
+			}
+			AppendUtf8(result, codePoint);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return false;
+}
+
+bool Json::ParseLiteral(const std::string& text, size_t& pos, std::string& result)
+{
+	const auto start = pos;
+	while (pos < text.size() && text[pos] != ',' && text[pos] != '}'
+		&& text[pos] != ' ' && text[pos] != '\t' && text[pos] != '\r' && text[pos] != '\n')
+	{
+		if (text[pos] == '{' || text[pos] == '[' || text[pos] == '"')
+			return false;
+		++pos;
+	}
+	result = text.substr(start, pos - start);
+	return !result.empty();
+}
+
+void Json::AppendUtf8(std::string& str, unsigned codePoint)
+{
+	if (codePoint < 0x80)
+		str += static_cast<char>(codePoint);
+	else if (codePoint < 0x800)
+	{
+		str += static_cast<char>(0xC0 | codePoint >> 6);
+		str += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		str += static_cast<char>(0xE0 | codePoint >> 12);
+		str += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+		str += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+}
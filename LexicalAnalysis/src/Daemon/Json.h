@@ -0,0 +1,22 @@
+#pragma once
+#include <map>
+#include <string>
+
+// Minimal JSON support for the daemon protocol.
+// Requests are flat objects whose values are strings, numbers, booleans or null.
+class Json
+{
+public:
+	// Non-string values are kept as their source text, the source text of every value also goes to
+	// tokens if they are given. Returns false on malformed input
+	static bool ParseObject(const std::string& text, std::map<std::string, std::string>& fields,
+		std::map<std::string, std::string>* tokens = nullptr);
+
+	static std::string Quote(const std::string& str);
+
+private:
+	static void SkipSpaces(const std::string& text, size_t& pos);
+	static bool ParseString(const std::string& text, size_t& pos, std::string& result);
+	static bool ParseLiteral(const std::string& text, size_t& pos, std::string& result);
+	static void AppendUtf8(std::string& str, unsigned codePoint);
+};
@@ -3,11 +3,12 @@
 #include <sstream>
 
 #include "Lexical/Lexeme.h"
+#include "Types/DataType.h"
 
 class AnalysisException : public std::exception
 {
 public:
-	char const* what() const override
+	char const* what() const noexcept override
 	{
 		return message.c_str();
 	}
@@ -22,11 +23,14 @@ protected:
 
 class SyntaxException : public AnalysisException {
 public:
-	char const* what() const override
+	char const* what() const noexcept override
 	{
-		static auto resMessage = "Синтаксическая ошибка: " + message;
+		resMessage = "Синтаксическая ошибка: " + message;
 		return resMessage.c_str();
 	}
+
+private:
+	mutable std::string resMessage;
 };
 
 class InvalidIdentifierException : public SyntaxException
@@ -77,11 +81,14 @@ public:
 
 class SemanticException : public AnalysisException {
 public:
-	char const* what() const override
+	char const* what() const noexcept override
 	{
-		static auto resMessage = "Семантическая ошибка: " + message;
+		resMessage = "Семантическая ошибка: " + message;
 		return resMessage.c_str();
 	}
+
+private:
+	mutable std::string resMessage;
 };
 
 class RedefinedIdentifierException : public SemanticException
@@ -153,6 +160,16 @@ public:
 	}
 };
 
+class StackOverflowException : public SemanticException
+{
+public:
+	StackOverflowException(const std::string& funcId, size_t depth)
+	{
+		message = "Переполнение стека вызовов при вызове функции " + funcId
+			+ " на глубине " + std::to_string(depth);
+	}
+};
+
 class UsingUninitializedVariableException : public SemanticException
 {
 public:
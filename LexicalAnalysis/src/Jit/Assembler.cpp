@@ -0,0 +1,212 @@
+#include "Assembler.h"
+
+namespace X64
+{
+	Assembler::Label Assembler::NewLabel()
+	{
+		labels.push_back(0);
+		return labels.size() - 1;
+	}
+
+	void Assembler::Bind(Label label)
+	{
+		labels[label] = code.size();
+	}
+
+	const std::vector<uint8_t>& Assembler::Finish()
+	{
+		for (const auto& fixup : fixups)
+		{
+			const auto rel = static_cast<int32_t>(labels[fixup.second] - (fixup.first + 4));
+			for (size_t i = 0; i < 4; i++)
+				code[fixup.first + i] = static_cast<uint8_t>(static_cast<uint32_t>(rel) >> (8 * i));
+		}
+		fixups.clear();
+		return code;
+	}
+
+	void Assembler::Int32(int32_t value)
+	{
+		for (size_t i = 0; i < 4; i++)
+			Byte(static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i)));
+	}
+
+	void Assembler::Rex(bool wide, uint8_t reg, uint8_t base)
+	{
+		const uint8_t rex = 0x40 | (wide ? 8 : 0) | (reg & 8 ? 4 : 0) | (base & 8 ? 1 : 0);
+		if (rex != 0x40)
+			Byte(rex);
+	}
+
+	void Assembler::ModRm(uint8_t reg, Mem mem)
+	{
+		const uint8_t base = mem.Base & 7;
+		uint8_t mod = 0x80;
+		if (mem.Disp == 0 && base != RBP)
+			mod = 0;
+		else if (mem.Disp >= -128 && mem.Disp <= 127)
+			mod = 0x40;
+
+		Byte(mod | (reg & 7) << 3 | base);
+		if (base == RSP)
+			Byte(0x24);											// SIB without an index
+		if (mod == 0x40)
+			Byte(static_cast<uint8_t>(mem.Disp));
+		else if (mod == 0x80)
+			Int32(mem.Disp);
+	}
+
+	void Assembler::ModRm(uint8_t reg, Reg rm)
+	{
+		Byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+	}
+
+	void Assembler::Instr(uint8_t opcode, uint8_t reg, Mem mem, bool wide)
+	{
+		Rex(wide, reg, mem.Base);
+		Byte(opcode);
+		ModRm(reg, mem);
+	}
+
+	void Assembler::Instr(uint8_t opcode, uint8_t reg, Reg rm, bool wide)
+	{
+		Rex(wide, reg, rm);
+		Byte(opcode);
+		ModRm(reg, rm);
+	}
+
+	void Assembler::Relative(Label label)
+	{
+		fixups.emplace_back(code.size(), label);
+		Int32(0);
+	}
+
+	void Assembler::Mov(Reg dst, Reg src, bool wide) { Instr(0x89, src, dst, wide); }
+	void Assembler::Mov(Reg dst, Mem src, bool wide) { Instr(0x8B, dst, src, wide); }
+	void Assembler::Mov(Mem dst, Reg src, bool wide) { Instr(0x89, src, dst, wide); }
+
+	void Assembler::Mov(Mem dst, int32_t imm)
+	{
+		Instr(0xC7, 0, dst, true);
+		Int32(imm);
+	}
+
+	void Assembler::Mov(Reg dst, int64_t imm)
+	{
+		if (imm >= INT32_MIN && imm <= INT32_MAX)
+		{
+			Instr(0xC7, 0, dst, true);
+			Int32(static_cast<int32_t>(imm));
+			return;
+		}
+		Rex(true, 0, dst);
+		Byte(0xB8 | (dst & 7));
+		for (size_t i = 0; i < 8; i++)
+			Byte(static_cast<uint8_t>(static_cast<uint64_t>(imm) >> (8 * i)));
+	}
+
+	void Assembler::MovByte(Mem dst, uint8_t imm)
+	{
+		Instr(0xC6, 0, dst, false);
+		Byte(imm);
+	}
+
+	void Assembler::Movsxd(Reg dst, Reg src) { Instr(0x63, dst, src, true); }
+	void Assembler::Movsxd(Reg dst, Mem src) { Instr(0x63, dst, src, true); }
+	void Assembler::Lea(Reg dst, Mem src) { Instr(0x8D, dst, src, true); }
+
+	void Assembler::Add(Reg dst, Mem src, bool wide) { Instr(0x03, dst, src, wide); }
+	void Assembler::Sub(Reg dst, Mem src, bool wide) { Instr(0x2B, dst, src, wide); }
+
+	void Assembler::Imul(Reg dst, Mem src, bool wide)
+	{
+		Rex(wide, dst, src.Base);
+		Byte(0x0F);
+		Byte(0xAF);
+		ModRm(dst, src);
+	}
+
+	void Assembler::Cmp(Reg left, Mem right, bool wide) { Instr(0x3B, left, right, wide); }
+	void Assembler::Cmp(Reg left, Reg right, bool wide) { Instr(0x3B, left, right, wide); }
+
+	void Assembler::Cmp(Mem left, int32_t imm, bool wide)
+	{
+		if (imm >= -128 && imm <= 127)
+		{
+			Instr(0x83, 7, left, wide);
+			Byte(static_cast<uint8_t>(imm));
+			return;
+		}
+		Instr(0x81, 7, left, wide);
+		Int32(imm);
+	}
+
+	void Assembler::CmpByte(Mem left, uint8_t imm)
+	{
+		Instr(0x80, 7, left, false);
+		Byte(imm);
+	}
+
+	void Assembler::Test(Reg left, Reg right, bool wide) { Instr(0x85, right, left, wide); }
+	void Assembler::Neg(Reg reg, bool wide) { Instr(0xF7, 3, reg, wide); }
+	void Assembler::Inc(Reg reg, bool wide) { Instr(0xFF, 0, reg, wide); }
+	void Assembler::Dec(Reg reg, bool wide) { Instr(0xFF, 1, reg, wide); }
+
+	void Assembler::SignExtendAccumulator(bool wide)
+	{
+		if (wide)
+			Byte(0x48);
+		Byte(0x99);
+	}
+
+	void Assembler::Idiv(Reg divisor, bool wide) { Instr(0xF7, 7, divisor, wide); }
+
+	void Assembler::Setcc(Condition condition, Reg dst)
+	{
+		Byte(0x0F);
+		Byte(0x90 | condition);
+		ModRm(0, dst);
+	}
+
+	void Assembler::MovzxByte(Reg dst, Reg src)
+	{
+		Rex(false, dst, src);
+		Byte(0x0F);
+		Byte(0xB6);
+		ModRm(dst, src);
+	}
+
+	void Assembler::Push(Reg reg)
+	{
+		Rex(false, 0, reg);
+		Byte(0x50 | (reg & 7));
+	}
+
+	void Assembler::Pop(Reg reg)
+	{
+		Rex(false, 0, reg);
+		Byte(0x58 | (reg & 7));
+	}
+
+	void Assembler::Jmp(Label label)
+	{
+		Byte(0xE9);
+		Relative(label);
+	}
+
+	void Assembler::Jcc(Condition condition, Label label)
+	{
+		Byte(0x0F);
+		Byte(0x80 | condition);
+		Relative(label);
+	}
+
+	void Assembler::Call(Label label)
+	{
+		Byte(0xE8);
+		Relative(label);
+	}
+
+	void Assembler::Ret() { Byte(0xC3); }
+	void Assembler::Leave() { Byte(0xC9); }
+}
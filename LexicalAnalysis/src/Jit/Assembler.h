@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Encoder of the few x86-64 instructions the JIT needs.
+// Memory operands are a base register and a displacement; jumps and calls go to labels
+// bound later and are patched when the code is finished.
+namespace X64
+{
+	enum Reg : uint8_t
+	{
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11, R12, R13, R14, R15
+	};
+
+	enum Condition : uint8_t
+	{
+		Overflow, NoOverflow, Below, AboveEqual, Equal, NotEqual, BelowEqual, Above,
+		Sign, NoSign, Parity, NoParity, Less, GreaterEqual, LessEqual, Greater
+	};
+
+	struct Mem
+	{
+		Reg Base;
+		int32_t Disp;
+	};
+
+	class Assembler
+	{
+	public:
+		using Label = size_t;
+
+		Label NewLabel();
+		void Bind(Label label);
+
+		// 64-bit operations unless wide is false; 32-bit ones zero the upper half
+		void Mov(Reg dst, Reg src, bool wide = true);
+		void Mov(Reg dst, Mem src, bool wide = true);
+		void Mov(Mem dst, Reg src, bool wide = true);
+		void Mov(Mem dst, int32_t imm);						// Sign-extended to 64 bits
+		void Mov(Reg dst, int64_t imm);
+		void MovByte(Mem dst, uint8_t imm);
+		void Movsxd(Reg dst, Reg src);
+		void Movsxd(Reg dst, Mem src);
+		void Lea(Reg dst, Mem src);
+
+		void Add(Reg dst, Mem src, bool wide = true);
+		void Sub(Reg dst, Mem src, bool wide = true);
+		void Imul(Reg dst, Mem src, bool wide = true);
+		void Cmp(Reg left, Mem right, bool wide = true);
+		void Cmp(Reg left, Reg right, bool wide = true);
+		void Cmp(Mem left, int32_t imm, bool wide = true);
+		void CmpByte(Mem left, uint8_t imm);
+		void Test(Reg left, Reg right, bool wide = true);
+		void Neg(Reg reg, bool wide = true);
+		void Inc(Reg reg, bool wide = true);
+		void Dec(Reg reg, bool wide = true);
+		void SignExtendAccumulator(bool wide = true);		// cdq or cqo before a division
+		void Idiv(Reg divisor, bool wide = true);
+		void Setcc(Condition condition, Reg dst);			// Low byte of dst, which must be below RSP
+		void MovzxByte(Reg dst, Reg src);
+
+		void Push(Reg reg);
+		void Pop(Reg reg);
+		void Jmp(Label label);
+		void Jcc(Condition condition, Label label);
+		void Call(Label label);
+		void Ret();
+		void Leave();
+
+		size_t GetSize() const { return code.size(); }
+		// Code with the jumps patched; every label they use must be bound
+		const std::vector<uint8_t>& Finish();
+
+	private:
+		void Byte(uint8_t value) { code.push_back(value); }
+		void Int32(int32_t value);
+		void Rex(bool wide, uint8_t reg, uint8_t base);
+		void ModRm(uint8_t reg, Mem mem);
+		void ModRm(uint8_t reg, Reg rm);
+		void Instr(uint8_t opcode, uint8_t reg, Mem mem, bool wide);
+		void Instr(uint8_t opcode, uint8_t reg, Reg rm, bool wide);
+		void Relative(Label label);
+
+		std::vector<uint8_t> code;
+		std::vector<size_t> labels;							// Label -> offset
+		std::vector<std::pair<size_t, Label>> fixups;		// Offset of a rel32 -> its label
+	};
+}
@@ -0,0 +1,62 @@
+#include <cstring>
+#include "ExecutableMemory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+ExecutableMemory::~ExecutableMemory()
+{
+	Release();
+}
+
+bool ExecutableMemory::Assign(const std::vector<uint8_t>& code)
+{
+	Release();
+	if (code.empty())
+		return false;
+
+#ifdef _WIN32
+	const auto pages = VirtualAlloc(nullptr, code.size(), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (pages == nullptr)
+		return false;
+	std::memcpy(pages, code.data(), code.size());
+	DWORD oldProtection;
+	if (!VirtualProtect(pages, code.size(), PAGE_EXECUTE_READ, &oldProtection))
+	{
+		VirtualFree(pages, 0, MEM_RELEASE);
+		return false;
+	}
+	FlushInstructionCache(GetCurrentProcess(), pages, code.size());
+#else
+	const auto pages = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (pages == MAP_FAILED)
+		return false;
+	std::memcpy(pages, code.data(), code.size());
+	if (mprotect(pages, code.size(), PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(pages, code.size());
+		return false;
+	}
+#endif
+	data = static_cast<uint8_t*>(pages);
+	size = code.size();
+	return true;
+}
+
+void ExecutableMemory::Release()
+{
+	if (data == nullptr)
+		return;
+#ifdef _WIN32
+	VirtualFree(data, 0, MEM_RELEASE);
+#else
+	munmap(data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Pages holding generated code. They are writable only while the code is copied in
+// and executable only after that.
+class ExecutableMemory
+{
+public:
+	ExecutableMemory() = default;
+	ExecutableMemory(const ExecutableMemory&) = delete;
+	ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+	~ExecutableMemory();
+
+	// False if the system refuses executable pages
+	bool Assign(const std::vector<uint8_t>& code);
+	const uint8_t* GetData() const { return data; }
+
+private:
+	void Release();
+
+	uint8_t* data = nullptr;
+	size_t size = 0;
+};
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cstddef>
+#include "JitCompiler.h"
+#include "Semantics/Operations.h"
+
+using namespace X64;
+
+namespace
+{
+	// Registers that hold the same value in every generated frame
+	const Reg CONTEXT = RBX;
+	const Reg GLOBALS = R12;
+	const Reg GLOBALS_ASSIGNED = R13;
+	const Reg CALL_DEPTH = R14;
+	const Reg STACK_LIMIT = R15;
+	const Reg ARGS = RSI;									// First argument of a call, the next ones are below it
+
+#ifdef _WIN32
+	const Reg ENTRY_ARG = RCX;
+#else
+	const Reg ENTRY_ARG = RDI;
+#endif
+	// Callee-saved registers of both conventions
+	const Reg SAVED_REGS[] = { RBP, RBX, R12, R13, R14, R15, RSI, RDI };
+
+	Mem Field(size_t offset) { return { CONTEXT, static_cast<int32_t>(offset) }; }
+
+	bool IsComparison(OpCode code)
+	{
+		return (code >= OpCode::EqualInt && code <= OpCode::GreaterEqualInt)
+			|| (code >= OpCode::EqualLong && code <= OpCode::GreaterEqualLong);
+	}
+
+	bool IsLong(OpCode code)
+	{
+		return (code >= OpCode::AddLong && code <= OpCode::GreaterEqualLong)
+			|| (code >= OpCode::MinusLong && code <= OpCode::DecLong);
+	}
+
+	Condition GetCondition(OpCode code)
+	{
+		const auto first = IsLong(code) ? OpCode::EqualLong : OpCode::EqualInt;
+		static const Condition conditions[] = { Equal, NotEqual, Greater, Less, LessEqual, GreaterEqual };
+		return conditions[static_cast<int>(code) - static_cast<int>(first)];
+	}
+
+	Condition Negate(Condition condition)
+	{
+		return static_cast<Condition>(condition ^ 1);
+	}
+}
+
+JitCompiler::JitCompiler(const BytecodeProgram& program)
+	: program(program)
+{}
+
+std::vector<uint8_t> JitCompiler::Compile()
+{
+#ifndef JIT_SUPPORTED
+	return {};
+#else
+	for (const auto& func : program.Functions)
+	{
+		stackDepths.push_back(GetStackDepths(program, func));
+		const auto& depths = stackDepths.back();
+		const auto maxDepth = *std::max_element(depths.begin(), depths.end());
+		const auto slots = 2 * func.LocalsCount + static_cast<size_t>(std::max(maxDepth, 0)) + 1;
+		frameSizes.push_back(static_cast<int32_t>((slots * 8 + 15) / 16 * 16));
+		functionLabels.push_back(assembler.NewLabel());
+	}
+	failLabel = assembler.NewLabel();
+
+	EmitEntry();
+	for (size_t i = 0; i < program.Functions.size(); i++)
+		if (!CompileFunction(i))
+			return {};
+	EmitStubs();
+	return assembler.Finish();
+#endif
+}
+
+void JitCompiler::EmitEntry()
+{
+	for (const auto reg : SAVED_REGS)
+		assembler.Push(reg);
+	assembler.Mov(CONTEXT, ENTRY_ARG);
+	assembler.Mov(Field(offsetof(JitContext, EntryStack)), RSP);
+	assembler.Mov(GLOBALS, Field(offsetof(JitContext, Globals)));
+	assembler.Mov(GLOBALS_ASSIGNED, Field(offsetof(JitContext, GlobalsAssigned)));
+	assembler.Mov(CALL_DEPTH, static_cast<int64_t>(0));
+	assembler.Mov(STACK_LIMIT, Field(offsetof(JitContext, StackLimit)));
+	assembler.Call(functionLabels.front());
+	assembler.Mov(RAX, static_cast<int64_t>(NativeError::None));
+
+	const auto exitLabel = assembler.NewLabel();
+	assembler.Bind(exitLabel);
+	for (auto reg = std::end(SAVED_REGS); reg != std::begin(SAVED_REGS); )
+		assembler.Pop(*--reg);
+	assembler.Ret();
+
+	assembler.Bind(failLabel);								// RAX holds the error
+	assembler.Mov(RSP, Field(offsetof(JitContext, EntryStack)));
+	assembler.Jmp(exitLabel);
+}
+
+void JitCompiler::EmitStubs()
+{
+	for (const auto& stub : stubs)
+	{
+		assembler.Bind(stub.Label);
+		assembler.Mov(Field(offsetof(JitContext, ErrorPosition)), static_cast<int32_t>(stub.Position));
+		assembler.Mov(Field(offsetof(JitContext, ErrorIndex)), static_cast<int32_t>(stub.Index));
+		if (stub.Kind == NativeError::StackOverflow)
+		{
+			assembler.Lea(RAX, { CALL_DEPTH, 1 });
+			assembler.Mov(Field(offsetof(JitContext, ErrorDepth)), RAX);
+		}
+		assembler.Mov(RAX, static_cast<int64_t>(stub.Kind));
+		assembler.Jmp(failLabel);
+	}
+}
+
+Assembler::Label JitCompiler::AddStub(NativeError kind, uint64_t index, size_t position)
+{
+	const auto label = assembler.NewLabel();
+	stubs.push_back({ label, kind, index, position });
+	return label;
+}
+
+Mem JitCompiler::Local(size_t slot) const
+{
+	return { RBP, -8 * static_cast<int32_t>(slot + 1) };
+}
+
+Mem JitCompiler::Operand(int depth) const
+{
+	return Local(operandsBase + static_cast<size_t>(depth));
+}
+
+Mem JitCompiler::Flag(size_t slot) const
+{
+	return Local(flagsBase + slot);
+}
+
+bool JitCompiler::CompileFunction(size_t index)
+{
+	function = &program.Functions[index];
+	const auto& code = function->Code;
+	const auto& depths = stackDepths[index];
+	operandsBase = function->LocalsCount;
+	flagsBase = frameSizes[index] / 8 - function->LocalsCount;
+
+	std::vector<Assembler::Label> labels(code.size());
+	std::vector<bool> isTarget(code.size());
+	std::vector<bool> isChecked(function->LocalsCount);		// Only these slots keep their flags
+	for (size_t ip = 0; ip < code.size(); ip++)
+	{
+		labels[ip] = assembler.NewLabel();
+		const auto op = code[ip].Op;
+		if (op == OpCode::Jump || op == OpCode::JumpIfZero || op == OpCode::JumpIfNotZero)
+			isTarget[code[ip].A] = true;
+		else if (op == OpCode::ClearLocal)
+			isChecked[code[ip].A] = true;
+	}
+
+	assembler.Bind(functionLabels[index]);
+	assembler.Push(RBP);
+	assembler.Mov(RBP, RSP);
+	assembler.Lea(RSP, { RSP, -frameSizes[index] });
+	for (size_t i = 0; i < function->ParamsCount; i++)
+	{
+		assembler.Mov(RAX, Mem{ ARGS, -8 * static_cast<int32_t>(i) });
+		assembler.Mov(Local(i), RAX);
+	}
+
+	for (size_t ip = 0; ip < code.size(); ip++)
+	{
+		assembler.Bind(labels[ip]);
+		const auto depth = depths[ip];
+		if (depth < 0)
+			continue;
+
+		const auto& instr = code[ip];
+		const auto position = function->Positions[ip];
+		switch (instr.Op)
+		{
+		case OpCode::Const:
+			if (instr.B >= INT32_MIN && instr.B <= INT32_MAX)
+				assembler.Mov(Operand(depth), static_cast<int32_t>(instr.B));
+			else
+			{
+				assembler.Mov(RAX, instr.B);
+				assembler.Mov(Operand(depth), RAX);
+			}
+			break;
+
+		case OpCode::LoadLocalChecked:
+			assembler.Cmp(Flag(instr.A), 0);
+			assembler.Jcc(Equal, AddStub(NativeError::Program, static_cast<uint64_t>(instr.B), position));
+			// fallthrough
+		case OpCode::LoadLocal:
+			assembler.Mov(RAX, Local(instr.A));
+			assembler.Mov(Operand(depth), RAX);
+			break;
+
+		case OpCode::StoreLocal:
+			assembler.Mov(RAX, Operand(depth - 1));
+			assembler.Mov(Local(instr.A), RAX);
+			if (isChecked[instr.A])
+				assembler.Mov(Flag(instr.A), 1);
+			break;
+
+		case OpCode::ClearLocal:
+			assembler.Mov(Flag(instr.A), 0);
+			break;
+
+		case OpCode::LoadGlobalChecked:
+			assembler.CmpByte({ GLOBALS_ASSIGNED, static_cast<int32_t>(instr.A) }, 0);
+			assembler.Jcc(Equal, AddStub(NativeError::Program, static_cast<uint64_t>(instr.B), position));
+			// fallthrough
+		case OpCode::LoadGlobal:
+			assembler.Mov(RAX, Mem{ GLOBALS, 8 * static_cast<int32_t>(instr.A) });
+			assembler.Mov(Operand(depth), RAX);
+			break;
+
+		case OpCode::StoreGlobal:
+			assembler.Mov(RAX, Operand(depth - 1));
+			assembler.Mov(Mem{ GLOBALS, 8 * static_cast<int32_t>(instr.A) }, RAX);
+			assembler.MovByte({ GLOBALS_ASSIGNED, static_cast<int32_t>(instr.A) }, 1);
+			break;
+
+		case OpCode::Dup:
+			assembler.Mov(RAX, Operand(depth - 1));
+			assembler.Mov(Operand(depth), RAX);
+			break;
+
+		case OpCode::Pop:
+			break;
+
+		case OpCode::ToInt:
+			assembler.Movsxd(RAX, Operand(depth - 1));
+			assembler.Mov(Operand(depth - 1), RAX);
+			break;
+
+		case OpCode::Jump:
+			assembler.Jmp(labels[instr.A]);
+			break;
+
+		case OpCode::JumpIfZero: case OpCode::JumpIfNotZero:
+			assembler.Mov(RAX, Operand(depth - 1));
+			assembler.Test(RAX, RAX);
+			assembler.Jcc(instr.Op == OpCode::JumpIfZero ? Equal : NotEqual, labels[instr.A]);
+			break;
+
+		case OpCode::Call:
+			EmitCall(instr.A, ip, depth);
+			break;
+
+		case OpCode::Return:
+			assembler.Leave();
+			assembler.Ret();
+			break;
+
+		case OpCode::Fail:
+			assembler.Jmp(AddStub(NativeError::Program, instr.A, position));
+			break;
+
+		default:
+			if (IsComparison(instr.Op) && ip + 1 < code.size() && !isTarget[ip + 1]
+				&& (code[ip + 1].Op == OpCode::JumpIfZero || code[ip + 1].Op == OpCode::JumpIfNotZero))
+			{
+				// The condition of a loop jumps on the flags of the comparison
+				const auto condition = GetCondition(instr.Op);
+				assembler.Mov(RAX, Operand(depth - 2));
+				assembler.Cmp(RAX, Operand(depth - 1));
+				const auto& jump = code[++ip];
+				assembler.Bind(labels[ip]);
+				assembler.Jcc(jump.Op == OpCode::JumpIfZero ? Negate(condition) : condition, labels[jump.A]);
+			}
+			else if (instr.Op >= OpCode::AddInt && instr.Op <= OpCode::GreaterEqualLong)
+			{
+				const auto isDivision = instr.Op == OpCode::DivInt || instr.Op == OpCode::ModulInt
+					|| instr.Op == OpCode::DivLong || instr.Op == OpCode::ModulLong;
+				EmitBinary(instr.Op, depth, isDivision ? AddStub(NativeError::DivisionOnZero, 0, position) : 0);
+			}
+			else if (instr.Op >= OpCode::MinusInt && instr.Op <= OpCode::DecLong)
+				EmitPrefix(instr.Op, depth);
+			else
+				return false;
+			break;
+		}
+	}
+	return true;
+}
+
+void JitCompiler::EmitCall(size_t index, size_t ip, int depth)
+{
+	const auto& callee = program.Functions[index];
+	const auto overflowStub = AddStub(NativeError::StackOverflow, index, function->Positions[ip]);
+	assembler.Cmp(CALL_DEPTH, Field(offsetof(JitContext, MaxCallDepth)));
+	assembler.Jcc(AboveEqual, overflowStub);
+	assembler.Lea(RAX, { RSP, -(frameSizes[index] + 64) });
+	assembler.Cmp(RAX, STACK_LIMIT);
+	assembler.Jcc(Below, overflowStub);
+
+	if (callee.ParamsCount > 0)
+		assembler.Lea(ARGS, Operand(depth - static_cast<int>(callee.ParamsCount)));
+	assembler.Inc(CALL_DEPTH);
+	assembler.Call(functionLabels[index]);
+	assembler.Dec(CALL_DEPTH);
+}
+
+void JitCompiler::EmitBinary(OpCode code, int depth, Assembler::Label divisionStub)
+{
+	const auto wide = IsLong(code);
+	const auto left = Operand(depth - 2), right = Operand(depth - 1);
+	const auto first = wide ? OpCode::AddLong : OpCode::AddInt;
+	const auto operation = static_cast<BinaryOpCode>(static_cast<int>(code) - static_cast<int>(first));
+
+	switch (operation)
+	{
+	case BinaryOpCode::Add:
+	case BinaryOpCode::Sub:
+	case BinaryOpCode::Mul:
+		assembler.Mov(RAX, left, wide);
+		if (operation == BinaryOpCode::Add)
+			assembler.Add(RAX, right, wide);
+		else if (operation == BinaryOpCode::Sub)
+			assembler.Sub(RAX, right, wide);
+		else
+			assembler.Imul(RAX, right, wide);
+		break;
+
+	case BinaryOpCode::Div:
+	case BinaryOpCode::Modul:
+		assembler.Mov(RCX, right, wide);
+		assembler.Test(RCX, RCX, wide);
+		assembler.Jcc(Equal, divisionStub);
+		assembler.Mov(RAX, left, wide);
+		assembler.SignExtendAccumulator(wide);
+		assembler.Idiv(RCX, wide);
+		if (operation == BinaryOpCode::Modul)
+			assembler.Mov(RAX, RDX, wide);
+		break;
+
+	default:
+		assembler.Mov(RAX, left);
+		assembler.Cmp(RAX, right);
+		assembler.Setcc(GetCondition(code), RAX);
+		assembler.MovzxByte(RAX, RAX);
+		assembler.Mov(left, RAX);
+		return;
+	}
+	if (!wide)
+		assembler.Movsxd(RAX, RAX);
+	assembler.Mov(left, RAX);
+}
+
+void JitCompiler::EmitPrefix(OpCode code, int depth)
+{
+	const auto wide = IsLong(code);
+	const auto operand = Operand(depth - 1);
+	assembler.Mov(RAX, operand, wide);
+	if (code == OpCode::MinusInt || code == OpCode::MinusLong)
+		assembler.Neg(RAX, wide);
+	else if (code == OpCode::IncInt || code == OpCode::IncLong)
+		assembler.Inc(RAX, wide);
+	else
+		assembler.Dec(RAX, wide);
+	if (!wide)
+		assembler.Movsxd(RAX, RAX);
+	assembler.Mov(operand, RAX);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Assembler.h"
+#include "Bytecode/Bytecode.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED
+#endif
+
+// State the generated code shares with the machine that runs it
+struct JitContext
+{
+	int64_t* Globals;
+	uint8_t* GlobalsAssigned;
+	uint64_t MaxCallDepth;
+	uintptr_t StackLimit;					// Calls must leave the native stack above it, 0 if it is unknown
+	uintptr_t EntryStack;					// Stack pointer an error unwinds to
+	uint64_t ErrorPosition;
+	uint64_t ErrorIndex;					// Error of the program or function that overflowed the stack
+	uint64_t ErrorDepth;
+};
+
+// Translates bytecode to x86-64 code run as `NativeError entry(JitContext*)`.
+// Every function keeps its locals and operands in a native frame at offsets the stack depth of
+// each instruction fixes, so operations read and write memory and nothing is dispatched.
+// Errors do not throw through generated frames: they record themselves in the context and
+// return from the entry with the native stack unwound in one move.
+class JitCompiler
+{
+public:
+	explicit JitCompiler(const BytecodeProgram& program);
+
+	// Empty if this target or an instruction of the program is not supported
+	std::vector<uint8_t> Compile();
+
+private:
+	struct Stub
+	{
+		X64::Assembler::Label Label;
+		NativeError Kind;
+		uint64_t Index;
+		size_t Position;
+	};
+
+	bool CompileFunction(size_t index);
+	void EmitEntry();
+	void EmitStubs();
+	void EmitCall(size_t index, size_t ip, int depth);
+	void EmitBinary(OpCode code, int depth, X64::Assembler::Label divisionStub);
+	void EmitPrefix(OpCode code, int depth);
+	X64::Assembler::Label AddStub(NativeError kind, uint64_t index, size_t position);
+
+	X64::Mem Local(size_t slot) const;
+	X64::Mem Operand(int depth) const;
+	X64::Mem Flag(size_t slot) const;
+
+	const BytecodeProgram& program;
+	X64::Assembler assembler;
+	X64::Assembler::Label failLabel = 0;
+	std::vector<X64::Assembler::Label> functionLabels;
+	std::vector<std::vector<int>> stackDepths;
+	std::vector<int32_t> frameSizes;
+	std::vector<Stub> stubs;
+
+	const BytecodeFunction* function = nullptr;				// Function being compiled
+	size_t operandsBase = 0;
+	size_t flagsBase = 0;
+};
@@ -0,0 +1,41 @@
+#include "JitMachine.h"
+#include "JitCompiler.h"
+
+JitMachine::JitMachine(const BytecodeProgram& program, size_t maxCallDepth, std::uintptr_t stackLimit)
+	: program(program), maxCallDepth(maxCallDepth), stackLimit(stackLimit),
+	globals(program.Globals.size()), globalsAssigned(program.Globals.size())
+{}
+
+bool JitMachine::Compile()
+{
+	const auto code = JitCompiler(program).Compile();
+	if (!memory.Assign(code))
+		return false;
+	codeSize = code.size();
+	return true;
+}
+
+void JitMachine::Run()
+{
+	JitContext context{ globals.data(), globalsAssigned.data(), maxCallDepth, stackLimit, 0, 0, 0, 0 };
+	const auto entry = reinterpret_cast<NativeError(*)(JitContext*)>(const_cast<uint8_t*>(memory.GetData()));
+	const auto error = entry(&context);
+	if (error == NativeError::None)
+		return;
+
+	errorPosition = static_cast<size_t>(context.ErrorPosition);
+	ThrowNativeError(program, error, context.ErrorIndex, context.ErrorDepth);
+}
+
+DataValue JitMachine::GetGlobal(size_t index) const
+{
+	if (program.Globals[index].Type == DataType::Long)
+		return DataValue(static_cast<long long>(globals[index]));
+	return DataValue(static_cast<int>(globals[index]));
+}
+
+void JitMachine::SetGlobal(size_t index, DataValue value)
+{
+	globals[index] = value.type == DataType::Long ? value.longVal : value.intVal;
+	globalsAssigned[index] = 1;
+}
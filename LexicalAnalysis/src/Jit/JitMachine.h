@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ExecutableMemory.h"
+#include "Bytecode/Bytecode.h"
+#include "Semantics/Node/DataValue.h"
+
+// Runs a bytecode program as native code, with the interface of the virtual machine.
+// Globals are a fixed table the code addresses through a register, so they are filled
+// and read back by the owner as they are for the virtual machine.
+class JitMachine
+{
+public:
+	// stackLimit is the lowest address calls may take the native stack to, 0 if it is unknown
+	JitMachine(const BytecodeProgram& program, size_t maxCallDepth, std::uintptr_t stackLimit);
+
+	// False if the program cannot run as native code here
+	bool Compile();
+	void Run();
+
+	DataValue GetGlobal(size_t index) const;
+	void SetGlobal(size_t index, DataValue value);
+	bool IsGlobalAssigned(size_t index) const { return globalsAssigned[index] != 0; }
+
+	size_t GetErrorPosition() const { return errorPosition; }
+	size_t GetCodeSize() const { return codeSize; }
+
+private:
+	const BytecodeProgram& program;
+	size_t maxCallDepth;
+	std::uintptr_t stackLimit;
+
+	ExecutableMemory memory;
+	size_t codeSize = 0;
+
+	std::vector<int64_t> globals;
+	std::vector<uint8_t> globalsAssigned;
+	size_t errorPosition = 0;
+};
@@ -1,14 +1,14 @@
 ﻿#pragma once
 #include <string>
 
-#include "SourceText.h"
 #include "Types/LexemeType.h"
 
 struct Lexeme
 {
-	Lexeme() :type(LexemeType::Err) {}
+	Lexeme() :type(LexemeType::Err), row(0), column(0), endColumn(0) {}
 	std::string str;
 	LexemeType type;
-	SourceText::Iterator pos;
+	size_t row, column;
+	size_t endColumn;							// Column right after it, where errors are reported
 };
 
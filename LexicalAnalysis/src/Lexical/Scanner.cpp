@@ -12,65 +12,92 @@ std::unordered_map<std::string, LexemeType> Scanner::keywords = {
 
 Scanner::Scanner(const std::istream& sourceStream)
 {
-	InputSourceText(sourceStream);
-	curPos = sourceText.begin();
+	std::stringstream sb;
+	sb << sourceStream.rdbuf();
+	ScanLexemes(sb.str());
 }
 
-void Scanner::InputSourceText(const std::istream& sourceStream)
+Scanner::Scanner(std::string source)
+{
+	ScanLexemes(std::move(source));
+}
+
+Scanner::Scanner(std::vector<Lexeme> lexemes) :lexemes(std::move(lexemes))
+{
+	if (this->lexemes.empty() || this->lexemes.back().type != LexemeType::End)
+	{
+		Lexeme end;
+		end.type = LexemeType::End;
+		this->lexemes.push_back(end);
+	}
+}
+
+void Scanner::ScanLexemes(std::string source)
 {
-	std::stringstream sb;
-	sb << sourceStream.rdbuf();
-	auto source = sb.str();
 	source.push_back(0);
-	sourceText = source;
+	sourceText = std::move(source);
+	curChar = sourceText.begin();
+	do
+	{
+		ScanLexeme();
+		lexemes.push_back(_lexeme);
+	} while (_lexeme.type != LexemeType::End);
 }
 
 
 
-Lexeme Scanner::LookForward(int k)
+const Lexeme& Scanner::NextScan()
 {
-	auto savePos = curPos;
-	for (int i = 0; i < k - 1; i++)
-		NextScan();
-	auto lexeme = NextScan();
-	curPos = savePos;
+	const auto& lexeme = LookForward(1);
+	if (curPos < lexemes.size())
+		++curPos;							// Once past End, which is then the last scanned lexeme
 	return lexeme;
 }
 
+const Lexeme& Scanner::LookForward(int k) const
+{
+	const auto pos = curPos + k - 1;
+	return pos < lexemes.size() ? lexemes[pos] : lexemes.back();
+}
+
+const Lexeme& Scanner::GetLastLexeme() const
+{
+	return lexemes[curPos > 0 ? curPos - 1 : 0];
+}
+
 
 
 void Scanner::Scan(std::ostream& out)
 {
-	while (_lexeme.type != LexemeType::End) {
-		SourceText::Iterator savePos;
-		NextScan();
+	for (const auto& lexeme : lexemes) {
 		out.width(9);
 		out.flags(out.left);
-		out << _lexeme.str << LexemeTypeToString(_lexeme.type) << " " << _lexeme.pos.row << ' ' << _lexeme.pos.column << std::endl;
+		out << lexeme.str << LexemeTypeToString(lexeme.type) << " " << lexeme.row << ' ' << lexeme.column << std::endl;
 	}
 
 }
 
 
-Lexeme Scanner::NextScan()
+void Scanner::ScanLexeme()
 {
 	_lexeme.str.clear();
 	_lexeme.str.reserve(MAX_LEXEME_SIZE);
 
 	SkipIgnoreChars();
-	_lexeme.pos = curPos;
+	_lexeme.row = curChar.row;
+	_lexeme.column = curChar.column;
 
-	if (*curPos == 0) {
+	if (*curChar == 0) {
 		_lexeme.type = LexemeType::End;
 	}
 
-	else if ('a' <= *curPos && *curPos <= 'z' ||
-		'A' <= *curPos && *curPos <= 'Z' || '_' == *curPos)
+	else if ('a' <= *curChar && *curChar <= 'z' ||
+		'A' <= *curChar && *curChar <= 'Z' || '_' == *curChar)
 		HandleStringWord();
-	else if ('1' <= *curPos && *curPos <= '9')
+	else if ('1' <= *curChar && *curChar <= '9')
 		HandleDecNum();
 	else {
-		switch (*curPos)
+		switch (*curChar)
 		{
 		case '0':
 			HandleHexOrOctNum();
@@ -134,19 +161,18 @@ Lexeme Scanner::NextScan()
 			_lexeme.type = LexemeType::Err;
 		}
 	}
-
-	return _lexeme;
+	_lexeme.endColumn = curChar.column;
 }
 
 
 void Scanner::SkipIgnoreChars()
 {
-	while (curPos != sourceText.end())
+	while (curChar != sourceText.end())
 	{
-		switch (*curPos)
+		switch (*curChar)
 		{
 		case '/': {
-			auto tmpPos = curPos;
+			auto tmpPos = curChar;
 			++tmpPos;
 			if (*tmpPos != '/')
 				return;
@@ -154,7 +180,7 @@ void Scanner::SkipIgnoreChars()
 			break;
 		}
 		case '\n': case '\r': case '\t': case ' ':
-			++curPos;
+			++curChar;
 			break;
 		default:
 			return;
@@ -164,18 +190,18 @@ void Scanner::SkipIgnoreChars()
 
 void Scanner::SkipComment()
 {
-	++curPos;
-	while (*curPos != 0 && *curPos != '\n')
-		++curPos;
+	++curChar;
+	while (*curChar != 0 && *curChar != '\n')
+		++curChar;
 }
 
 void Scanner::HandleStringWord()
 {
 	NextChar();
-	while ('a' <= *curPos && *curPos <= 'z'
-		|| 'A' <= *curPos && *curPos <= 'Z'
-		|| '0' <= *curPos && *curPos <= '9'
-		|| '_' == *curPos)
+	while ('a' <= *curChar && *curChar <= 'z'
+		|| 'A' <= *curChar && *curChar <= 'Z'
+		|| '0' <= *curChar && *curChar <= '9'
+		|| '_' == *curChar)
 	{
 		if (!NextChar()) {
 			HandleErrWord();
@@ -192,12 +218,12 @@ void Scanner::HandleStringWord()
 void Scanner::HandleDecNum()
 {
 	NextChar();
-	while ('0' <= *curPos && *curPos <= '9')
+	while ('0' <= *curChar && *curChar <= '9')
 		if (!NextChar())
 			return HandleErrWord();
-	if (*curPos == 'l' || *curPos == 'L')
+	if (*curChar == 'l' || *curChar == 'L')
 		NextChar();
-	if ('a' <= *curPos && *curPos <= 'z' || 'A' <= *curPos && *curPos <= 'Z' || '_' == *curPos)
+	if ('a' <= *curChar && *curChar <= 'z' || 'A' <= *curChar && *curChar <= 'Z' || '_' == *curChar)
 		return HandleErrWord();
 
 	_lexeme.type = LexemeType::DecimNum;
@@ -206,7 +232,7 @@ void Scanner::HandleDecNum()
 void Scanner::HandleHexOrOctNum()
 {
 	NextChar();
-	if (*curPos == 'X' || *curPos == 'x')
+	if (*curChar == 'X' || *curChar == 'x')
 		return HandleHexNum();
 	return HandleOctNum();
 }
@@ -214,14 +240,14 @@ void Scanner::HandleHexOrOctNum()
 void Scanner::HandleHexNum()
 {
 	NextChar();
-	if (!('0' <= *curPos && *curPos <= '9' || 'a' <= *curPos && *curPos <= 'f' || 'A' <= *curPos && *curPos <= 'F'))
+	if (!('0' <= *curChar && *curChar <= '9' || 'a' <= *curChar && *curChar <= 'f' || 'A' <= *curChar && *curChar <= 'F'))
 		return HandleErrWord();
-	while ('0' <= *curPos && *curPos <= '9' || 'a' <= *curPos && *curPos <= 'f' || 'A' <= *curPos && *curPos <= 'F')
+	while ('0' <= *curChar && *curChar <= '9' || 'a' <= *curChar && *curChar <= 'f' || 'A' <= *curChar && *curChar <= 'F')
 		if (!NextChar())
 			return HandleErrWord();
-	if (*curPos == 'l' || *curPos == 'L')
+	if (*curChar == 'l' || *curChar == 'L')
 		NextChar();
-	if ('f' < *curPos && *curPos <= 'z' || 'F' < *curPos && *curPos <= 'Z' || '_' == *curPos)
+	if ('f' < *curChar && *curChar <= 'z' || 'F' < *curChar && *curChar <= 'Z' || '_' == *curChar)
 		return HandleErrWord();
 
 	_lexeme.type = LexemeType::HexNum;
@@ -229,12 +255,12 @@ void Scanner::HandleHexNum()
 
 void Scanner::HandleOctNum()
 {
-	while ('0' <= *curPos && *curPos <= '7')
+	while ('0' <= *curChar && *curChar <= '7')
 		if (!NextChar())
 			return HandleErrWord();
-	if (*curPos == 'l' || *curPos == 'L')
+	if (*curChar == 'l' || *curChar == 'L')
 		NextChar();
-	if ('a' <= *curPos && *curPos <= 'z' || 'A' <= *curPos && *curPos <= 'Z' || '8' <= *curPos && *curPos <= '9' || '_' == *curPos)
+	if ('a' <= *curChar && *curChar <= 'z' || 'A' <= *curChar && *curChar <= 'Z' || '8' <= *curChar && *curChar <= '9' || '_' == *curChar)
 		return HandleErrWord();
 
 	_lexeme.type = LexemeType::OctNum;
@@ -242,8 +268,8 @@ void Scanner::HandleOctNum()
 
 void Scanner::HandleErrWord()
 {
-	while ('a' <= *curPos && *curPos <= 'z' || 'A' <= *curPos && *curPos <= 'Z'
-		|| '0' <= *curPos && *curPos <= '9' || '_' == *curPos)
+	while ('a' <= *curChar && *curChar <= 'z' || 'A' <= *curChar && *curChar <= 'Z'
+		|| '0' <= *curChar && *curChar <= '9' || '_' == *curChar)
 	{
 		NextChar();
 	}
@@ -253,7 +279,7 @@ void Scanner::HandleErrWord()
 void Scanner::HandleDoubleChar(LexemeType firstLexeme, char nextChar, LexemeType secondLexeme)
 {
 	NextChar();
-	if (*curPos == nextChar)
+	if (*curChar == nextChar)
 	{
 		NextChar();
 		_lexeme.type = secondLexeme;
@@ -266,7 +292,7 @@ bool Scanner::NextChar()
 {
 	const bool isLexemeOverflow = _lexeme.str.size() > MAX_LEXEME_SIZE;
 	if (!isLexemeOverflow)
-		_lexeme.str.push_back(*curPos);
-	++curPos;
+		_lexeme.str.push_back(*curChar);
+	++curChar;
 	return !isLexemeOverflow;
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <iomanip>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include "Lexeme.h"
 #include "SourceText.h"
 
@@ -10,12 +11,18 @@ class Scanner
 {
 public:
 	explicit Scanner(const std::istream& sourceStream);
+	explicit Scanner(std::string source);
+	explicit Scanner(std::vector<Lexeme> lexemes);
 	void Scan(std::ostream& out);
-	Lexeme NextScan();
-	Lexeme LookForward(int k);
-	SourceText::Iterator GetCurPos() { return curPos; }
-	void SetCurPos(SourceText::Iterator pos) { curPos = pos; }
+	const Lexeme& NextScan();
+	const Lexeme& LookForward(int k) const;
+	const Lexeme& GetLastLexeme() const;
+	const std::vector<Lexeme>& GetLexemes() const { return lexemes; }
+	size_t GetCurPos() const { return curPos; }
+	void SetCurPos(size_t pos) { curPos = pos; }
 private:
+	void ScanLexemes(std::string source);
+	void ScanLexeme();
 	void SkipIgnoreChars();
 	void SkipComment();
 
@@ -28,12 +35,14 @@ private:
 	void HandleDoubleChar(LexemeType firstLexeme, char nextChar, LexemeType secondLexeme);
 
 	bool NextChar();
-	void InputSourceText(const std::istream& sourceStream);
 
 	SourceText sourceText;
-	SourceText::Iterator curPos;
+	SourceText::Iterator curChar;
 	Lexeme _lexeme;
 
+	std::vector<Lexeme> lexemes;
+	size_t curPos = 0;
+
 	static std::unordered_map<std::string, LexemeType> keywords;
 	static const int MAX_LEXEME_SIZE = 100;
 };
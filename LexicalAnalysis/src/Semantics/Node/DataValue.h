@@ -3,6 +3,7 @@
 #include <iostream>
 
 
+// Passed by value: 16 bytes, trivially copyable
 struct DataValue
 {
 	DataValue() = default;
@@ -12,18 +13,13 @@ struct DataValue
 	DataValue(long long value) :type(DataType::Long), longVal(value)
 	{}
 
-	DataValue(const DataValue& value) : type(value.type)
-	{
-		longVal = value.longVal;
-	}
-
 	explicit DataValue(DataType type) :type(type), longVal(0)
 	{}
 
-	DataType type;
+	DataType type = DataType::Unknown;
 	union {
 		int intVal;
-		long long longVal;
+		long long longVal = 0;
 	};
 };
 
@@ -1,22 +1,9 @@
 ﻿#pragma once
-#include "Node.h"
 #include <iostream>
+#include <string>
 
-#include "Lexical/SourceText.h"
-
-class FuncData :public NodeData
+struct FuncData
 {
-public:
-	FuncData(std::string id) :NodeData(std::move(id)) {}
-
-	DataType GetDataType() const override { return DataType::Void; }
-
-	SemanticType GetSemanticType() const override { return SemanticType::Func; }
-
-	void Print(std::ostream& out) const override;
-
-	std::unique_ptr<NodeData> Clone() const override;
-
 	int ParamsCount = 0;
-	SourceText::Iterator Pos;
+	size_t Pos = 0;
 };
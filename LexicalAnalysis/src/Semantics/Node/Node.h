@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include <memory>
 #include <string>
+#include <type_traits>
 #include "NodeData.h"
 #include "Types/DataType.h"
 #include "Types/SemanticType.h"
@@ -8,21 +9,20 @@
 struct Node
 {
 	Node(Node* parent) :Parent(parent) {}
-	Node(Node* parent,std::unique_ptr<NodeData> data) :Parent(parent), Data(std::move(data)) {}
+	Node(Node* parent, const NodeData& data) :Parent(parent), Data(data) {}
 
-	void Print(std::ostream& out, int tabCount = 0) const;
-	void RecursivePrint(std::ostream& out, int tabCount = 0) const;
+	DataType GetDataType() const { return Data.GetDataType(); }
 
-	DataType GetDataType() const { return Data ? Data->GetDataType() : DataType::Unknown; }
-
-	SemanticType GetSemanticType() const { return Data ? Data->GetSemanticType() : SemanticType::Empty; }
-
-	std::unique_ptr<Node> Clone(Node* parent) const;
+	SemanticType GetSemanticType() const { return Data.GetSemanticType(); }
 
+	// Nodes and their data live in the arena of the tree and are released with it
 	Node* Parent = nullptr;
-	std::unique_ptr<Node> Siblink, Child;
-	std::unique_ptr<NodeData> Data;
+	Node* Siblink = nullptr;
+	Node* Child = nullptr;
+	NodeData Data;
 
 };
 
-std::ostream& operator<<(std::ostream& out, const Node& node);
+// Lets the arena free the tree without visiting its nodes
+static_assert(std::is_trivially_destructible<Node>::value, "Node must be trivially destructible");
+
@@ -0,0 +1,28 @@
+#include "NodeArena.h"
+
+NodeArena::~NodeArena()
+{
+	while (!destructors.empty())
+	{
+		const auto& destructor = destructors.back();
+		destructor.destroy(destructor.object);
+		destructors.pop_back();
+	}
+}
+
+void* NodeArena::Allocate(size_t size, size_t alignment)
+{
+	offset = (offset + alignment - 1) / alignment * alignment;
+	if (chunk == chunks.size() || offset + size > CHUNK_SIZE)
+	{
+		if (chunk < chunks.size())
+			++chunk;
+		if (chunk == chunks.size())
+			chunks.push_back(std::unique_ptr<char[]>(new char[CHUNK_SIZE]));
+		offset = 0;
+	}
+
+	const auto ptr = chunks[chunk].get() + offset;
+	offset += size;
+	return ptr;
+}
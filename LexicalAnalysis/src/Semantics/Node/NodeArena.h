@@ -0,0 +1,50 @@
+#pragma once
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Region allocator for the semantic tree.
+// Objects are bumped out of fixed-size chunks and live as long as the tree. Only objects with
+// non-trivial destructors are remembered, they are destroyed in reverse order of creation
+// without recursion.
+class NodeArena
+{
+public:
+	NodeArena() = default;
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator=(const NodeArena&) = delete;
+	~NodeArena();
+
+	template <class T, class... Args>
+	T* Create(Args&&... args)
+	{
+		static_assert(sizeof(T) <= CHUNK_SIZE, "object does not fit into arena chunk");
+		auto object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+			destructors.push_back({ object, &Destroy<T> });
+		return object;
+	}
+
+	size_t GetChunksCount() const { return chunks.size(); }
+
+	static const size_t CHUNK_SIZE = 64 * 1024;
+
+private:
+	struct Destructor
+	{
+		void* object;
+		void (*destroy)(void*);
+	};
+
+	template <class T>
+	static void Destroy(void* object) { static_cast<T*>(object)->~T(); }
+
+	void* Allocate(size_t size, size_t alignment);
+
+	std::vector<std::unique_ptr<char[]>> chunks;
+	size_t chunk = 0;
+	size_t offset = 0;
+	std::vector<Destructor> destructors;
+};
@@ -1,25 +1,39 @@
 ﻿#pragma once
 #include <string>
-#include <utility>
 
+#include "FuncData.h"
+#include "VarData.h"
 #include "Types/DataType.h"
 #include "Types/SemanticType.h"
 
+// Data of a node kept inline: variable, function or nothing, told apart by the semantic type.
+// Identifiers are interned by the tree, so the data is trivially copyable and destructible.
 class NodeData
 {
 public:
-	explicit NodeData(std::string identifier)
-		: Identifier(std::move(identifier)) {	}
+	NodeData() : Type(SemanticType::Empty), Identifier(nullptr) {}
 
-	virtual DataType GetDataType() const = 0;
+	NodeData(const std::string* identifier, const VarData& var)
+		: Type(SemanticType::Var), Identifier(identifier), Var(var) {}
 
-	virtual SemanticType GetSemanticType() const = 0;
+	NodeData(const std::string* identifier, const FuncData& func)
+		: Type(SemanticType::Func), Identifier(identifier), Func(func) {}
 
-	virtual std::unique_ptr<NodeData> Clone() const = 0;
+	SemanticType GetSemanticType() const { return Type; }
 
-	virtual void Print(std::ostream& out) const = 0;
+	DataType GetDataType() const
+	{
+		return Type == SemanticType::Var ? Var.Type
+			: Type == SemanticType::Func ? DataType::Void : DataType::Unknown;
+	}
 
-	std::string Identifier;
+	const std::string& GetIdentifier() const { return *Identifier; }
 
-	virtual ~NodeData() = default;
+	SemanticType Type;
+	const std::string* Identifier;
+	union
+	{
+		VarData Var;
+		FuncData Func;
+	};
 };
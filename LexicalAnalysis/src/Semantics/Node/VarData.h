@@ -1,34 +1,22 @@
 ﻿#pragma once
-#include "Node.h"
 #include <iostream>
-#include <utility>
+#include <string>
 
 #include "DataValue.h"
 #include "Types/DataType.h"
 
-class VarData : public NodeData
+struct VarData
 {
-public:
-
-	VarData(std::string id, DataType type)
-		: NodeData(std::move(id)),
-		Type(type),
+	explicit VarData(DataType type)
+		: Type(type),
 		IsInitialized(false)
 	{
 		SetDefaultValue(type);
 	}
 
-	DataType GetDataType() const override { return Type; }
-
-	SemanticType GetSemanticType() const override { return SemanticType::Var; }
-
-	void Print(std::ostream& out) const override;
-
-	std::unique_ptr<NodeData> Clone() const override;
-
 	void SetDefaultValue(DataType type);
 
 	DataType Type;
-	std::shared_ptr<DataValue> Value;
 	bool IsInitialized;
+	DataValue Value;
 };
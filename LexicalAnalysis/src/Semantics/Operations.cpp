@@ -0,0 +1,114 @@
+#include "Operations.h"
+
+#include <array>
+
+namespace
+{
+	using namespace Kernels;
+
+	template <class... Items> struct TypeList {};
+
+	// In the order of DataType and of the op codes
+	using NumericTypes = TypeList<int, long long>;
+	using BinaryOps = TypeList<Add, Sub, Mul, Div, Modul, Equal, NotEqual, Greater, Less, LessEqual, GreaterEqual>;
+	using PrefixOps = TypeList<Plus, Minus, Inc, Dec>;
+
+	const size_t NUMERIC_TYPES_COUNT = 2;
+	const size_t BINARY_OPS_COUNT = static_cast<size_t>(BinaryOpCode::Count);
+	const size_t PREFIX_OPS_COUNT = static_cast<size_t>(PrefixOpCode::Count);
+
+	using BinaryRow = std::array<BinaryOperation, BINARY_OPS_COUNT>;
+	using BinaryRows = std::array<BinaryRow, NUMERIC_TYPES_COUNT>;
+	using PrefixRow = std::array<PrefixOperation, PREFIX_OPS_COUNT>;
+
+	template <class Left, class Right, class... Ops>
+	constexpr BinaryRow MakeBinaryRow(TypeList<Ops...>)
+	{
+		static_assert(sizeof...(Ops) == BINARY_OPS_COUNT, "every binary op code needs a kernel");
+		return {{ &Binary<Left, Right, Ops>... }};
+	}
+
+	template <class Left, class... Rights>
+	constexpr BinaryRows MakeBinaryRows(TypeList<Rights...>)
+	{
+		return {{ MakeBinaryRow<Left, Rights>(BinaryOps())... }};
+	}
+
+	template <class... Lefts>
+	constexpr std::array<BinaryRows, NUMERIC_TYPES_COUNT> MakeBinaryTable(TypeList<Lefts...>)
+	{
+		static_assert(sizeof...(Lefts) == NUMERIC_TYPES_COUNT, "every numeric type needs kernels");
+		return {{ MakeBinaryRows<Lefts>(NumericTypes())... }};
+	}
+
+	template <class T, class... Ops>
+	constexpr PrefixRow MakePrefixRow(TypeList<Ops...>)
+	{
+		static_assert(sizeof...(Ops) == PREFIX_OPS_COUNT, "every prefix op code needs a kernel");
+		return {{ &Prefix<T, Ops>... }};
+	}
+
+	template <class... Types>
+	constexpr std::array<PrefixRow, NUMERIC_TYPES_COUNT> MakePrefixTable(TypeList<Types...>)
+	{
+		return {{ MakePrefixRow<Types>(PrefixOps())... }};
+	}
+
+	// [left type][right type][op code], [type][op code]
+	constexpr auto binaryKernels = MakeBinaryTable(NumericTypes());
+	constexpr auto prefixKernels = MakePrefixTable(NumericTypes());
+
+	bool IsNumeric(DataType type)
+	{
+		return static_cast<size_t>(type) < NUMERIC_TYPES_COUNT;
+	}
+}
+
+BinaryOpCode GetBinaryOpCode(LexemeType operation)
+{
+	switch (operation)
+	{
+	case LexemeType::Plus: return BinaryOpCode::Add;
+	case LexemeType::Minus: return BinaryOpCode::Sub;
+	case LexemeType::Mul: return BinaryOpCode::Mul;
+	case LexemeType::Div: return BinaryOpCode::Div;
+	case LexemeType::Modul: return BinaryOpCode::Modul;
+	case LexemeType::E: return BinaryOpCode::Equal;
+	case LexemeType::NE: return BinaryOpCode::NotEqual;
+	case LexemeType::G: return BinaryOpCode::Greater;
+	case LexemeType::L: return BinaryOpCode::Less;
+	case LexemeType::LE: return BinaryOpCode::LessEqual;
+	case LexemeType::GE: return BinaryOpCode::GreaterEqual;
+	default: return BinaryOpCode::Count;
+	}
+}
+
+PrefixOpCode GetPrefixOpCode(LexemeType operation)
+{
+	switch (operation)
+	{
+	case LexemeType::Plus: return PrefixOpCode::Plus;
+	case LexemeType::Minus: return PrefixOpCode::Minus;
+	case LexemeType::Inc: return PrefixOpCode::Inc;
+	case LexemeType::Dec: return PrefixOpCode::Dec;
+	default: return PrefixOpCode::Count;
+	}
+}
+
+BinaryOperation SelectBinaryOperation(DataType leftType, DataType rightType, LexemeType operation)
+{
+	const auto opCode = GetBinaryOpCode(operation);
+	if (!IsNumeric(leftType) || !IsNumeric(rightType) || opCode == BinaryOpCode::Count)
+		return nullptr;
+
+	return binaryKernels[static_cast<size_t>(leftType)][static_cast<size_t>(rightType)][static_cast<size_t>(opCode)];
+}
+
+PrefixOperation SelectPrefixOperation(DataType type, LexemeType operation)
+{
+	const auto opCode = GetPrefixOpCode(operation);
+	if (!IsNumeric(type) || opCode == PrefixOpCode::Count)
+		return nullptr;
+
+	return prefixKernels[static_cast<size_t>(type)][static_cast<size_t>(opCode)];
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Exceptions/AnalysisExceptions.h"
+#include "Node/DataValue.h"
+#include "Types/DataType.h"
+#include "Types/LexemeType.h"
+
+// Operations for statically known operand types, selected once by the typing pass.
+// The right operand of a binary operation is converted to the type of the left one,
+// which is also the type of the result, so a selected operation checks no tags.
+using BinaryOperation = DataValue(*)(DataValue leftValue, DataValue rightValue);
+using PrefixOperation = DataValue(*)(DataValue value);
+
+// Dense codes of the operators, rows of the kernel tables
+enum class BinaryOpCode
+{
+	Add, Sub, Mul, Div, Modul, Equal, NotEqual, Greater, Less, LessEqual, GreaterEqual, Count
+};
+
+enum class PrefixOpCode
+{
+	Plus, Minus, Inc, Dec, Count
+};
+
+// Count if the lexeme is not such an operator
+BinaryOpCode GetBinaryOpCode(LexemeType operation);
+PrefixOpCode GetPrefixOpCode(LexemeType operation);
+
+// nullptr if the operation is not defined for the types
+BinaryOperation SelectBinaryOperation(DataType leftType, DataType rightType, LexemeType operation);
+PrefixOperation SelectPrefixOperation(DataType type, LexemeType operation);
+
+// Every operator is defined once for any C++ type of a DataType; the kernels below are
+// instantiated for all of them, code that knows the types may call a kernel directly.
+namespace Kernels
+{
+	template <class T> T Get(DataValue value);
+	template <> inline int Get<int>(DataValue value) { return value.intVal; }
+	template <> inline long long Get<long long>(DataValue value) { return value.longVal; }
+
+	struct Add { template <class T> static T Apply(T left, T right) { return left + right; } };
+	struct Sub { template <class T> static T Apply(T left, T right) { return left - right; } };
+	struct Mul { template <class T> static T Apply(T left, T right) { return left * right; } };
+
+	struct Div
+	{
+		template <class T> static T Apply(T left, T right)
+		{
+			if (right == 0)
+				throw DivisionOnZeroException();
+			return left / right;
+		}
+	};
+
+	struct Modul
+	{
+		template <class T> static T Apply(T left, T right)
+		{
+			if (right == 0)
+				throw DivisionOnZeroException();
+			return left % right;
+		}
+	};
+
+	struct Equal { template <class T> static T Apply(T left, T right) { return left == right; } };
+	struct NotEqual { template <class T> static T Apply(T left, T right) { return left != right; } };
+	struct Greater { template <class T> static T Apply(T left, T right) { return left > right; } };
+	struct Less { template <class T> static T Apply(T left, T right) { return left < right; } };
+	struct LessEqual { template <class T> static T Apply(T left, T right) { return left <= right; } };
+	struct GreaterEqual { template <class T> static T Apply(T left, T right) { return left >= right; } };
+
+	struct Plus { template <class T> static T Apply(T value) { return +value; } };
+	struct Minus { template <class T> static T Apply(T value) { return -value; } };
+	struct Inc { template <class T> static T Apply(T value) { return value + 1; } };
+	struct Dec { template <class T> static T Apply(T value) { return value - 1; } };
+
+	template <class Left, class Right, class Op>
+	DataValue Binary(DataValue leftValue, DataValue rightValue)
+	{
+		return DataValue(Op::Apply(Get<Left>(leftValue), static_cast<Left>(Get<Right>(rightValue))));
+	}
+
+	template <class T, class Op>
+	DataValue Prefix(DataValue value)
+	{
+		return DataValue(Op::Apply(Get<T>(value)));
+	}
+}
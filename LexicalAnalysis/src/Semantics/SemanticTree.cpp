@@ -8,23 +8,11 @@
 
 #include "Exceptions/AnalysisExceptions.h"
 
-using std::unique_ptr;
-using std::shared_ptr;
-using std::make_unique;
-using std::make_shared;
-
 SemanticTree::SemanticTree()
-	:_rootNode(make_unique<Node>(nullptr)),
-	_currNode(_rootNode.get())
+	:_rootNode(_arena.Create<Node>(nullptr)),
+	_currNode(_rootNode)
 {}
 
-Node* SemanticTree::GetCurrentNode() const
-{
-	if (!IsInterpretation) return nullptr;
-
-	return  _currNode;
-}
-
 void SemanticTree::SetCurrentNode(Node* node)
 {
 	if (!IsInterpretation) return;
@@ -32,26 +20,54 @@ void SemanticTree::SetCurrentNode(Node* node)
 	_currNode = node;
 }
 
-Node* SemanticTree::AddVariable(DataType type, const std::string& id)
+Address SemanticTree::AddVariable(DataType type, const std::string& id)
 {
-	if (!IsInterpretation) return nullptr;
-
 	if (!CheckUniqueIdentifier(id))
 		throw RedefinedIdentifierException(id);
 
-	_currNode->Siblink = make_unique<Node>(_currNode, make_unique<VarData>(id, type));
-	SetCurrentNode(_currNode->Siblink.get());
-	return _currNode;
+	if (!_symbols.IsGlobalScope())
+		return _symbols.BindLocal(id, type);			// Slot of the frame, also keeps slots of the checked code
+
+	if (!IsInterpretation)
+		return _symbols.BindGlobal(id, nullptr, SemanticType::Var);
+
+	_currNode->Siblink = _arena.Create<Node>(_currNode, NodeData(InternIdentifier(id), VarData(type)));
+	SetCurrentNode(_currNode->Siblink);
+	return _symbols.BindGlobal(id, _currNode, SemanticType::Var);
 }
 
-shared_ptr<DataValue> SemanticTree::GetVariableValue(const Node* node) const
+DataValue SemanticTree::GetVariableValue(const Address& address) const
 {
-	if (!IsInterpretation) return {};
+	const auto data = _symbols.GetData(address);
+	if (!IsInterpretation)
+		return DataValue(GetVariableData(data)->Type);		// Typing pass needs only the type
+
+	if (!GetVariableInitialized(data))
+		throw UsingUninitializedVariableException(data->GetIdentifier());
+
+	if (_globalObserver && address.IsGlobal)
+		_globalObserver->OnGlobalRead(address.Index, GetVariableData(data)->Value);
+	return GetVariableData(data)->Value;
+}
 
-	if (!GetVariableInitialized(node))
-		throw UsingUninitializedVariableException(node->Data->Identifier);
+DataValue SemanticTree::PeekVariableValue(const Address& address) const
+{
+	return GetVariableData(_symbols.GetData(address))->Value;
+}
 
-	return GetVariableData(node)->Value;
+DataType SemanticTree::GetVariableType(const Address& address) const
+{
+	return GetVariableData(_symbols.GetData(address))->Type;
+}
+
+bool SemanticTree::IsVariableInitialized(const Address& address) const
+{
+	return GetVariableInitialized(_symbols.GetData(address));
+}
+
+const std::string& SemanticTree::GetVariableIdentifier(const Address& address) const
+{
+	return _symbols.GetData(address)->GetIdentifier();
 }
 
 void SemanticTree::CastValue(DataValue* value, DataType type) const
@@ -76,196 +92,76 @@ void SemanticTree::CastValue(DataValue* value, DataType type) const
 	value->type = type;
 }
 
-shared_ptr<DataValue> SemanticTree::PerformOperation(shared_ptr<DataValue> leftValue, shared_ptr<DataValue> rightValue, LexemeType operation) const
+DataValue SemanticTree::PerformOperation(DataValue leftValue, DataValue rightValue, LexemeType operation, size_t pos)
 {
-	if (!IsInterpretation) return nullptr;
+	auto& typedOperation = GetAtPos(_binaryOperations, pos);
+	if (typedOperation == nullptr)
+	{
+		typedOperation = SelectBinaryOperation(leftValue.type, rightValue.type, operation);
+		if (typedOperation == nullptr)
+			throw InvalidOperandsException(leftValue.type, rightValue.type, LexemeTypeToString(operation));
+	}
 
-	CheckOperationValid(leftValue, rightValue, operation);
-
-	auto rightCastValue = make_shared<DataValue>(*rightValue);
-	auto leftCastValue = make_shared<DataValue>(*leftValue);
-	CastOperands(leftCastValue.get(), rightCastValue.get(), operation);
-	auto resValue = make_shared<DataValue>();
-	auto resType = leftValue->type;
-
-	if (resType == DataType::Long)
-		switch (operation) {
-		case LexemeType::E:
-			resValue->longVal = leftValue->longVal == rightCastValue->longVal; break;
-		case LexemeType::NE:
-			resValue->longVal = leftValue->longVal != rightCastValue->longVal; break;
-		case LexemeType::G:
-			resValue->longVal = leftValue->longVal > rightCastValue->longVal; break;
-		case LexemeType::L:
-			resValue->longVal = leftValue->longVal < rightCastValue->longVal; break;
-		case LexemeType::LE:
-			resValue->longVal = leftValue->longVal <= rightCastValue->longVal; break;
-		case LexemeType::GE:
-			resValue->longVal = leftValue->longVal >= rightCastValue->longVal; break;
-		case LexemeType::Plus:
-			resValue->longVal = leftValue->longVal + rightCastValue->longVal; break;
-		case LexemeType::Minus:
-			resValue->longVal = leftValue->longVal - rightCastValue->longVal; break;
-		case LexemeType::Mul:
-			resValue->longVal = leftValue->longVal * rightCastValue->longVal; break;
-		case LexemeType::Div:
-			resValue->longVal = leftValue->longVal / rightCastValue->longVal; break;
-		case LexemeType::Modul:
-			resValue->longVal = leftValue->longVal % rightCastValue->longVal; break;
-		default:
-			throw std::exception("not known operation");
-		}
-	else
-		switch (operation) {
-		case LexemeType::E:
-			resValue->intVal = leftValue->intVal == rightCastValue->intVal; break;
-		case LexemeType::NE:
-			resValue->intVal = leftValue->intVal != rightCastValue->intVal; break;
-		case LexemeType::G:
-			resValue->intVal = leftValue->intVal > rightCastValue->intVal; break;
-		case LexemeType::L:
-			resValue->intVal = leftValue->intVal < rightCastValue->intVal; break;
-		case LexemeType::LE:
-			resValue->intVal = leftValue->intVal <= rightCastValue->intVal; break;
-		case LexemeType::GE:
-			resValue->intVal = leftValue->intVal >= rightCastValue->intVal; break;
-		case LexemeType::Plus:
-			resValue->intVal = leftValue->intVal + rightCastValue->intVal; break;
-		case LexemeType::Minus:
-			resValue->intVal = leftValue->intVal - rightCastValue->intVal; break;
-		case LexemeType::Mul:
-			resValue->intVal = leftValue->intVal * rightCastValue->intVal; break;
-		case LexemeType::Div:
-			resValue->intVal = leftValue->intVal / rightCastValue->intVal; break;
-		case LexemeType::Modul:
-			resValue->intVal = leftValue->intVal % rightCastValue->intVal; break;
-		default:
-			throw std::exception("not known operation");
-		}
-	resValue->type = resType;
-	return resValue;
-}
-
-shared_ptr<DataValue> SemanticTree::PerformPrefixOperation(LexemeType operation, shared_ptr<DataValue> value) const
-{
-	if (!IsInterpretation) return nullptr;
+	if (!IsInterpretation)
+		return DataValue(leftValue.type);		// Typing pass needs only the type of the result
+	return typedOperation(leftValue, rightValue);
+}
 
-	CheckOperationValid(value, operation);
-	shared_ptr<DataValue> resValue;
-	if (operation == LexemeType::Inc || operation == LexemeType::Dec)
-		resValue = value;
-	else
-		resValue = make_shared<DataValue>();
-	if (value->type == DataType::Long)
-		switch (operation) {
-		case LexemeType::Plus:
-			resValue->longVal = +value->longVal; break;
-		case LexemeType::Minus:
-			resValue->longVal = -value->longVal; break;
-		case LexemeType::Inc:
-			++resValue->longVal; break;
-		case LexemeType::Dec:
-			--resValue->longVal; break;
-		default:
-			throw std::exception("not known operation");
-		}
-	else
+DataValue SemanticTree::PerformPrefixOperation(LexemeType operation, DataValue value, size_t pos)
+{
+	auto& typedOperation = GetAtPos(_prefixOperations, pos);
+	if (typedOperation == nullptr)
 	{
-		switch (operation) {
-		case LexemeType::Plus:
-			resValue->intVal = +value->intVal; break;
-		case LexemeType::Minus:
-			resValue->intVal = -value->intVal; break;
-		case LexemeType::Inc:
-			++resValue->intVal; break;
-		case LexemeType::Dec:
-			--resValue->intVal; break;
-		default:
-			throw std::exception("not known operation");
-		}
+		typedOperation = SelectPrefixOperation(value.type, operation);
+		if (typedOperation == nullptr)
+			throw InvalidOperandsException(value.type, LexemeTypeToString(operation));
 	}
-	return resValue;
+
+	if (!IsInterpretation)
+		return DataValue(value.type);
+	return typedOperation(value);			// ++ and -- give the new value, storing it is up to the caller
 }
 
-shared_ptr<DataValue> SemanticTree::ConvertNumLexemeToValue(const Lexeme& lex) const
+DataValue SemanticTree::ConvertNumLexemeToValue(const Lexeme& lex) const
 {
-	if (!IsInterpretation) return nullptr;
-
 	auto type = GetDataTypeOfNum(lex);
 	switch (type)
 	{
 	case DataType::Int:
-		return make_shared<DataValue>(std::stoi(lex.str, nullptr, 0));
+		return DataValue(std::stoi(lex.str, nullptr, 0));
 	case DataType::Long:
-		return make_shared<DataValue>(std::stoll(lex.str, nullptr, 0));
+		return DataValue(std::stoll(lex.str, nullptr, 0));
 	default:
 		throw InvalidNumberException();
 	}
 }
 
-void SemanticTree::SetVariableValue(const Node* node, const shared_ptr<DataValue>& value) const
+void SemanticTree::SetVariableValue(const Address& address, DataValue value)
 {
 	if (!IsInterpretation) return;
 
-	auto varData = GetVariableData(node);
-	CheckCastable(value->type, varData->Type);
+	const auto data = _symbols.GetData(address);
+	auto varData = GetVariableData(data);
+	CheckCastable(value.type, varData->Type);
 
-	CastValue(value.get(), node->GetDataType());
+	CastValue(&value, varData->Type);
 	varData->Value = value;
-	SetVariableInitialized(node);
-}
-
-std::shared_ptr<DataValue> SemanticTree::CloneValue(const std::shared_ptr<DataValue>& value) const
-{
-	return IsInterpretation ? std::make_shared<DataValue>(*value) : nullptr;
-}
-
-void SemanticTree::CheckOperationValid(shared_ptr<DataValue> leftValue, shared_ptr<DataValue> rightValue, LexemeType operation) const
-{
-	if (!IsInterpretation) return;
-
-	if (leftValue->type == DataType::Void || rightValue->type == DataType::Void
-		|| leftValue->type == DataType::Unknown || rightValue->type == DataType::Unknown)
-		throw InvalidOperandsException(leftValue->type, rightValue->type, LexemeTypeToString(operation));
-
-	if ((operation == LexemeType::Div || operation == LexemeType::Modul)
-		&& (rightValue->type == DataType::Long && rightValue->longVal == 0
-			|| rightValue->type == DataType::Int && rightValue->intVal == 0))
-		throw DivisionOnZeroException();
+	SetVariableInitialized(data);
+	if (_globalObserver && address.IsGlobal)
+		_globalObserver->OnGlobalWrite(address.Index);
 }
 
-void SemanticTree::CheckOperationValid(shared_ptr<DataValue> value, LexemeType operation) const
+void SemanticTree::CheckValidFuncArgs(const Node* funcNode, const DataValue* args, size_t argsCount) const
 {
 	if (!IsInterpretation) return;
 
-	if (value->type == DataType::Unknown || value->type == DataType::Void)
-		throw InvalidOperandsException(value->type, LexemeTypeToString(operation));
-}
-
-void SemanticTree::CheckValidFuncArgs(const Node* funcNode, const std::vector<shared_ptr<DataValue>>& args) const
-{
-	if (!IsInterpretation) return;
-
-	auto paramsTypes = GetFunctionParams(funcNode);
-
-	if (args.size() != paramsTypes.size())
-		throw WrongArgsCountException(paramsTypes.size(), args.size(), funcNode->Data->Identifier);
-
-	for (size_t i = 0; i < args.size(); i++)
-		CheckCastable(args[i]->type, paramsTypes[i]);
-}
-
-void SemanticTree::CastOperands(DataValue* leftValue, DataValue* rightValue, LexemeType operation) const
-{
-	if (rightValue->type == DataType::Void || leftValue->type == DataType::Void
-		|| rightValue->type == DataType::Unknown || leftValue->type == DataType::Unknown)
-		return;
+	const size_t paramsCount = GetFunctionData(funcNode)->ParamsCount;
+	if (argsCount != paramsCount)
+		throw WrongArgsCountException(paramsCount, argsCount, funcNode->Data.GetIdentifier());
 
-	if (leftValue->type == DataType::Long || rightValue->type == DataType::Long)
-	{
-		CastValue(leftValue, DataType::Long);
-		CastValue(rightValue, DataType::Long);
-	}
+	auto paramNode = funcNode->Child->Siblink;
+	for (size_t i = 0; i < argsCount; i++, paramNode = paramNode->Siblink)
+		CheckCastable(args[i].type, paramNode->GetDataType());
 }
 
 Node* SemanticTree::AddFunction(const std::string& id)
@@ -275,41 +171,48 @@ Node* SemanticTree::AddFunction(const std::string& id)
 	if (!CheckUniqueIdentifier(id))			// Check unique id
 		throw RedefinedIdentifierException(id);
 
-	_currNode->Siblink = make_unique<Node>(_currNode, make_unique<FuncData>(id));
-	const auto funcNode = _currNode->Siblink.get();
+	_currNode->Siblink = _arena.Create<Node>(_currNode, NodeData(InternIdentifier(id), FuncData()));
+	const auto funcNode = _currNode->Siblink;
 	SetCurrentNode(funcNode);
-	AddScope();
+	_symbols.BindGlobal(id, funcNode, SemanticType::Func);
+
+	funcNode->Child = _arena.Create<Node>(funcNode);		// Params follow this node
+	SetCurrentNode(funcNode->Child);
+	_symbols.EnterScope();
 	return funcNode;
 }
 
-Node* SemanticTree::AddEmpty()
+void SemanticTree::AddParam(Node* funcNode, const std::string& id, DataType type)
 {
-	if (!IsInterpretation) return nullptr;
+	if (!IsInterpretation) return;
 
-	_currNode->Siblink = make_unique<Node>(_currNode);
-	SetCurrentNode(_currNode->Siblink.get());
-	return _currNode;
+	if (!CheckUniqueIdentifier(id))
+		throw RedefinedIdentifierException(id);
+
+	GetFunctionData(funcNode)->ParamsCount++;
+	_currNode->Siblink = _arena.Create<Node>(_currNode, NodeData(InternIdentifier(id), VarData(type)));
+	SetCurrentNode(_currNode->Siblink);
+	SetVariableInitialized(&_currNode->Data);		// Every call assigns it
+	_symbols.BindLocal(id, type);					// Slot the body is checked against
 }
 
-void SemanticTree::AddParam(const Node* funcNode, const std::string& id, DataType type)
+void SemanticTree::AddEmpty()
 {
 	if (!IsInterpretation) return;
 
-	auto funcData = GetFunctionData(funcNode);
-	funcData->ParamsCount++;
-	auto node = AddVariable(type, id);
-	SetVariableInitialized(node);
+	_currNode->Siblink = _arena.Create<Node>(_currNode);
+	SetCurrentNode(_currNode->Siblink);
 }
 
 
 
-void SemanticTree::SetFunctionPos(const Node* funcNode, const SourceText::Iterator& pos) const
+void SemanticTree::SetFunctionPos(Node* funcNode, size_t pos) const
 {
 	if (!IsInterpretation) return;
 	GetFunctionData(funcNode)->Pos = pos;
 }
 
-SourceText::Iterator SemanticTree::GetFunctionPos(const Node* funcNode) const
+size_t SemanticTree::GetFunctionPos(const Node* funcNode) const
 {
 	if (!IsInterpretation) return {};
 	return GetFunctionData(funcNode)->Pos;
@@ -317,158 +220,133 @@ SourceText::Iterator SemanticTree::GetFunctionPos(const Node* funcNode) const
 
 
 
-Node* SemanticTree::CloneFunctionDefinition(Node* origNode) const
+void SemanticTree::EnterFunction(const Node* funcNode, const DataValue* args, size_t argsCount)
 {
-	if (!IsInterpretation) return nullptr;
-
-	auto siblink = std::move(origNode->Siblink);		// swap ownerships of siblinks
-	origNode->Siblink = origNode->Clone(origNode);
-
-	auto cloneFuncNode = origNode->Siblink.get();
-	auto cloneNode = cloneFuncNode;
-
-	cloneNode->Siblink = std::move(siblink);
-	if (cloneNode->Siblink != nullptr)
-		cloneNode->Siblink->Parent = cloneNode;
-	cloneNode->Child = origNode->Child->Clone(cloneNode);
-
-	origNode = origNode->Child.get();
-	cloneNode = cloneNode->Child.get();
+	if (!IsInterpretation) return;
 
-	while (origNode->Siblink && origNode->Siblink->GetSemanticType() == SemanticType::Var)
+	_symbols.EnterFrame(funcNode->Data.GetIdentifier());
+	_symbols.EnterScope();
+	auto paramNode = funcNode->Child->Siblink;
+	for (int i = 0; i < GetFunctionData(funcNode)->ParamsCount; i++, paramNode = paramNode->Siblink)
 	{
-		cloneNode->Siblink = origNode->Siblink->Clone(cloneNode);
-		origNode = origNode->Siblink.get();
-		cloneNode = cloneNode->Siblink.get();
+		const auto address = _symbols.BindLocal(paramNode->Data.GetIdentifier(), paramNode->GetDataType());
+		if (static_cast<size_t>(i) < argsCount)
+			SetVariableValue(address, args[i]);
 	}
-
-	return cloneFuncNode;
 }
 
-void SemanticTree::DeleteFuncDefinition(Node* funcNode) const
+void SemanticTree::LeaveFunction()
 {
 	if (!IsInterpretation) return;
 
-	funcNode->Siblink->Parent = funcNode->Parent;
-	funcNode->Parent->Siblink = std::move(funcNode->Siblink);
+	_symbols.LeaveFrame();
 }
 
-void SemanticTree::AssignParamsWithArgs(const std::vector<std::shared_ptr<DataValue>>& args)
+void SemanticTree::EnterScope()
 {
-	_currNode = _currNode->Child.get();
-	size_t argNum = 0;
-	while (_currNode->Siblink != nullptr) {
-		if (argNum < args.size()) {
-			SetVariableValue(_currNode->Siblink.get(), make_shared<DataValue>(*args[argNum]));
-			++argNum;
-		}
-		_currNode = _currNode->Siblink.get();
-	}
+	_symbols.EnterScope();
 }
 
-void SemanticTree::AddScope()
+void SemanticTree::LeaveScope()
 {
-	if (!IsInterpretation) return;
-
-	_currNode->Child = make_unique<Node>(_currNode);
-	SetCurrentNode(_currNode->Child.get());
+	_symbols.LeaveScope();
 }
 
-void SemanticTree::Print(std::ostream& out) const
+void SemanticTree::LeaveFunctionScope(Node* funcNode)
 {
-	_rootNode->RecursivePrint(out);
+	_symbols.LeaveScope();
+	if (!IsInterpretation) return;
+
+	SetCurrentNode(funcNode);						// Params stay for calls
 }
 
-Node* SemanticTree::FindVariableNodeUp(const std::string& id) const
+void SemanticTree::Print(std::ostream& out, TreeFormat format) const
 {
-	if (!IsInterpretation) return nullptr;
-
-	auto varNode = FindNodeUp(id);
-	if (varNode->GetSemanticType() == SemanticType::Func)
-		throw UsingFunctionAsVariableException(id);
-	return varNode;
+	TreePrinter(out, format).Print(_rootNode);
 }
 
-Node* SemanticTree::FindFunctionNodeUp(const std::string& id) const
+std::vector<const Node*> SemanticTree::GetGlobalVariables() const
 {
-	if (!IsInterpretation) return nullptr;
-
-	auto funcNode = FindNodeUp(id);
-	if (funcNode->GetSemanticType() != SemanticType::Func)
-		throw UsingVariableAsFunctionException(funcNode->Data->Identifier);
-	return funcNode;
+	std::vector<const Node*> globals;
+	for (auto node = _rootNode->Siblink; node != nullptr; node = node->Siblink)
+		if (node->GetSemanticType() == SemanticType::Var)
+			globals.push_back(node);
+	return globals;
 }
 
-void SemanticTree::DeleteSubTree(Node* node) const
+std::vector<const Node*> SemanticTree::GetDeclarations() const
 {
-	if (!IsInterpretation) return;
-	node->Child.reset();
+	std::vector<const Node*> declarations;
+	for (auto node = _rootNode->Siblink; node != nullptr; node = node->Siblink)
+		declarations.push_back(node);
+	return declarations;
 }
 
-
-// ------------------------ PRIVATE FUNCTIONS ---------------------------
-
-
-void SemanticTree::SetVariableInitialized(const Node* varNode)
+Address SemanticTree::FindVariable(const std::string& id) const
 {
-	GetVariableData(varNode)->IsInitialized = true;
+	const auto symbol = FindSymbol(id);
+	if (symbol->Type == SemanticType::Func)
+		throw UsingFunctionAsVariableException(id);
+	return symbol->Addr;
 }
 
-std::vector<DataType> SemanticTree::GetFunctionParams(const Node* funcNode)
+Address SemanticTree::ResolveVariable(const std::string& id, size_t pos)
 {
-	const auto funcData = GetFunctionData(funcNode);
-	auto paramNode = funcNode->Child->Siblink.get();
-	std::vector<DataType> paramsTypes(funcData->ParamsCount);
-	for (int i = 0; i < funcData->ParamsCount; i++)
+	auto& address = GetAtPos(_resolved, pos);
+	if (!address.IsResolved())
 	{
-		paramsTypes[i] = paramNode->GetDataType();
-		paramNode = paramNode->Siblink.get();
+		const auto symbol = FindSymbol(id);
+		if (symbol->Type == SemanticType::Func)
+			throw UsingFunctionAsVariableException(id);
+		address = symbol->Addr;
 	}
-	return paramsTypes;
+	return address;
 }
 
-Node* SemanticTree::FindNodeUp(const std::string& id) const
+Node* SemanticTree::ResolveFunction(const std::string& id, size_t pos)
 {
-	auto node = _currNode;
-	while (node->Parent && (node->Data == nullptr || node->Data->Identifier != id)) {
-		node = node->Parent;
+	auto& address = GetAtPos(_resolved, pos);
+	if (!address.IsResolved())
+	{
+		const auto symbol = FindSymbol(id);
+		if (symbol->Type != SemanticType::Func)
+			throw UsingVariableAsFunctionException(id);
+		address = symbol->Addr;
 	}
-	if (node->GetSemanticType() == SemanticType::Empty)
-		throw UndefinedIdentifierException(id);
-	return node;
+	return IsInterpretation ? _symbols.GetGlobal(address) : nullptr;
 }
 
-Node* SemanticTree::FindNodeUpInScope(const std::string& id) const
-{
-	auto node = _currNode;
-	auto par = _currNode->Parent;
-	while (par && par->Child.get() != node && (node->Data == nullptr || node->Data->Identifier != id)) {
-		node = par;
-		par = node->Parent;
 
-	}
-	return node;
-}
+// ------------------------ PRIVATE FUNCTIONS ---------------------------
+
 
-bool SemanticTree::GetVariableInitialized(const Node* varNode)
+void SemanticTree::SetVariableInitialized(NodeData* varData)
 {
-	return GetVariableData(varNode)->IsInitialized;
+	GetVariableData(varData)->IsInitialized = true;
 }
 
-VarData* SemanticTree::GetVariableData(const Node* node)
+const SymbolTable::Symbol* SemanticTree::FindSymbol(const std::string& id) const
 {
-	return dynamic_cast<VarData*>(node->Data.get());
+	const auto symbol = _symbols.Find(id);
+	if (symbol == nullptr)
+		throw UndefinedIdentifierException(id);
+	return symbol;
 }
 
-DataType SemanticTree::GetResultDataType(DataType leftType, DataType rightType, LexemeType operation)
+bool SemanticTree::GetVariableInitialized(const NodeData* varData)
 {
+	return GetVariableData(varData)->IsInitialized;
+}
 
-	if (leftType == DataType::Long || rightType == DataType::Long)
-		return DataType::Long;
-
-	return DataType::Int;
+VarData* SemanticTree::GetVariableData(NodeData* data)
+{
+	return &data->Var;
 }
 
+const VarData* SemanticTree::GetVariableData(const NodeData* data)
+{
+	return &data->Var;
+}
 
 DataType SemanticTree::GetDataTypeOfNum(Lexeme lex)
 {
@@ -508,16 +386,25 @@ DataType SemanticTree::GetDataTypeOfNum(Lexeme lex)
 	return DataType::Unknown;
 }
 
-FuncData* SemanticTree::GetFunctionData(const Node* funcNode)
+FuncData* SemanticTree::GetFunctionData(Node* funcNode)
+{
+	return &funcNode->Data.Func;
+}
+
+const FuncData* SemanticTree::GetFunctionData(const Node* funcNode)
+{
+	return &funcNode->Data.Func;
+}
+
+const std::string* SemanticTree::InternIdentifier(const std::string& id)
 {
-	return dynamic_cast<FuncData*>(funcNode->Data.get());
+	return &*_identifiers.insert(id).first;
 }
 
 
 bool SemanticTree::CheckUniqueIdentifier(const std::string& id) const
 {
-	auto node = FindNodeUpInScope(id);
-	return node->GetSemanticType() == SemanticType::Empty;
+	return !_symbols.IsDeclaredInScope(id);
 }
 
 void SemanticTree::CheckCastable(DataType from, DataType to)
@@ -1,76 +1,117 @@
 #pragma once
 #include <iostream>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "Lexical/Lexeme.h"
 #include "Node/FuncData.h"
 #include "Node/Node.h"
+#include "Node/NodeArena.h"
 #include "Node/VarData.h"
+#include "Operations.h"
+#include "SymbolTable.h"
+#include "TreePrinter.h"
 #include "Types/DataType.h"
 #include "Types/LexemeType.h"
+
+// Told of the values of globals read and stored while interpreting
+class GlobalAccessObserver
+{
+public:
+	virtual ~GlobalAccessObserver() = default;
+	virtual void OnGlobalRead(size_t index, const DataValue& value) = 0;
+	virtual void OnGlobalWrite(size_t index) = 0;
+};
+
 class SemanticTree
 {
 public:
 	SemanticTree();
 
-	Node* GetCurrentNode() const;
 	void SetCurrentNode(Node* node);
 
-	Node* AddVariable(DataType type, const std::string& id);
-	std::shared_ptr<DataValue> GetVariableValue(const Node* node) const;
-	void SetVariableValue(const Node* node, const std::shared_ptr<DataValue>& value) const;
-	std::shared_ptr<DataValue> CloneValue(const std::shared_ptr<DataValue>& value) const;
+	Address AddVariable(DataType type, const std::string& id);
+	DataValue GetVariableValue(const Address& address) const;
+	// Value of an assigned variable the observer is not told of, it is only passed on
+	DataValue PeekVariableValue(const Address& address) const;
+	void SetVariableValue(const Address& address, DataValue value);
 	void CastValue(DataValue* value, DataType type) const;
-	std::shared_ptr<DataValue> PerformOperation(std::shared_ptr<DataValue> leftValue, std::shared_ptr<DataValue> rightValue, LexemeType operation) const;
-	std::shared_ptr<DataValue> PerformPrefixOperation(LexemeType operation, std::shared_ptr<DataValue> value) const;
-	std::shared_ptr<DataValue> ConvertNumLexemeToValue(const Lexeme& lex) const;
-	void CastOperands(DataValue* leftValue, DataValue* rightValue, LexemeType operation) const;
+	DataType GetVariableType(const Address& address) const;
+	bool IsVariableInitialized(const Address& address) const;
+	void SetGlobalAccessObserver(GlobalAccessObserver* observer) { _globalObserver = observer; }
+	const std::string& GetVariableIdentifier(const Address& address) const;
+	// Operation at lexeme pos is typed by the first pass over it, later the selected one is performed
+	DataValue PerformOperation(DataValue leftValue, DataValue rightValue, LexemeType operation, size_t pos);
+	DataValue PerformPrefixOperation(LexemeType operation, DataValue value, size_t pos);
+	DataValue ConvertNumLexemeToValue(const Lexeme& lex) const;
 	
-	void CheckValidFuncArgs(const Node* funcNode, const std::vector<std::shared_ptr<DataValue>>& args) const;
+	void CheckValidFuncArgs(const Node* funcNode, const DataValue* args, size_t argsCount) const;
 
 	Node* AddFunction(const std::string& id);
-	void AddParam(const Node* funcNode, const std::string& id, DataType type);
-	void SetFunctionPos(const Node* funcNode, const SourceText::Iterator& pos) const;
-	SourceText::Iterator GetFunctionPos(const Node* funcNode) const;
-	Node* CloneFunctionDefinition(Node* origNode) const;
-	void DeleteFuncDefinition(Node* funcNode) const;
-	 void AssignParamsWithArgs(const std::vector<std::shared_ptr<DataValue>>& args);
-
-	Node* AddEmpty();
-	void AddScope();
-
-	Node* FindVariableNodeUp(const std::string& id) const;
-	Node* FindFunctionNodeUp(const std::string& id) const;
-
-	void DeleteSubTree(Node* node) const;
-
-	void Print(std::ostream& out = std::cout) const;
+	void AddParam(Node* funcNode, const std::string& id, DataType type);
+	// Node of the block main runs in, it is kept in the printed tree after the params
+	void AddEmpty();
+	void SetFunctionPos(Node* funcNode, size_t pos) const;
+	size_t GetFunctionPos(const Node* funcNode) const;
+	void EnterFunction(const Node* funcNode, const DataValue* args, size_t argsCount);
+	void LeaveFunction();
+	size_t GetCallDepth() const { return _symbols.GetFramesCount(); }
+	// Slots of the running function taken by the variables visible now
+	size_t GetFrameLocalsCount() const { return _symbols.GetFrameLocalsCount(); }
+
+	// Block scopes exist only in the symbol table, their variables are slots of the frame
+	void EnterScope();
+	void LeaveScope();
+	void LeaveFunctionScope(Node* funcNode);
+
+	Address FindVariable(const std::string& id) const;
+
+	// Identifier at lexeme pos is looked up once, later its address is taken from the cache
+	Address ResolveVariable(const std::string& id, size_t pos);
+	Node* ResolveFunction(const std::string& id, size_t pos);
+
+	void Print(std::ostream& out = std::cout, TreeFormat format = TreeFormat::Text) const;
+	std::vector<const Node*> GetGlobalVariables() const;
+	std::vector<const Node*> GetDeclarations() const;		// Global variables and functions in order
 
 	bool IsInterpretation = true;
 private:
 	bool CheckUniqueIdentifier(const std::string& id) const;
 	static void CheckCastable(DataType from, DataType to);
-	void CheckOperationValid(std::shared_ptr<DataValue> leftValue, std::shared_ptr<DataValue> rightValue, LexemeType operation) const;
-	void CheckOperationValid(std::shared_ptr<DataValue> value, LexemeType operation) const;
 
-	Node* FindNodeUpInScope(const std::string& id) const;
-	Node* FindNodeUp(const std::string& id) const;
-	static std::vector<DataType> GetFunctionParams(const Node* funcNode);
+	const SymbolTable::Symbol* FindSymbol(const std::string& id) const;
+	template <class T>
+	static T& GetAtPos(std::vector<T>& items, size_t pos)
+	{
+		if (pos >= items.size())
+			items.resize(pos + 1);
+		return items[pos];
+	}
 
-	static bool GetVariableInitialized(const Node* varNode);
-	static void SetVariableInitialized(const Node* varNode);
+	static bool GetVariableInitialized(const NodeData* varData);
+	static void SetVariableInitialized(NodeData* varData);
 
-	static VarData* GetVariableData(const Node* node);
+	static VarData* GetVariableData(NodeData* data);
+	static const VarData* GetVariableData(const NodeData* data);
 
-	static DataType GetResultDataType(DataType leftType, DataType rightType, LexemeType operation);
 	static DataType GetDataTypeOfNum(Lexeme lex);
 
-	static FuncData* GetFunctionData(const Node* funcNode);
+	static FuncData* GetFunctionData(Node* funcNode);
+	static const FuncData* GetFunctionData(const Node* funcNode);
 
 
-	std::unique_ptr<Node> _rootNode;
+	NodeArena _arena;
+	Node* _rootNode;
 	Node* _currNode;
+	const std::string* InternIdentifier(const std::string& id);
+
+	SymbolTable _symbols;
+	GlobalAccessObserver* _globalObserver = nullptr;
+	std::unordered_set<std::string> _identifiers;
+	std::vector<Address> _resolved;			// Lexeme position -> address of the identifier
+	std::vector<BinaryOperation> _binaryOperations;		// Lexeme position -> typed operation
+	std::vector<PrefixOperation> _prefixOperations;
 };
 
 
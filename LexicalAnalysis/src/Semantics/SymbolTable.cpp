@@ -0,0 +1,107 @@
+#include "SymbolTable.h"
+
+Address SymbolTable::BindGlobal(const std::string& id, Node* node, SemanticType type)
+{
+	Address address;
+	address.IsGlobal = true;
+	address.Index = globals.size();
+	globals.push_back(node);
+	AddBinding(id, { type, address });
+	return address;
+}
+
+Address SymbolTable::BindLocal(const std::string& id, DataType type)
+{
+	Address address;
+	address.Index = locals.size() - localsBase;
+	const auto identifier = AddBinding(id, { SemanticType::Var, address });
+	locals.emplace_back(identifier, VarData(type));
+	return address;
+}
+
+const SymbolTable::Symbol* SymbolTable::Find(const std::string& id) const
+{
+	const auto binding = FindBinding(id);
+	return binding ? &binding->symbol : nullptr;
+}
+
+bool SymbolTable::IsDeclaredInScope(const std::string& id) const
+{
+	const auto found = bindings.find(id);
+	if (found == bindings.end() || found->second.empty())
+		return false;
+
+	const auto& top = found->second.back();
+	return top.scope == scopes.size() && top.frame == frames.size();
+}
+
+NodeData* SymbolTable::GetData(const Address& address)
+{
+	return address.IsGlobal ? &globals[address.Index]->Data : &locals[localsBase + address.Index];
+}
+
+const NodeData* SymbolTable::GetData(const Address& address) const
+{
+	return address.IsGlobal ? &globals[address.Index]->Data : &locals[localsBase + address.Index];
+}
+
+void SymbolTable::EnterScope()
+{
+	scopes.push_back({ declarations.size(), locals.size() });
+}
+
+void SymbolTable::LeaveScope()
+{
+	const auto& scope = scopes.back();
+	while (declarations.size() > scope.declarationsCount)
+	{
+		declarations.back()->pop_back();
+		declarations.pop_back();
+	}
+	locals.resize(scope.localsCount);
+	scopes.pop_back();
+}
+
+void SymbolTable::EnterFrame(const std::string& funcId)
+{
+	const auto funcBinding = FindBinding(funcId);
+	const auto globalsLimit = funcBinding ? funcBinding->symbol.Addr.Index + 1 : globals.size();
+	frames.push_back({ scopes.size(), localsBase, globalsLimit });
+	localsBase = locals.size();
+}
+
+void SymbolTable::LeaveFrame()
+{
+	while (scopes.size() > frames.back().scopesCount)
+		LeaveScope();
+	localsBase = frames.back().callerLocalsBase;
+	frames.pop_back();
+}
+
+const SymbolTable::Binding* SymbolTable::FindBinding(const std::string& id) const
+{
+	const auto found = bindings.find(id);
+	if (found == bindings.end())
+		return nullptr;
+
+	const auto globalsLimit = frames.empty() ? globals.size() : frames.back().globalsLimit;
+	const auto& nameBindings = found->second;
+	for (auto binding = nameBindings.rbegin(); binding != nameBindings.rend(); ++binding)
+	{
+		if (binding->symbol.Addr.IsGlobal)
+			return binding->symbol.Addr.Index < globalsLimit ? &*binding : nullptr;
+		if (binding->frame == frames.size())
+			return &*binding;						// Locals of callers are skipped
+	}
+	return nullptr;
+}
+
+const std::string* SymbolTable::AddBinding(const std::string& id, const Symbol& symbol)
+{
+	auto entry = bindings.find(id);
+	if (entry == bindings.end())
+		entry = bindings.emplace(id, std::vector<Binding>()).first;
+	entry->second.push_back({ symbol, frames.size(), scopes.size() });
+	declarations.push_back(&entry->second);
+	return &entry->first;						// Keys are never erased, so the name outlives the slot
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Node/Node.h"
+#include "Types/SemanticType.h"
+
+// Static place of a declaration: index of a global, or slot in the frame of the current function
+struct Address
+{
+	bool IsGlobal = false;
+	size_t Index = static_cast<size_t>(-1);
+
+	bool IsResolved() const { return Index != static_cast<size_t>(-1); }
+};
+
+// Hashed view of the identifiers visible from the current node of the semantic tree.
+// Every name keeps a stack of its bindings; a scope remembers how many declarations were
+// made before it, so leaving it pops exactly the bindings it introduced.
+// A function call opens a frame: the caller's locals are hidden and only the globals
+// declared up to the called function are visible, as they are from its place in the tree.
+// Locals get slots in declaration order, so a slot is the same each time the code is executed.
+// The slots themselves are the frame stack: a call pushes its params and locals on top of the
+// caller's ones and leaving the frame pops them, nothing is allocated once the stack has grown.
+class SymbolTable
+{
+public:
+	struct Symbol
+	{
+		SemanticType Type;
+		Address Addr;
+	};
+
+	Address BindGlobal(const std::string& id, Node* node, SemanticType type);
+	Address BindLocal(const std::string& id, DataType type);
+	const Symbol* Find(const std::string& id) const;
+	bool IsDeclaredInScope(const std::string& id) const;
+	bool IsGlobalScope() const { return scopes.empty(); }
+
+	Node* GetGlobal(const Address& address) const { return globals[address.Index]; }
+	NodeData* GetData(const Address& address);
+	const NodeData* GetData(const Address& address) const;
+
+	void EnterScope();
+	void LeaveScope();
+
+	void EnterFrame(const std::string& funcId);
+	void LeaveFrame();
+	size_t GetFramesCount() const { return frames.size(); }
+	size_t GetFrameLocalsCount() const { return locals.size() - localsBase; }
+
+private:
+	struct Binding
+	{
+		Symbol symbol;
+		size_t frame;
+		size_t scope;
+	};
+
+	struct Scope
+	{
+		size_t declarationsCount;
+		size_t localsCount;
+	};
+
+	struct Frame
+	{
+		size_t scopesCount;
+		size_t callerLocalsBase;
+		size_t globalsLimit;
+	};
+
+	const Binding* FindBinding(const std::string& id) const;
+	const std::string* AddBinding(const std::string& id, const Symbol& symbol);
+
+	std::unordered_map<std::string, std::vector<Binding>> bindings;
+	std::vector<std::vector<Binding>*> declarations;
+	std::vector<Scope> scopes;
+	std::vector<Frame> frames;
+	std::vector<Node*> globals;
+	std::vector<NodeData> locals;
+	size_t localsBase = 0;
+};
@@ -0,0 +1,178 @@
+#include "TreePrinter.h"
+
+TreePrinter::TreePrinter(std::ostream& out, TreeFormat format)
+	: out(out),
+	format(format)
+{
+	buffer.reserve(BUFFER_SIZE);
+	if (format == TreeFormat::Binary)
+	{
+		Append("LXAT", 4);
+		AppendRaw(BINARY_VERSION);
+	}
+}
+
+TreePrinter::~TreePrinter()
+{
+	Flush();
+}
+
+void TreePrinter::Print(const Node* root)
+{
+	stack.push_back({ root, 0 });
+	while (!stack.empty())
+	{
+		const auto item = stack.back();
+		stack.pop_back();
+		switch (format)
+		{
+		case TreeFormat::Text: PrintText(item.node, item.depth); break;
+		case TreeFormat::JsonLines: PrintJson(item.node, item.depth); break;
+		case TreeFormat::Binary: PrintBinary(item.node, item.depth); break;
+		}
+
+		// Children go before the siblings
+		if (item.node->Siblink)
+			stack.push_back({ item.node->Siblink, item.depth });
+		if (item.node->Child)
+			stack.push_back({ item.node->Child, item.depth + 1 });
+	}
+}
+
+void TreePrinter::Flush()
+{
+	out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	buffer.clear();
+}
+
+bool TreePrinter::ParseFormat(const std::string& name, TreeFormat& format)
+{
+	if (name == "text")
+		format = TreeFormat::Text;
+	else if (name == "json")
+		format = TreeFormat::JsonLines;
+	else if (name == "binary")
+		format = TreeFormat::Binary;
+	else
+		return false;
+	return true;
+}
+
+void TreePrinter::PrintText(const Node* node, uint32_t depth)
+{
+	AppendTabs(depth);
+	const auto& data = node->Data;
+	switch (data.GetSemanticType())
+	{
+	case SemanticType::Var:
+		Append("Variable Node: Type = ");
+		Append(GetTypeName(data.Var.Type));
+		Append(", Id = ");
+		Append(data.GetIdentifier());
+		Append(", Value = ");
+		AppendInteger(GetValue(data.Var));
+		Append(", Is Initialized = ");
+		Append(data.Var.IsInitialized ? "1\n" : "0\n");
+		break;
+	case SemanticType::Func:
+		Append("Function Node: Id = ");
+		Append(data.GetIdentifier());
+		Append(", Param Count = ");
+		AppendInteger(data.Func.ParamsCount);
+		Append("\n");
+		break;
+	default:
+		Append("()\n");
+	}
+}
+
+void TreePrinter::PrintJson(const Node* node, uint32_t depth)
+{
+	// Identifiers are letters, digits and '_', so they need no escaping
+	Append("{\"depth\":");
+	AppendInteger(depth);
+	const auto& data = node->Data;
+	switch (data.GetSemanticType())
+	{
+	case SemanticType::Var:
+		Append(",\"kind\":\"var\",\"id\":\"");
+		Append(data.GetIdentifier());
+		Append("\",\"type\":\"");
+		Append(GetTypeName(data.Var.Type));
+		Append("\",\"value\":");
+		AppendInteger(GetValue(data.Var));
+		Append(data.Var.IsInitialized ? ",\"initialized\":true}\n" : ",\"initialized\":false}\n");
+		break;
+	case SemanticType::Func:
+		Append(",\"kind\":\"func\",\"id\":\"");
+		Append(data.GetIdentifier());
+		Append("\",\"params\":");
+		AppendInteger(data.Func.ParamsCount);
+		Append("}\n");
+		break;
+	default:
+		Append(",\"kind\":\"empty\"}\n");
+	}
+}
+
+void TreePrinter::PrintBinary(const Node* node, uint32_t depth)
+{
+	const auto& data = node->Data;
+	const auto kind = data.GetSemanticType();
+	const auto isVar = kind == SemanticType::Var;
+	AppendRaw(static_cast<uint8_t>(kind));
+	AppendRaw(static_cast<uint8_t>(data.GetDataType()));
+	AppendRaw(static_cast<uint8_t>(isVar && data.Var.IsInitialized));
+	AppendRaw(depth);
+	AppendRaw(static_cast<int64_t>(isVar ? GetValue(data.Var) : kind == SemanticType::Func ? data.Func.ParamsCount : 0));
+
+	const auto idLength = data.Identifier ? static_cast<uint32_t>(data.Identifier->size()) : 0;
+	AppendRaw(idLength);
+	if (idLength > 0)
+		Append(*data.Identifier);
+}
+
+void TreePrinter::Append(const char* str, size_t size)
+{
+	if (buffer.size() + size > BUFFER_SIZE)
+		Flush();
+	buffer.append(str, size);
+}
+
+void TreePrinter::AppendTabs(uint32_t count)
+{
+	if (buffer.size() + count > BUFFER_SIZE)
+		Flush();
+	buffer.append(count, '\t');
+}
+
+void TreePrinter::AppendInteger(long long value)
+{
+	char digits[24];
+	auto end = digits + sizeof(digits), begin = end;
+	auto magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+	do
+	{
+		*--begin = static_cast<char>('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0)
+		*--begin = '-';
+	Append(begin, static_cast<size_t>(end - begin));
+}
+
+const char* TreePrinter::GetTypeName(DataType type)
+{
+	switch (type)
+	{
+	case DataType::Int: return "Int";
+	case DataType::Long: return "Long";
+	case DataType::Void: return "Void";
+	default: return "Unknown";
+	}
+}
+
+long long TreePrinter::GetValue(const VarData& var)
+{
+	return var.Value.type == DataType::Long ? var.Value.longVal : var.Value.intVal;
+}
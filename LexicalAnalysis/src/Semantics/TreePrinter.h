@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Node/Node.h"
+
+enum class TreeFormat
+{
+	Text,			// Indented lines, as the tree has always been printed
+	JsonLines,		// One object per node: {"depth":0,"kind":"var","id":"a","type":"Int","value":1,"initialized":true}
+	Binary			// Header "LXAT", version, then per node: kind, type, initialized (u8), depth (u32),
+					// value or params count (i64), id length (u32), id; little-endian, unaligned
+};
+
+// Writes a tree in pre-order without recursion. Output is collected in a large buffer
+// that is handed to the stream in whole blocks and reused, so printing allocates nothing per node.
+class TreePrinter
+{
+public:
+	TreePrinter(std::ostream& out, TreeFormat format);
+	~TreePrinter();
+
+	TreePrinter(const TreePrinter&) = delete;
+	TreePrinter& operator=(const TreePrinter&) = delete;
+
+	void Print(const Node* root);
+	void Flush();
+
+	static bool ParseFormat(const std::string& name, TreeFormat& format);
+
+	static const uint32_t BINARY_VERSION = 1;
+	static const size_t BUFFER_SIZE = 1 << 20;
+
+private:
+	struct Item
+	{
+		const Node* node;
+		uint32_t depth;
+	};
+
+	void PrintText(const Node* node, uint32_t depth);
+	void PrintJson(const Node* node, uint32_t depth);
+	void PrintBinary(const Node* node, uint32_t depth);
+
+	void Append(const char* str, size_t size);
+	void Append(const char* str) { Append(str, std::char_traits<char>::length(str)); }
+	void Append(const std::string& str) { Append(str.data(), str.size()); }
+	void AppendTabs(uint32_t count);
+	void AppendInteger(long long value);
+	template <class T> void AppendRaw(T value) { Append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+	static const char* GetTypeName(DataType type);
+	static long long GetValue(const VarData& var);
+
+	std::ostream& out;
+	TreeFormat format;
+	std::string buffer;
+	std::vector<Item> stack;
+};
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include "CallMemo.h"
+
+namespace
+{
+	int64_t ToInt64(const DataValue& value)
+	{
+		return value.type == DataType::Long ? value.longVal : value.intVal;
+	}
+
+	bool IsSameValue(const DataValue& left, const DataValue& right)
+	{
+		return left.type == right.type && ToInt64(left) == ToInt64(right);
+	}
+}
+
+size_t CallMemo::KeyHash::operator()(const Key& key) const
+{
+	auto hash = std::hash<const Node*>()(key.Func);
+	for (const auto arg : key.Args)
+		hash = hash * 31 + std::hash<int64_t>()(arg);
+	return hash;
+}
+
+CallMemo::CallMemo(SemanticTree& semTree, size_t capacity, size_t maxCallDepth)
+	: semTree(semTree), capacity(capacity), maxCallDepth(maxCallDepth)
+{
+}
+
+bool CallMemo::Enter(const Node* funcNode, const DataValue* args, size_t argsCount, size_t depth)
+{
+	// Arguments equal as 64-bit values stay equal when they are cast to the types of the params
+	Key key{ funcNode, {} };
+	key.Args.reserve(argsCount);
+	for (size_t i = 0; i < argsCount; i++)
+		key.Args.push_back(ToInt64(args[i]));
+
+	const auto found = index.find(key);
+	if (found != index.end() && IsReplayable(*found->second, depth))
+	{
+		const auto& entry = *found->second;
+		for (const auto& write : entry.Writes)
+			semTree.SetVariableValue(Address{ true, write.first }, write.second);
+		NoteCall(depth + entry.Height);
+		entries.splice(entries.begin(), entries, found->second);
+		stats.Hits++;
+		return true;
+	}
+
+	stats.Misses++;
+	if (frames.empty())
+		semTree.SetGlobalAccessObserver(this);
+	frames.push_back({ std::move(key), ++serialsCount, depth, depth, {}, {} });
+	return false;
+}
+
+void CallMemo::Leave()
+{
+	auto frame = std::move(frames.back());
+	frames.pop_back();
+	if (frames.empty())
+		semTree.SetGlobalAccessObserver(nullptr);
+
+	// Reading the stored values logs nothing new for the caller: the stores are already logged
+	Entry entry{ std::move(frame.CallKey), {}, {}, 0 };
+	for (const auto& read : frame.Reads)
+		entry.Reads.emplace_back(read.Index, read.Value);
+	for (const auto& write : frame.Writes)
+		entry.Writes.emplace_back(write.Index, semTree.GetVariableValue(Address{ true, write.Index }));
+
+	if (!frames.empty())
+	{
+		auto& caller = frames.back();
+		for (auto& read : frame.Reads)
+			if (read.Previous < caller.Serial)
+				caller.Reads.push_back(std::move(read));
+		for (auto& write : frame.Writes)
+			if (write.Previous < caller.Serial)
+				caller.Writes.push_back(std::move(write));
+	}
+
+	NoteCall(frame.Deepest);
+	if (frame.Deepest != SIZE_MAX)
+	{
+		entry.Height = frame.Deepest - frame.Depth;
+		Store(std::move(entry));
+	}
+}
+
+void CallMemo::NoteCall(size_t depth)
+{
+	if (!frames.empty())
+		frames.back().Deepest = std::max(frames.back().Deepest, depth);
+}
+
+void CallMemo::OnGlobalRead(size_t index, const DataValue& value)
+{
+	if (index >= lastAccess.size())
+	{
+		lastAccess.resize(index + 1);
+		lastWrite.resize(index + 1);
+	}
+	auto& frame = frames.back();
+	if (lastAccess[index] >= frame.Serial)
+		return;
+	frame.Reads.push_back({ index, value, lastAccess[index] });
+	lastAccess[index] = frame.Serial;
+}
+
+void CallMemo::OnGlobalWrite(size_t index)
+{
+	if (index >= lastAccess.size())
+	{
+		lastAccess.resize(index + 1);
+		lastWrite.resize(index + 1);
+	}
+	auto& frame = frames.back();
+	if (lastWrite[index] >= frame.Serial)
+		return;
+	frame.Writes.push_back({ index, DataValue(), lastWrite[index] });
+	lastWrite[index] = frame.Serial;
+	lastAccess[index] = std::max(lastAccess[index], frame.Serial);
+}
+
+bool CallMemo::IsReplayable(const Entry& entry, size_t depth) const
+{
+	if (depth >= maxCallDepth || entry.Height >= maxCallDepth - depth)
+		return false;
+	for (const auto& read : entry.Reads)
+	{
+		const Address address{ true, read.first };
+		if (!semTree.IsVariableInitialized(address) || !IsSameValue(semTree.GetVariableValue(address), read.second))
+			return false;
+	}
+	return true;
+}
+
+void CallMemo::Store(Entry entry)
+{
+	const auto found = index.find(entry.CallKey);
+	if (found != index.end())
+	{
+		*found->second = std::move(entry);
+		entries.splice(entries.begin(), entries, found->second);
+		return;
+	}
+
+	entries.push_front(std::move(entry));
+	index.emplace(entries.front().CallKey, entries.begin());
+	if (entries.size() > capacity)
+	{
+		index.erase(entries.back().CallKey);
+		entries.pop_back();
+		stats.Evictions++;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Semantics/SemanticTree.h"
+
+struct MemoStats
+{
+	size_t Hits = 0;
+	size_t Misses = 0;
+	size_t Evictions = 0;
+};
+
+// Interpreted calls with what they did to globals, so that an equal call is replayed instead of run.
+// A call is equal to a stored one of the same function with the same arguments if every global the
+// stored one read before storing it still holds the value it read; it is then given the values the
+// stored one left in the globals it stored. Reads after a store do not count, so a function that
+// keeps its result in a global, and reads it back after its recursive calls, is found again.
+// A replayed call must not have overflowed the stack where it is made now, so the deepest call
+// each one checked is kept. The least recently used calls are dropped beyond the capacity.
+class CallMemo : private GlobalAccessObserver
+{
+public:
+	CallMemo(SemanticTree& semTree, size_t capacity, size_t maxCallDepth);
+
+	// Replays the call at the depth of its caller and returns true if an equal one is stored,
+	// otherwise starts recording it until Leave; a call that raises is never stored
+	bool Enter(const Node* funcNode, const DataValue* args, size_t argsCount, size_t depth);
+	void Leave();
+
+	// A call was checked against the stack limit at depth, SIZE_MAX if no depth bounds it
+	void NoteCall(size_t depth);
+
+	const MemoStats& GetStats() const { return stats; }
+
+private:
+	struct Key
+	{
+		const Node* Func;
+		std::vector<int64_t> Args;
+
+		bool operator==(const Key& other) const { return Func == other.Func && Args == other.Args; }
+	};
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+	struct Entry
+	{
+		Key CallKey;
+		std::vector<std::pair<size_t, DataValue>> Reads, Writes;	// Global index -> value
+		size_t Height;							// Deepest checked call below the depth it was made at
+	};
+	struct Access
+	{
+		size_t Index;
+		DataValue Value;
+		size_t Previous;						// Serial of the call that logged the global before
+	};
+	// Reads are the globals it read before storing them, Writes the ones it stored; those of the
+	// calls it made are merged in as they return
+	struct Frame
+	{
+		Key CallKey;
+		size_t Serial;
+		size_t Depth, Deepest;
+		std::vector<Access> Reads, Writes;
+	};
+
+	void OnGlobalRead(size_t index, const DataValue& value) override;
+	void OnGlobalWrite(size_t index) override;
+	bool IsReplayable(const Entry& entry, size_t depth) const;
+	void Store(Entry entry);
+
+	SemanticTree& semTree;
+	size_t capacity, maxCallDepth;
+	MemoStats stats;
+
+	std::list<Entry> entries;					// Most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+	std::vector<Frame> frames;					// Recorded calls, innermost on top
+	size_t serialsCount = 0;
+	// Global index -> serial of the latest call that logged an access or a store of it, 0 if none;
+	// a call started later than the innermost one that logged it is nested in that one
+	std::vector<size_t> lastAccess, lastWrite;
+};
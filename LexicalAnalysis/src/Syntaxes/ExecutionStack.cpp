@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <exception>
+#include "ExecutionStack.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace
+{
+	struct Task
+	{
+		const std::function<void()>* body;
+		size_t stackSize;
+		std::uintptr_t* limit;
+		std::exception_ptr exception;
+	};
+
+	void Execute(Task& task)
+	{
+		char top;
+		*task.limit = reinterpret_cast<std::uintptr_t>(&top) - task.stackSize + ExecutionStack::MARGIN_SIZE;
+		try
+		{
+			(*task.body)();
+		}
+		catch (...)
+		{
+			task.exception = std::current_exception();
+		}
+		*task.limit = 0;
+	}
+
+#ifdef _WIN32
+	unsigned __stdcall ThreadEntry(void* task)
+	{
+		Execute(*static_cast<Task*>(task));
+		return 0;
+	}
+
+	bool RunThread(Task& task)
+	{
+		const auto thread = reinterpret_cast<HANDLE>(_beginthreadex(nullptr, static_cast<unsigned>(task.stackSize),
+			&ThreadEntry, &task, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr));
+		if (thread == nullptr)
+			return false;
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+		return true;
+	}
+#else
+	void* ThreadEntry(void* task)
+	{
+		Execute(*static_cast<Task*>(task));
+		return nullptr;
+	}
+
+	bool RunThread(Task& task)
+	{
+		pthread_attr_t attributes;
+		if (pthread_attr_init(&attributes) != 0)
+			return false;
+
+		pthread_t thread;
+		const auto isCreated = pthread_attr_setstacksize(&attributes, task.stackSize) == 0
+			&& pthread_create(&thread, &attributes, &ThreadEntry, &task) == 0;
+		pthread_attr_destroy(&attributes);
+		if (isCreated)
+			pthread_join(thread, nullptr);
+		return isCreated;
+	}
+#endif
+}
+
+void ExecutionStack::Run(const std::function<void()>& body)
+{
+	Task task{ &body, std::max(size, 2 * MARGIN_SIZE), &limit, nullptr };
+	if (!RunThread(task))
+		body();									// No stack of that size, the depth limit is the only guard
+	else if (task.exception)
+		std::rethrow_exception(task.exception);
+}
+
+bool ExecutionStack::IsExhausted() const
+{
+	char probe;
+	return reinterpret_cast<std::uintptr_t>(&probe) < limit;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+// Native stack the interpreter runs on.
+// Interpreted calls recurse through the analyser, so the depth a program may reach is bounded
+// by the stack of the thread, not by the heap; calls have no frames of their own on the heap.
+// Run executes on a thread of its own whose stack is reserved for the requested size, CALL_SIZE
+// a call; pages are committed only as deep as the program gets, about 0.75 KB a call, so a
+// depth of 10^6 takes about 750 MB. Exceptions are carried back to the caller of Run.
+class ExecutionStack
+{
+public:
+	explicit ExecutionStack(size_t size) : size(size) {}
+
+	void Run(const std::function<void()>& body);
+
+	// Less than a safe margin is left below the caller on the running stack
+	bool IsExhausted() const;
+	// Lowest address the running stack may safely reach, 0 outside of Run
+	std::uintptr_t GetLimit() const { return limit; }
+
+	size_t GetSize() const { return size; }
+	void SetSize(size_t stackSize) { size = stackSize; }
+
+	static size_t GetSizeForDepth(size_t callDepth) { return BASE_SIZE + callDepth * CALL_SIZE; }
+
+	static const size_t BASE_SIZE = 1024 * 1024;
+	static const size_t CALL_SIZE = 1024;				// Native stack budget of one interpreted call
+	static const size_t MARGIN_SIZE = 256 * 1024;
+
+private:
+	size_t size;
+	std::uintptr_t limit = 0;
+};
@@ -0,0 +1,558 @@
+#include <algorithm>
+#include <array>
+#include <climits>
+#include "LoopSummarizer.h"
+#include "SyntaxAnalyser.h"
+#include "Exceptions/AnalysisExceptions.h"
+
+namespace
+{
+	// Thrown by the symbolic iteration, Summarize turns them into its result
+	struct Declined {};
+	struct Unsupported {};
+
+	// Conditions the number of iterations follows from; == holds at most once
+	bool IsCountingComparison(LexemeType type)
+	{
+		return type == LexemeType::L || type == LexemeType::LE || type == LexemeType::G
+			|| type == LexemeType::GE || type == LexemeType::NE;
+	}
+
+	bool AddExact(int64_t left, int64_t right, int64_t& result)
+	{
+		if ((right > 0 && left > INT64_MAX - right) || (right < 0 && left < INT64_MIN - right))
+			return false;
+		result = left + right;
+		return true;
+	}
+
+	bool SubExact(int64_t left, int64_t right, int64_t& result)
+	{
+		if ((right < 0 && left > INT64_MAX + right) || (right > 0 && left < INT64_MIN + right))
+			return false;
+		result = left - right;
+		return true;
+	}
+
+	bool MulExact(int64_t left, int64_t right, int64_t& result)
+	{
+		const auto isOverflow = left > 0
+			? (right > 0 ? left > INT64_MAX / right : right < INT64_MIN / left)
+			: (right > 0 ? left < INT64_MIN / right : left != 0 && right < INT64_MAX / left);
+		if (isOverflow)
+			return false;
+		result = left * right;
+		return true;
+	}
+
+	// Square matrices of one size, row by row; products wrap modulo 2^64
+	std::vector<uint64_t> Multiply(const std::vector<uint64_t>& left, const std::vector<uint64_t>& right, size_t size)
+	{
+		std::vector<uint64_t> result(size * size);
+		for (size_t i = 0; i < size; i++)
+			for (size_t k = 0; k < size; k++)
+			{
+				const auto factor = left[i * size + k];
+				if (factor != 0)
+					for (size_t j = 0; j < size; j++)
+						result[i * size + j] += factor * right[k * size + j];
+			}
+		return result;
+	}
+
+	std::vector<uint64_t> Apply(const std::vector<uint64_t>& matrix, const std::vector<uint64_t>& vector)
+	{
+		const auto size = vector.size();
+		std::vector<uint64_t> result(size);
+		for (size_t i = 0; i < size; i++)
+			for (size_t j = 0; j < size; j++)
+				result[i] += matrix[i * size + j] * vector[j];
+		return result;
+	}
+
+	bool IsSameAddress(const Address& left, const Address& right)
+	{
+		return left.IsGlobal == right.IsGlobal && left.Index == right.Index;
+	}
+}
+
+LoopSummarizer::LoopSummarizer(Scanner& scanner, SemanticTree& semTree)
+	: scanner(scanner), semTree(semTree)
+{}
+
+LoopSummary LoopSummarizer::Summarize(size_t condPos, size_t stepPos, size_t bodyPos)
+{
+	const auto savedPos = scanner.GetCurPos();
+	auto summary = LoopSummary::Done;
+	try
+	{
+		const auto& lexemes = scanner.GetLexemes();
+		if (lexemes[condPos].type != LexemeType::Id || !IsCountingComparison(lexemes[condPos + 1].type))
+			throw Unsupported();
+
+		variables.assign(1, semTree.ResolveVariable(lexemes[condPos].str, condPos));
+		CollectVariables(stepPos, true);
+		CollectVariables(bodyPos, false);
+
+		const auto count = variables.size();
+		types.resize(count);
+		entryValues.assign(count + 1, 0);
+		isEntryAssigned.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			types[i] = semTree.GetVariableType(variables[i]);
+			isEntryAssigned[i] = semTree.IsVariableInitialized(variables[i]);
+			if (isEntryAssigned[i])
+			{
+				const auto value = semTree.PeekVariableValue(variables[i]);	// Run logs it if the map uses it
+				entryValues[i] = static_cast<uint64_t>(value.type == DataType::Long ? value.longVal : value.intVal);
+			}
+		}
+		entryValues[count] = 1;
+
+		ComputeIterationsCount(condPos, stepPos);
+		Run(bodyPos);
+	}
+	catch (const Unsupported&)
+	{
+		summary = LoopSummary::Unsupported;
+	}
+	catch (const Declined&)
+	{
+		summary = LoopSummary::Declined;
+	}
+	catch (const AnalysisException&)
+	{
+		summary = LoopSummary::Declined;			// The interpreter raises it where it belongs
+	}
+	scanner.SetCurPos(savedPos);
+	return summary;
+}
+
+// Lexemes of the step up to its ')' or of the body; whatever they may assign becomes a variable
+void LoopSummarizer::CollectVariables(size_t begin, bool isStep)
+{
+	const auto& lexemes = scanner.GetLexemes();
+	const auto isBlock = lexemes[begin].type == LexemeType::OpenBrace;
+	int depth = 0;
+	for (auto pos = begin; pos < lexemes.size(); pos++)
+	{
+		switch (lexemes[pos].type)
+		{
+		case LexemeType::OpenPar: case LexemeType::OpenBrace:
+			depth++;
+			break;
+		case LexemeType::ClosePar: case LexemeType::CloseBrace:
+			if (isStep && depth == 0)
+				return;
+			if (--depth == 0 && isBlock)
+				return;
+			break;
+		case LexemeType::Semi:
+			if (!isStep && !isBlock && depth == 0)
+				return;
+			break;
+		case LexemeType::Id: case LexemeType::Main:
+			if (lexemes[pos + 1].type == LexemeType::OpenPar || lexemes[pos + 1].type == LexemeType::Id)
+				throw Unsupported();
+			if (lexemes[pos + 1].type == LexemeType::Assign)
+				AddVariable(pos, isStep);
+			break;
+		case LexemeType::Inc: case LexemeType::Dec:
+		{
+			auto operand = pos + 1;
+			while (lexemes[operand].type == LexemeType::Inc || lexemes[operand].type == LexemeType::Dec)
+				operand++;
+			if (lexemes[operand].type == LexemeType::OpenPar)
+				throw Unsupported();
+			if (lexemes[operand].type == LexemeType::Id)
+				AddVariable(operand, isStep);
+			break;
+		}
+		case LexemeType::For: case LexemeType::Int: case LexemeType::Long: case LexemeType::Void:
+		case LexemeType::End: case LexemeType::Err:
+			throw Unsupported();
+		default:
+			break;
+		}
+	}
+	throw Unsupported();
+}
+
+// The step assigns only the counter, the body everything but the counter
+void LoopSummarizer::AddVariable(size_t pos, bool isStep)
+{
+	const auto address = semTree.ResolveVariable(scanner.GetLexemes()[pos].str, pos);
+	const auto isCounter = IsSameAddress(address, variables[0]);
+	if (isStep != isCounter)
+		throw Unsupported();
+	if (FindVariable(address) < 0)
+		variables.push_back(address);
+	if (variables.size() > MAX_VARIABLES)
+		throw Unsupported();
+}
+
+void LoopSummarizer::ResetValues()
+{
+	values.clear();
+	for (size_t i = 0; i < variables.size(); i++)
+		values.push_back(Variable(i));
+	isEntryValue.assign(variables.size(), true);
+}
+
+// The step must add a constant to the counter and the condition compare it with a constant.
+// The counter may not wrap: the interpreter would go on from the other end of its type
+void LoopSummarizer::ComputeIterationsCount(size_t condPos, size_t stepPos)
+{
+	iterationsCount = 0;
+	const auto constant = variables.size();
+
+	ResetValues();
+	scanner.SetCurPos(stepPos);
+	Assignment();
+	if (scanner.NextScan().type != LexemeType::ClosePar)
+		throw Unsupported();
+	const auto& counter = values[0];
+	if (isEntryValue[0])
+		throw Unsupported();
+	for (size_t i = 0; i < constant; i++)
+		if (counter.Coeffs[i] != (i == 0 ? 1u : 0u))
+			throw Unsupported();
+
+	const auto isLong = types[0] == DataType::Long;
+	step = isLong ? static_cast<int64_t>(counter.Coeffs[constant]) : static_cast<int>(counter.Coeffs[constant]);
+	if (step == 0)
+		throw Declined();
+
+	ResetValues();
+	scanner.SetCurPos(condPos + 1);
+	const auto operation = scanner.NextScan().type;
+	auto bound = Expression(SyntaxAnalyser::GetBinaryPrecedence(operation) + 1);
+	if (scanner.NextScan().type != LexemeType::Semi || !IsConstant(bound))
+		throw Unsupported();
+	Convert(bound, types[0]);
+
+	const auto first = static_cast<int64_t>(entryValues[0]);
+	const auto limit = static_cast<int64_t>(bound.Coeffs[constant]);
+	const auto isUp = step > 0;
+	const auto stride = isUp ? static_cast<uint64_t>(step) : 0 - static_cast<uint64_t>(step);
+	const auto distance = isUp ? static_cast<uint64_t>(limit) - static_cast<uint64_t>(first)
+		: static_cast<uint64_t>(first) - static_cast<uint64_t>(limit);
+	const auto isAhead = isUp ? first < limit : first > limit;
+	auto isFinite = false;
+	switch (operation)
+	{
+	case LexemeType::L: case LexemeType::G:
+		isFinite = isAhead && (operation == LexemeType::L) == isUp;
+		iterationsCount = distance / stride + (distance % stride != 0);
+		break;
+	case LexemeType::LE: case LexemeType::GE:
+		isFinite = (isAhead || first == limit) && (operation == LexemeType::LE) == isUp;
+		iterationsCount = distance / stride + 1;
+		break;
+	default:
+		isFinite = isAhead && distance % stride == 0;
+		iterationsCount = distance / stride;
+		break;
+	}
+
+	const auto maxValue = isLong ? static_cast<uint64_t>(INT64_MAX) : static_cast<uint64_t>(INT_MAX);
+	const auto minValue = isLong ? static_cast<uint64_t>(INT64_MIN) : static_cast<uint64_t>(static_cast<int64_t>(INT_MIN));
+	const auto room = isUp ? maxValue - static_cast<uint64_t>(first) : static_cast<uint64_t>(first) - minValue;
+	if (!isFinite || iterationsCount == 0 || iterationsCount > room / stride)
+		throw Declined();
+
+	firstCount = first;
+	const auto lastOffset = (iterationsCount - 1) * stride;
+	lastCount = static_cast<int64_t>(isUp ? static_cast<uint64_t>(first) + lastOffset : static_cast<uint64_t>(first) - lastOffset);
+}
+
+// One symbolic iteration gives the rows of the map, the step adds its constant to the counter
+void LoopSummarizer::Run(size_t bodyPos)
+{
+	ResetValues();
+	scanner.SetCurPos(bodyPos);
+	Statement();
+
+	const auto constant = variables.size(), size = constant + 1;
+	std::vector<uint64_t> map(size * size);
+	map[0] = 1;
+	map[constant] = static_cast<uint64_t>(step);
+	for (size_t i = 1; i < constant; i++)
+		std::copy(values[i].Coeffs.begin(), values[i].Coeffs.end(), map.begin() + i * size);
+	map[constant * size + constant] = 1;
+
+	// Values the variables had before the loop are read only if the map depends on them
+	for (size_t i = 0; i < constant; i++)
+	{
+		auto isRead = i == 0;
+		for (size_t row = 1; row < constant && !isRead; row++)
+			isRead = map[row * size + i] != 0;
+		if (isRead && isEntryAssigned[i])
+			semTree.GetVariableValue(variables[i]);
+	}
+
+	auto state = entryValues;
+	for (auto count = iterationsCount; count != 0; count >>= 1)
+	{
+		if (count & 1)
+			state = Apply(map, state);
+		if (count > 1)
+			map = Multiply(map, map, size);
+	}
+
+	for (size_t i = 0; i < constant; i++)
+		semTree.SetVariableValue(variables[i], types[i] == DataType::Long
+			? DataValue(static_cast<long long>(state[i])) : DataValue(static_cast<int>(state[i])));
+}
+
+void LoopSummarizer::Statement()
+{
+	const auto lexType = scanner.LookForward(1).type;
+	if (lexType == LexemeType::OpenBrace)
+	{
+		scanner.NextScan();											// Scan {
+		while (scanner.LookForward(1).type != LexemeType::CloseBrace)
+			Statement();
+		scanner.NextScan();											// Scan }
+	}
+	else
+	{
+		if (lexType != LexemeType::Semi)
+			Assignment();
+		if (scanner.NextScan().type != LexemeType::Semi)			// Scan ;
+			throw Unsupported();
+	}
+}
+
+LoopSummarizer::Affine LoopSummarizer::Assignment()
+{
+	if (scanner.LookForward(2).type != LexemeType::Assign)
+		return Expression(1);
+
+	const auto idPos = scanner.GetCurPos();
+	const auto& lex = scanner.NextScan();							// Scan Id
+	if (lex.type != LexemeType::Id)
+		throw Unsupported();
+	const auto index = FindVariable(semTree.ResolveVariable(lex.str, idPos));
+	if (index < 0)
+		throw Unsupported();
+	scanner.NextScan();												// Scan =
+
+	Store(index, Expression(1));
+	return values[index];
+}
+
+// Operations of one precedence are applied from left to right, as the interpreter does
+LoopSummarizer::Affine LoopSummarizer::Expression(int minPrecedence)
+{
+	int variable;
+	auto left = Prefix(&variable);
+	while (true)
+	{
+		const auto pos = scanner.GetCurPos();
+		const auto precedence = SyntaxAnalyser::GetBinaryPrecedence(scanner.LookForward(1).type);
+		if (precedence == 0 || precedence < minPrecedence)
+			return left;
+
+		const auto operation = scanner.NextScan().type;				// Scan binary operation
+		left = Binary(std::move(left), Expression(precedence + 1), operation, pos);
+	}
+}
+
+// variable receives the index of the variable the value is, -2 for a variable the loop does not assign
+LoopSummarizer::Affine LoopSummarizer::Prefix(int* variable)
+{
+	std::array<size_t, SyntaxAnalyser::MAX_PREFIX_OPERATIONS> opsPos;
+	int opsCount = 0;
+	while (SyntaxAnalyser::IsPrefixOperation(scanner.LookForward(1).type) && opsCount < SyntaxAnalyser::MAX_PREFIX_OPERATIONS)
+	{
+		opsPos[opsCount++] = scanner.GetCurPos();
+		scanner.NextScan();											// Scan ++, --, +, -
+	}
+
+	int operandVariable;
+	auto value = SyntaxAnalyser::IsPrefixOperation(scanner.LookForward(1).type)
+		? Prefix(&operandVariable) : Primary(&operandVariable);
+
+	const auto& lexemes = scanner.GetLexemes();
+	while (opsCount > 0)
+	{
+		const auto pos = opsPos[--opsCount];
+		const auto operation = lexemes[pos].type;
+		const auto one = Constant(value.Type == DataType::Long ? DataValue(1LL) : DataValue(1));
+		if (IsConstant(value))
+			value = Constant(semTree.PerformPrefixOperation(operation, ToValue(value), pos));
+		else if (operation == LexemeType::Minus)
+			value = Binary(Constant(DataValue(value.Type)), std::move(value), LexemeType::Minus, pos);
+		else if (operation != LexemeType::Plus)
+			value = Binary(std::move(value), one, operation == LexemeType::Inc ? LexemeType::Plus : LexemeType::Minus, pos);
+
+		if (operation == LexemeType::Inc || operation == LexemeType::Dec)
+		{
+			if (operandVariable == -2)
+				throw Unsupported();
+			if (operandVariable >= 0)
+				Store(operandVariable, value);
+		}
+		else
+			operandVariable = -1;
+	}
+
+	*variable = operandVariable;
+	return value;
+}
+
+LoopSummarizer::Affine LoopSummarizer::Primary(int* variable)
+{
+	*variable = -1;
+	const auto pos = scanner.GetCurPos();
+	const auto& lex = scanner.NextScan();							// Scan DecNum, HexNum, OctNum, Id, Main (
+
+	if (lex.type == LexemeType::OpenPar)
+	{
+		if (scanner.LookForward(2).type == LexemeType::Assign)
+			throw Unsupported();
+		auto value = Expression(1);
+		if (scanner.NextScan().type != LexemeType::ClosePar)		// Scan )
+			throw Unsupported();
+		return value;
+	}
+
+	if (lex.type == LexemeType::Id || lex.type == LexemeType::Main)
+	{
+		const auto address = semTree.ResolveVariable(lex.str, pos);
+		const auto index = FindVariable(address);
+		if (index < 0)
+		{
+			*variable = -2;
+			return Constant(semTree.GetVariableValue(address));	// Raises if it is not assigned
+		}
+		if (isEntryValue[index] && !isEntryAssigned[index])
+			throw Declined();
+		*variable = index;
+		return values[index];
+	}
+
+	if (lex.type == LexemeType::DecimNum || lex.type == LexemeType::HexNum || lex.type == LexemeType::OctNum)
+		return Constant(semTree.ConvertNumLexemeToValue(lex));
+
+	throw Unsupported();
+}
+
+LoopSummarizer::Affine LoopSummarizer::Constant(DataValue value) const
+{
+	const auto number = value.type == DataType::Long ? value.longVal : value.intVal;
+	Affine constant{ value.type, std::vector<uint64_t>(variables.size() + 1), true, number, number };
+	constant.Coeffs.back() = static_cast<uint64_t>(number);
+	return constant;
+}
+
+// Only the counter is known on every iteration, and only once the iterations are counted
+LoopSummarizer::Affine LoopSummarizer::Variable(size_t index) const
+{
+	Affine variable{ types[index], std::vector<uint64_t>(variables.size() + 1), index == 0 && iterationsCount > 0,
+		firstCount, lastCount };
+	variable.Coeffs[index] = 1;
+	return variable;
+}
+
+bool LoopSummarizer::IsConstant(const Affine& value)
+{
+	return std::all_of(value.Coeffs.begin(), value.Coeffs.end() - 1, [](uint64_t coeff) { return coeff == 0; });
+}
+
+DataValue LoopSummarizer::ToValue(const Affine& value)
+{
+	const auto number = value.Coeffs.back();
+	return value.Type == DataType::Long ? DataValue(static_cast<long long>(number)) : DataValue(static_cast<int>(number));
+}
+
+// An int is widened only if its value is the same modulo 2^64 as modulo 2^32
+void LoopSummarizer::Convert(Affine& value, DataType type) const
+{
+	if (value.Type == type)
+		return;
+	if (IsConstant(value))
+	{
+		auto constant = ToValue(value);
+		semTree.CastValue(&constant, type);
+		value = Constant(constant);
+		return;
+	}
+	if (type == DataType::Long && !value.IsExact)
+		throw Declined();
+	value.Type = type;
+	SetExact(value, value.IsExact, value.First, value.Last);
+}
+
+void LoopSummarizer::SetExact(Affine& value, bool isExact, int64_t first, int64_t last)
+{
+	const auto isInRange = value.Type == DataType::Long
+		|| (first >= INT_MIN && first <= INT_MAX && last >= INT_MIN && last <= INT_MAX);
+	value.IsExact = isExact && isInRange;
+	value.First = first;
+	value.Last = last;
+}
+
+// Constants are computed by the interpreter; other values only add up and scale by constants
+LoopSummarizer::Affine LoopSummarizer::Binary(Affine left, Affine right, LexemeType operation, size_t pos)
+{
+	if (IsConstant(left) && IsConstant(right))
+		return Constant(semTree.PerformOperation(ToValue(left), ToValue(right), operation, pos));
+
+	Convert(right, left.Type);
+	const auto isExact = left.IsExact && right.IsExact;
+	int64_t first = 0, last = 0;
+	auto isComputed = false;
+	auto result = std::move(left);
+	switch (operation)
+	{
+	case LexemeType::Plus:
+		for (size_t i = 0; i < result.Coeffs.size(); i++)
+			result.Coeffs[i] += right.Coeffs[i];
+		isComputed = AddExact(result.First, right.First, first) && AddExact(result.Last, right.Last, last);
+		break;
+	case LexemeType::Minus:
+		for (size_t i = 0; i < result.Coeffs.size(); i++)
+			result.Coeffs[i] -= right.Coeffs[i];
+		isComputed = SubExact(result.First, right.First, first) && SubExact(result.Last, right.Last, last);
+		break;
+	case LexemeType::Mul:
+	{
+		if (!IsConstant(result) && !IsConstant(right))
+			throw Unsupported();
+		const auto isLeftConstant = IsConstant(result);
+		const auto factor = isLeftConstant ? result.Coeffs.back() : right.Coeffs.back();
+		const auto& scaled = isLeftConstant ? right.Coeffs : result.Coeffs;
+		std::vector<uint64_t> coeffs(scaled.size());
+		for (size_t i = 0; i < coeffs.size(); i++)
+			coeffs[i] = scaled[i] * factor;
+		result.Coeffs = std::move(coeffs);
+		isComputed = MulExact(result.First, right.First, first) && MulExact(result.Last, right.Last, last);
+		break;
+	}
+	default:
+		throw Unsupported();
+	}
+	SetExact(result, isExact && isComputed, first, last);
+
+	if (IsConstant(result))
+		return Constant(ToValue(result));
+	return result;
+}
+
+void LoopSummarizer::Store(size_t index, Affine value)
+{
+	Convert(value, types[index]);
+	values[index] = std::move(value);
+	isEntryValue[index] = false;
+}
+
+int LoopSummarizer::FindVariable(const Address& address) const
+{
+	for (size_t i = 0; i < variables.size(); i++)
+		if (IsSameAddress(variables[i], address))
+			return static_cast<int>(i);
+	return -1;
+}
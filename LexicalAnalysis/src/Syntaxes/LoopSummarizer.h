@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Lexical/Scanner.h"
+#include "Semantics/SemanticTree.h"
+
+// Declined: the values of this run do not fit; Unsupported: no run of the loop can fit
+enum class LoopSummary
+{
+	Done, Declined, Unsupported
+};
+
+// Runs the rest of a for loop at once when its step adds a constant to a counter the condition
+// compares with a bound that does not change, and its body only assigns sums of variables and
+// their multiples by values that do not change either. An iteration is then an affine map of the
+// assigned variables, the counter among them, and the loop is that map raised to the number of
+// iterations by squaring: O(log n) products of matrices as small as the number of variables.
+// Arithmetic is modulo 2^64, which gives long values exactly and int ones in their low 32 bits,
+// since truncation commutes with sums and products; an int value is widened to long only if it
+// depends on the counter alone and wraps on none of the iterations.
+class LoopSummarizer
+{
+public:
+	LoopSummarizer(Scanner& scanner, SemanticTree& semTree);
+
+	// The condition has just held; on Done the variables have the values the loop leaves them with
+	LoopSummary Summarize(size_t condPos, size_t stepPos, size_t bodyPos);
+
+	static const size_t MAX_VARIABLES = 16;
+
+private:
+	struct Affine
+	{
+		DataType Type;
+		std::vector<uint64_t> Coeffs;			// Of the assigned variables, then the constant term
+		bool IsExact;							// Depends on the counter alone and does not wrap
+		int64_t First, Last;					// Values on the first and the last iteration if exact
+	};
+
+	void CollectVariables(size_t begin, bool isStep);
+	void AddVariable(size_t pos, bool isStep);
+	void ResetValues();
+	void ComputeIterationsCount(size_t condPos, size_t stepPos);
+	void Run(size_t bodyPos);
+
+	void Statement();
+	Affine Assignment();
+	Affine Expression(int minPrecedence);
+	Affine Prefix(int* variable);
+	Affine Primary(int* variable);
+
+	Affine Constant(DataValue value) const;
+	Affine Variable(size_t index) const;
+	static bool IsConstant(const Affine& value);
+	static DataValue ToValue(const Affine& value);
+	void Convert(Affine& value, DataType type) const;
+	static void SetExact(Affine& value, bool isExact, int64_t first, int64_t last);
+	Affine Binary(Affine left, Affine right, LexemeType operation, size_t pos);
+	void Store(size_t index, Affine value);
+	int FindVariable(const Address& address) const;
+
+	Scanner& scanner;
+	SemanticTree& semTree;
+
+	std::vector<Address> variables;				// Assigned by the loop, the counter is the first one
+	std::vector<DataType> types;
+	int64_t step = 0;
+	uint64_t iterationsCount = 0;
+	int64_t firstCount = 0, lastCount = 0;		// Counter on the first and the last iteration
+
+	std::vector<Affine> values;					// Of the variables during the symbolic iteration
+	std::vector<bool> isEntryValue;				// Variable is not assigned yet in the iteration
+	std::vector<uint64_t> entryValues;
+	std::vector<bool> isEntryAssigned;
+};
@@ -1,28 +1,78 @@
-﻿#include <stack>
+﻿#include <algorithm>
+#include <array>
+#include <sstream>
 #include "SyntaxAnalyser.h"
+#include "Aot/AotMachine.h"
+#include "Bytecode/Compiler.h"
+#include "Bytecode/Optimizer.h"
+#include "Bytecode/VirtualMachine.h"
+#include "Jit/JitMachine.h"
 #include "Exceptions/AnalysisExceptions.h"
 
 
-void SyntaxAnalyser::PrintAnalysis()
+SyntaxAnalyser::SyntaxAnalyser(const std::istream& srcStream, const std::string& cacheDirectory)
+	: semTree(std::make_unique<SemanticTree>()), aotDirectory(cacheDirectory)
+{
+	std::stringstream sb;
+	sb << srcStream.rdbuf();
+	auto source = sb.str();
+
+	if (!cacheDirectory.empty())
+	{
+		cache = std::make_unique<ProgramCache>(cacheDirectory, source);
+		std::vector<Lexeme> lexemes;
+		isCacheLoaded = cache->Load(lexemes, checkedBodies);
+		if (isCacheLoaded)
+		{
+			scanner = std::make_unique<Scanner>(std::move(lexemes));
+			return;
+		}
+		checkedBodies.clear();
+	}
+	scanner = std::make_unique<Scanner>(std::move(source));
+}
+
+
+void SyntaxAnalyser::PrintAnalysis(TreeFormat format)
 {
 	try
 	{
 		Program();
-		semTree->Print();
+		semTree->Print(std::cout, format);
 	}
 	catch (AnalysisException& ex)
 	{
-		auto pos = scanner->GetCurPos();
-		std::cout << "(" << pos.row << ", " << pos.column << "): " << ex.what() << std::endl;
+		const auto& lex = scanner->GetLastLexeme();
+		std::cout << "(" << lex.row << ", " << lex.endColumn << "): " << ex.what() << std::endl;
 
 	}
 }
 
 void SyntaxAnalyser::Program()
 {
+	if (isCheckOnly)
+		TranslationUnit();						// Nothing is called, the stack of the caller is enough
+	else
+		executionStack.Run([this] { TranslationUnit(); });
+}
+
+void SyntaxAnalyser::TranslationUnit()
+{
+	const auto useSnapshot = snapshot && !isCheckOnly;
+	if (useSnapshot)
+	{
+		const auto resumePos = snapshot->Restore(scanner->GetLexemes(), *semTree);
+		isSnapshotRestored = resumePos != 0;
+		if (isSnapshotRestored)
+			scanner->SetCurPos(resumePos);
+	}
+
 	auto firstLex = scanner->LookForward(1);
 	auto lex = scanner->LookForward(3);
 	while (firstLex.type != LexemeType::End) {
+		if (useSnapshot && !isSnapshotRestored && scanner->LookForward(2).type == LexemeType::Main)
+			snapshot->Save(scanner->GetLexemes(), scanner->GetCurPos(), *semTree);
+
 		if (lex.type == LexemeType::OpenPar)
 			FuncDecl();
 		else
@@ -30,6 +80,22 @@ void SyntaxAnalyser::Program()
 		firstLex = scanner->LookForward(1);
 		lex = scanner->LookForward(3);
 	}
+
+	if (cache && !isCacheLoaded)
+		cache->Store(scanner->GetLexemes(), checkedBodies);
+}
+
+void SyntaxAnalyser::Check()
+{
+	isCheckOnly = true;
+	Program();
+	isCheckOnly = false;
+}
+
+void SyntaxAnalyser::SetMaxCallDepth(size_t depth)
+{
+	maxCallDepth = depth;
+	executionStack.SetSize(ExecutionStack::GetSizeForDepth(depth));
 }
 
 void SyntaxAnalyser::FuncDecl()
@@ -55,15 +121,140 @@ void SyntaxAnalyser::FuncDecl()
 	CheckExpectedLexeme(lex, LexemeType::ClosePar);
 
 
-	semTree->SetFunctionPos(funcNode, scanner->GetCurPos());
-	if (!isMain)
-		semTree->IsInterpretation = false;
+	const auto bodyPos = scanner->GetCurPos();
+	semTree->SetFunctionPos(funcNode, bodyPos);
+	CheckFuncBody();
+	if (isMain && !isCheckOnly && engine != ExecutionEngine::Interpreter)
+		RunBytecode(funcNode);
+	else if (isMain && !isCheckOnly)
+	{
+		if (isCallElimination || memoCapacity > 0)
+			AnalyseCalls(funcNode);
+		const auto bodyEndPos = scanner->GetCurPos();
+		scanner->SetCurPos(bodyPos);
+		CompStat();
+		scanner->SetCurPos(bodyEndPos);
+	}
+	if (isMain)
+		semTree->AddEmpty();
 
-	CompStat();
+	semTree->LeaveFunctionScope(funcNode);
+}
+
+void SyntaxAnalyser::CheckFuncBody()
+{
+	const auto bodyPos = scanner->GetCurPos();
+	const auto checkedBody = checkedBodies.find(bodyPos);
+	if (checkedBody != checkedBodies.end())
+	{
+		scanner->SetCurPos(checkedBody->second);			// Body was checked by the run that stored the cache
+		return;
+	}
 
+	semTree->IsInterpretation = false;
+	CompStat();
 	semTree->IsInterpretation = true;
 
-	semTree->SetCurrentNode(funcNode);
+	checkedBodies[bodyPos] = scanner->GetCurPos();
+}
+
+template <class Machine>
+void SyntaxAnalyser::RunMachine(Machine& machine, const BytecodeProgram& program, const std::vector<bool>& readGlobals)
+{
+	const auto& globals = program.Globals;
+	for (size_t i = 0; i < globals.size(); i++)
+		if (semTree->IsVariableInitialized(globals[i].Addr))
+			machine.SetGlobal(i, readGlobals[i] ? semTree->GetVariableValue(globals[i].Addr)
+				: semTree->PeekVariableValue(globals[i].Addr));
+
+	// Globals keep what was assigned before an error, as they do in the interpreter
+	const auto storeGlobals = [&]
+	{
+		for (size_t i = 0; i < globals.size(); i++)
+			if (machine.IsGlobalAssigned(i))
+				semTree->SetVariableValue(globals[i].Addr, machine.GetGlobal(i));
+	};
+	try
+	{
+		machine.Run();
+	}
+	catch (AnalysisException&)
+	{
+		storeGlobals();
+		scanner->SetCurPos(machine.GetErrorPosition());		// Where the interpreter would report it
+		throw;
+	}
+	storeGlobals();
+}
+
+void SyntaxAnalyser::RunBytecode(const Node* funcNode)
+{
+	bytecode = std::make_unique<BytecodeProgram>(Compiler(*scanner, *semTree).Compile(funcNode));
+	FoldKnownGlobals(*bytecode);
+	if (isCallElimination)
+		RemoveEffectFreeCalls(*bytecode, maxCallDepth);
+	const auto calls = InlineCalls(*bytecode, inlineThresholds, maxCallDepth);
+	inlinedCalls.insert(inlinedCalls.end(), calls.begin(), calls.end());
+	const std::vector<bool> readGlobals(bytecode->Globals.size(), true);	// main runs in no recorded call
+
+	if (engine == ExecutionEngine::Jit)
+	{
+		JitMachine jit(*bytecode, maxCallDepth, executionStack.GetLimit());
+		if (jit.Compile())
+		{
+			RunMachine(jit, *bytecode, readGlobals);
+			return;
+		}
+	}
+	else if (engine == ExecutionEngine::Aot)
+	{
+		AotMachine aot(*bytecode, maxCallDepth, executionStack.GetLimit());
+		if (aot.Compile(aotDirectory.empty() ? AotMachine::GetDefaultDirectory() : aotDirectory))
+		{
+			RunMachine(aot, *bytecode, readGlobals);
+			return;
+		}
+	}
+	VirtualMachine machine(*bytecode, maxCallDepth);
+	RunMachine(machine, *bytecode, readGlobals);
+}
+
+// The program runs to the end of main, so a global it never stores keeps the value it has now
+void SyntaxAnalyser::FoldKnownGlobals(BytecodeProgram& program) const
+{
+	const auto globalsCount = program.Globals.size();
+	std::vector<bool> knownGlobals(globalsCount);
+	std::vector<int64_t> globalValues(globalsCount);
+	for (size_t i = 0; i < globalsCount; i++)
+	{
+		const auto& address = program.Globals[i].Addr;
+		knownGlobals[i] = semTree->IsVariableInitialized(address);
+		if (knownGlobals[i])
+		{
+			const auto value = semTree->GetVariableValue(address);
+			globalValues[i] = value.type == DataType::Long ? value.longVal : value.intVal;
+		}
+	}
+	FoldConstants(program, knownGlobals, globalValues);
+}
+
+// The interpreter runs main itself; its compiled code only tells which calls it can skip and which
+// ones are worth remembering: those with effects, since the others are skipped or cost no more to run
+void SyntaxAnalyser::AnalyseCalls(const Node* funcNode)
+{
+	auto program = Compiler(*scanner, *semTree).Compile(funcNode);
+	FoldKnownGlobals(program);
+	const auto effects = AnalyseEffects(program);
+	const auto heights = GetCallHeights(program);
+	for (size_t i = 1; i < program.Functions.size(); i++)
+	{
+		if (effects[i].IsEffectFree() && isCallElimination)
+			effectFreeFunctions.emplace(program.Functions[i].FuncNode, heights[i]);
+		else if (!effects[i].IsEffectFree() && memoCapacity > 0)
+			memoizedFunctions.insert(program.Functions[i].FuncNode);
+	}
+	if (!memoizedFunctions.empty())
+		callMemo = std::make_unique<CallMemo>(*semTree, memoCapacity, maxCallDepth);
 }
 
 void SyntaxAnalyser::DataDecl()
@@ -79,13 +270,12 @@ void SyntaxAnalyser::DataDecl()
 		if (lex.type != LexemeType::Id)
 			throw InvalidIdentifierException(lex.str);
 
-		const auto varNode = semTree->AddVariable(leftType, lex.str);
+		const auto varAddress = semTree->AddVariable(leftType, lex.str);
 
 		lex = scanner->NextScan();												//Scan '=', ',', ';'
 
 		if (lex.type == LexemeType::Assign) {
-			auto rightValue = AssignExpr();
-			semTree->SetVariableValue(varNode, semTree->CloneValue(rightValue));
+			semTree->SetVariableValue(varAddress, AssignExpr());
 
 			lex = scanner->NextScan();											//Scan  ',', ';'
 		}
@@ -95,7 +285,7 @@ void SyntaxAnalyser::DataDecl()
 	CheckExpectedLexeme(lex, LexemeType::Semi);
 }
 
-void SyntaxAnalyser::Params(const Node* funcNode) const
+void SyntaxAnalyser::Params(Node* funcNode) const
 {
 	while (true) {
 
@@ -125,22 +315,19 @@ void SyntaxAnalyser::Params(const Node* funcNode) const
 
 void SyntaxAnalyser::Stat()
 {
-	auto lex = scanner->LookForward(1);
-	if (IsDataType(lex.type) || lex.type == LexemeType::Id && scanner->LookForward(2).type == LexemeType::Id)
+	const auto lexType = scanner->LookForward(1).type;
+	if (IsDataType(lexType) || (lexType == LexemeType::Id && scanner->LookForward(2).type == LexemeType::Id))
 		DataDecl();
-	else if (lex.type == LexemeType::OpenBrace)
+	else if (lexType == LexemeType::OpenBrace)
 		CompStat();
-	else if (lex.type == LexemeType::For)
+	else if (lexType == LexemeType::For)
 		For();
 	else {
 		// Expressions
-		if (lex.type != LexemeType::Semi)
+		if (lexType != LexemeType::Semi)
 			AssignExpr();
 
-		lex = scanner->NextScan();					// Scan ;
-
-		CheckExpectedLexeme(lex, LexemeType::Semi);
-
+		CheckExpectedLexeme(scanner->NextScan(), LexemeType::Semi);		// Scan ;
 	}
 }
 
@@ -149,53 +336,66 @@ void SyntaxAnalyser::CompStat()
 
 	scanner->NextScan();						// Scan {
 
-	const auto node = semTree->AddEmpty();		// Add empty node
-	semTree->AddScope();						// Go down
+	semTree->EnterScope();
 
-	auto lex = scanner->LookForward(1);
-	while (lex.type != LexemeType::CloseBrace)
-	{
+	while (scanner->LookForward(1).type != LexemeType::CloseBrace)
 		Stat();
-		lex = scanner->LookForward(1);
-	}
-	lex = scanner->NextScan();					// Scan }
+	scanner->NextScan();						// Scan }
 
-	semTree->SetCurrentNode(node);				// Restore empty node
-
-	semTree->DeleteSubTree(node);
+	semTree->LeaveScope();						// Slots of the block are reused by the next one
 }
 
 void SyntaxAnalyser::For()
 {
 	auto savedIsInterpret = semTree->IsInterpretation;
 
+	const auto forPos = scanner->GetCurPos();
 	scanner->NextScan();									// Scan for
 
-	auto lex = scanner->NextScan();								// Scan (
-	CheckExpectedLexeme(lex, LexemeType::OpenPar);
+	CheckExpectedLexeme(scanner->NextScan(), LexemeType::OpenPar);		// Scan (
 
-	auto savedNode = semTree->AddEmpty();
-	semTree->AddScope();
+	semTree->EnterScope();
 
 	DataDecl();
 
 	auto condPos = scanner->GetCurPos();
 	auto condValue = AssignExpr();
-	semTree->CastValue(condValue.get(), DataType::Int);
+	semTree->CastValue(&condValue, DataType::Int);
 
 
-	lex = scanner->NextScan();								// Scan ;
-	CheckExpectedLexeme(lex, LexemeType::Semi);
+	CheckExpectedLexeme(scanner->NextScan(), LexemeType::Semi);			// Scan ;
 
 	const auto exprPos = scanner->GetCurPos();
 	semTree->IsInterpretation = false;
 	AssignExpr();
-	semTree->IsInterpretation = savedIsInterpret && condValue->intVal != 0;
+	semTree->IsInterpretation = savedIsInterpret && condValue.intVal != 0;
 
-	lex = scanner->NextScan();								// Scan )
-	CheckExpectedLexeme(lex, LexemeType::ClosePar);
+	CheckExpectedLexeme(scanner->NextScan(), LexemeType::ClosePar);		// Scan )
+
+	size_t statStartPos = scanner->GetCurPos(), statEndPos;
+
+	// A summarized loop leaves only its body to be checked, as a loop whose condition fails
+	if (semTree->IsInterpretation && isLoopSummarization && !IsDataType(scanner->LookForward(1).type))
+	{
+		auto& profile = loops[forPos];
+		if (profile.IsSummarizable)
+		{
+			if (loopSummarizer == nullptr)
+				loopSummarizer = std::make_unique<LoopSummarizer>(*scanner, *semTree);
+			const auto summary = loopSummarizer->Summarize(condPos, exprPos, statStartPos);
+			profile.IsSummarizable = summary != LoopSummary::Unsupported;
+			if (summary == LoopSummary::Done)
+			{
+				summarizedLoopsCount++;
+				semTree->IsInterpretation = false;
+			}
+		}
+	}
 
-	SourceText::Iterator statStartPos = scanner->GetCurPos(), statEndPos;
+	// A declaration as the body would be declared again by every compiled iteration
+	const auto isProfiled = semTree->IsInterpretation && engine == ExecutionEngine::Interpreter
+		&& osrThreshold > 0 && !IsDataType(scanner->LookForward(1).type);
+	const auto loop = isProfiled ? &loops[forPos] : nullptr;
 
 	do
 	{
@@ -208,8 +408,15 @@ void SyntaxAnalyser::For()
 
 			scanner->SetCurPos(condPos);
 			condValue = AssignExpr();
-			semTree->CastValue(condValue.get(), DataType::Int);
-			semTree->IsInterpretation = savedIsInterpret && condValue->intVal != 0;
+			semTree->CastValue(&condValue, DataType::Int);
+			semTree->IsInterpretation = savedIsInterpret && condValue.intVal != 0;
+
+			// The next iteration and the rest of them run compiled
+			if (semTree->IsInterpretation && loop != nullptr && ++loop->Iterations >= osrThreshold)
+			{
+				RunCompiledLoop(*loop, statStartPos, exprPos, condPos);
+				semTree->IsInterpretation = false;
+			}
 		}
 
 	} while (semTree->IsInterpretation);
@@ -217,197 +424,348 @@ void SyntaxAnalyser::For()
 	scanner->SetCurPos(statEndPos);
 	semTree->IsInterpretation = savedIsInterpret;
 
-	semTree->SetCurrentNode(savedNode);
-	semTree->DeleteSubTree(savedNode);
+	semTree->LeaveScope();
 }
 
-std::shared_ptr<DataValue> SyntaxAnalyser::AssignExpr()
+void SyntaxAnalyser::RunCompiledLoop(LoopProfile& loop, size_t bodyPos, size_t stepPos, size_t condPos)
 {
-	auto lex = scanner->LookForward(2);
-	if (lex.type == LexemeType::Assign)
+	const auto localsCount = semTree->GetFrameLocalsCount();
+	std::vector<bool> assignedSlots(localsCount);
+	Address address;
+	for (address.Index = 0; address.Index < localsCount; address.Index++)
+		assignedSlots[address.Index] = semTree->IsVariableInitialized(address);
+
+	// Unassigned slots are compiled with checks, so code compiled for other ones cannot be reused;
+	// calls inlined for some depth could overflow the stack elsewhere than the interpreter deeper
+	const auto depth = semTree->GetCallDepth();
+	if (loop.Program == nullptr || loop.AssignedSlots != assignedSlots || (loop.DependsOnDepth && depth > loop.CallDepth))
 	{
-		lex = scanner->NextScan();										// Scan Id
-		CheckExpectedLexeme(lex, LexemeType::Id);
-
-		const auto node = semTree->FindVariableNodeUp(lex.str);
-
-		lex = scanner->NextScan();										// Scan =
+		loop.Program = std::make_unique<BytecodeProgram>(
+			Compiler(*scanner, *semTree).CompileLoop(bodyPos, stepPos, condPos, assignedSlots));
+		FoldConstants(*loop.Program);					// The interpreter may store any global between the runs
+		const auto callsBudget = maxCallDepth > depth ? maxCallDepth - depth : 0;
+		const auto removedCount = isCallElimination ? RemoveEffectFreeCalls(*loop.Program, callsBudget) : 0;
+		const auto calls = InlineCalls(*loop.Program, inlineThresholds, callsBudget);
+		inlinedCalls.insert(inlinedCalls.end(), calls.begin(), calls.end());
+		loop.AssignedSlots = assignedSlots;
+		loop.CallDepth = depth;
+		loop.DependsOnDepth = removedCount != 0 || !calls.empty();
+		loop.CallsHeight = GetCallHeights(*loop.Program)[0];
+		loop.ReadGlobals = AnalyseEffects(*loop.Program)[0].ReadGlobals;
+
+		ParallelLoop parallel;
+		const auto isParallel = threadsCount > 1 && AnalyseParallelLoop(*loop.Program, localsCount, callsBudget, parallel);
+		loop.Parallel = isParallel ? std::make_unique<ParallelLoop>(std::move(parallel)) : nullptr;
+	}
+	if (callMemo)
+		callMemo->NoteCall(loop.CallsHeight == UNBOUNDED_CALLS ? UNBOUNDED_CALLS : depth + loop.CallsHeight);
+	if (loop.Parallel != nullptr && depth <= loop.CallDepth && RunParallelLoop(loop, assignedSlots, depth))
+		return;
 
-		semTree->SetVariableValue(node, semTree->CloneValue(EqualExpr()));
+	VirtualMachine machine(*loop.Program, maxCallDepth, depth);
+	for (address.Index = 0; address.Index < localsCount; address.Index++)
+		if (assignedSlots[address.Index])
+			machine.SetLocal(address.Index, semTree->GetVariableValue(address));
 
-		auto value = semTree->GetVariableValue(node);
-		return value;
+	const auto storeLocals = [&]
+	{
+		for (address.Index = 0; address.Index < localsCount; address.Index++)
+			if (machine.IsLocalAssigned(address.Index))
+				semTree->SetVariableValue(address, machine.GetLocal(address.Index, semTree->GetVariableType(address)));
+	};
+	try
+	{
+		RunMachine(machine, *loop.Program, loop.ReadGlobals);
 	}
-	return EqualExpr();
-}
-
-std::shared_ptr<DataValue> SyntaxAnalyser::EqualExpr()
-{
-	auto leftValue = CmpExpr();
-	auto lex = scanner->LookForward(1);
-	while (lex.type == LexemeType::E || lex.type == LexemeType::NE)
+	catch (AnalysisException&)
 	{
-		lex = scanner->NextScan();											// Scan ==, !=
-		auto rightValue = CmpExpr();
-
-		leftValue = semTree->PerformOperation(leftValue, rightValue, lex.type);
-		lex = scanner->LookForward(1);
+		storeLocals();
+		throw;
 	}
-	return leftValue;
+	storeLocals();
 }
 
-std::shared_ptr<DataValue> SyntaxAnalyser::CmpExpr()
+// Every part of the iterations runs on its own machine with the reductions started from 0 or 1,
+// and the values they leave are combined with those from before the loop
+bool SyntaxAnalyser::RunParallelLoop(const LoopProfile& loop, const std::vector<bool>& assignedSlots, size_t depth)
 {
-	auto leftValue = AddExpr();
-	auto lex = scanner->LookForward(1);
-	while (lex.type == LexemeType::G || lex.type == LexemeType::GE
-		|| lex.type == LexemeType::L || lex.type == LexemeType::LE)
+	const auto& counted = loop.Parallel->Loop;
+	const auto& globals = loop.Program->Globals;
+	Address address{ false, counted.Counter };
+	const auto counterValue = semTree->GetVariableValue(address);
+	const auto counter = counterValue.type == DataType::Long ? counterValue.longVal : counterValue.intVal;
+	const auto iterations = GetIterationsCount(counted, counter);
+	const auto partsCount = static_cast<size_t>(std::min<uint64_t>(threadsCount, iterations / MIN_PARALLEL_ITERATIONS));
+	if (partsCount < 2)
+		return false;
+
+	std::vector<DataValue> locals(assignedSlots.size()), globalValues(globals.size());
+	for (address.Index = 0; address.Index < assignedSlots.size(); address.Index++)
+		if (assignedSlots[address.Index])
+			locals[address.Index] = semTree->GetVariableValue(address);
+	std::vector<bool> isGlobalAssigned(globals.size());
+	for (size_t i = 0; i < globals.size(); i++)
 	{
-		lex = scanner->NextScan();													// Scan >, >=, <, <=
-		const auto rightValue = AddExpr();
+		isGlobalAssigned[i] = semTree->IsVariableInitialized(globals[i].Addr);
+		if (isGlobalAssigned[i])
+			globalValues[i] = semTree->GetVariableValue(globals[i].Addr);
+	}
+	for (const auto& reduction : loop.Parallel->Reductions)
+		if (!isGlobalAssigned[reduction.Global])
+			return false;
+
+	std::vector<BytecodeProgram> programs;
+	std::vector<VirtualMachine> machines;
+	programs.reserve(partsCount);
+	machines.reserve(partsCount);
+	uint64_t first = 0;
+	for (size_t part = 0; part < partsCount; part++)
+	{
+		const auto last = first + iterations / partsCount + (part < iterations % partsCount ? 1 : 0);
+		programs.push_back(LimitLoop(*loop.Program, counted, AdvanceCounter(counted, counter, last)));
+		machines.emplace_back(programs.back(), maxCallDepth, depth);
+		auto& machine = machines.back();
+		for (size_t slot = 0; slot < assignedSlots.size(); slot++)
+			if (assignedSlots[slot])
+				machine.SetLocal(slot, locals[slot]);
+		const auto start = AdvanceCounter(counted, counter, first);
+		machine.SetLocal(counted.Counter, counterValue.type == DataType::Long
+			? DataValue(static_cast<long long>(start)) : DataValue(static_cast<int>(start)));
+		for (size_t i = 0; i < globals.size(); i++)
+			if (isGlobalAssigned[i])
+				machine.SetGlobal(i, globalValues[i]);
+		for (const auto& reduction : loop.Parallel->Reductions)
+		{
+			const auto identity = reduction.IsProduct ? 1 : 0;
+			machine.SetGlobal(reduction.Global, globals[reduction.Global].Type == DataType::Long
+				? DataValue(static_cast<long long>(identity)) : DataValue(identity));
+		}
+		first = last;
+	}
 
-		leftValue = semTree->PerformOperation(leftValue, rightValue, lex.type);
+	if (threadPool == nullptr)
+		threadPool = std::make_unique<ThreadPool>(threadsCount - 1);
+	threadPool->Run(partsCount, [&](size_t part) { machines[part].Run(); });
 
-		lex = scanner->LookForward(1);
+	for (const auto& reduction : loop.Parallel->Reductions)
+	{
+		const auto& global = globals[reduction.Global];
+		const auto& before = globalValues[reduction.Global];
+		auto value = static_cast<uint64_t>(before.type == DataType::Long ? before.longVal : before.intVal);
+		for (const auto& machine : machines)
+		{
+			const auto partValue = machine.GetGlobal(reduction.Global);
+			const auto result = static_cast<uint64_t>(partValue.type == DataType::Long ? partValue.longVal : partValue.intVal);
+			value = reduction.IsProduct ? value * result : value + result;
+		}
+		semTree->SetVariableValue(global.Addr, global.Type == DataType::Long
+			? DataValue(static_cast<long long>(value)) : DataValue(static_cast<int>(value)));
 	}
-	return leftValue;
+
+	// The last part leaves the counter and the locals as the last iteration does
+	const auto& lastMachine = machines.back();
+	for (address.Index = 0; address.Index < assignedSlots.size(); address.Index++)
+		if (lastMachine.IsLocalAssigned(address.Index))
+			semTree->SetVariableValue(address, lastMachine.GetLocal(address.Index, semTree->GetVariableType(address)));
+	parallelLoopsCount++;
+	return true;
 }
 
-std::shared_ptr<DataValue> SyntaxAnalyser::AddExpr()
+size_t SyntaxAnalyser::GetCompiledLoopsCount() const
 {
-	auto leftValue = MultExpr();
-	auto lex = scanner->LookForward(1);
-	while (lex.type == LexemeType::Plus
-		|| lex.type == LexemeType::Minus)
+	return static_cast<size_t>(std::count_if(loops.begin(), loops.end(),
+		[](const std::pair<const size_t, LoopProfile>& loop) { return loop.second.Program != nullptr; }));
+}
+
+DataValue SyntaxAnalyser::AssignExpr(Address* variable)
+{
+	if (scanner->LookForward(2).type == LexemeType::Assign)
 	{
-		scanner->NextScan();													// Scan +, -
-		const auto rightValue = MultExpr();
+		const auto idPos = scanner->GetCurPos();
+		const auto& lex = scanner->NextScan();							// Scan Id
+		CheckExpectedLexeme(lex, LexemeType::Id);
 
-		leftValue = semTree->PerformOperation(leftValue, rightValue, lex.type);
+		const auto address = semTree->ResolveVariable(lex.str, idPos);
 
-		lex = scanner->LookForward(1);
+		scanner->NextScan();											// Scan =
+
+		semTree->SetVariableValue(address, BinaryExpr());
+
+		if (variable)
+			*variable = address;
+		return semTree->GetVariableValue(address);
 	}
-	return leftValue;
+	return BinaryExpr(variable);
 }
 
-std::shared_ptr<DataValue> SyntaxAnalyser::MultExpr()
+DataValue SyntaxAnalyser::BinaryExpr(Address* variable)
 {
-	auto leftValue = PrefixExpr();
-	auto lex = scanner->LookForward(1);
-	while (lex.type == LexemeType::Mul
-		|| lex.type == LexemeType::Div
-		|| lex.type == LexemeType::Modul)
+	// Operators on the stack always have strictly increasing precedence,
+	// so it never holds more than one operator per precedence level.
+	// Only positions are kept, operators are read back from the lexemes
+	std::array<DataValue, BINARY_PRECEDENCE_LEVELS + 1> values;
+	std::array<size_t, BINARY_PRECEDENCE_LEVELS> opsPos;
+	int opsCount = 0;
+
+	const auto& lexemes = scanner->GetLexemes();
+	if (IsFuncCallForward())
 	{
-		scanner->NextScan();												// Scan *, /, %
-		const auto rightValue = PrefixExpr();
+		if (variable)
+			*variable = Address();
+		values[0] = FuncCall();											// Saves the prefix and postfix frames on each call
+	}
+	else
+		values[0] = PrefixExpr(variable);
+	while (true)
+	{
+		const auto precedence = GetBinaryPrecedence(scanner->LookForward(1).type);
+
+		while (opsCount > 0 && GetBinaryPrecedence(lexemes[opsPos[opsCount - 1]].type) >= precedence)
+		{
+			--opsCount;
+			const auto pos = opsPos[opsCount];
+			values[opsCount] = semTree->PerformOperation(values[opsCount], values[opsCount + 1], lexemes[pos].type, pos);
+		}
 
-		leftValue = semTree->PerformOperation(leftValue, rightValue, lex.type);
+		if (precedence == 0)
+			return values[0];
 
-		lex = scanner->LookForward(1);
+		if (variable)
+			*variable = Address();										// Result of an operation is not a variable
+		opsPos[opsCount++] = scanner->GetCurPos();
+		scanner->NextScan();												// Scan binary operation
+		values[opsCount] = PrefixExpr();
 	}
-	return leftValue;
 }
 
-std::shared_ptr<DataValue> SyntaxAnalyser::PrefixExpr()
+DataValue SyntaxAnalyser::PrefixExpr(Address* variable)
 {
-	auto lex = scanner->LookForward(1);
-	std::stack<Lexeme> ops;
-	while (lex.type == LexemeType::Inc || lex.type == LexemeType::Dec
-		|| lex.type == LexemeType::Plus || lex.type == LexemeType::Minus)
+	std::array<size_t, MAX_PREFIX_OPERATIONS> opsPos;
+	int opsCount = 0;
+
+	while (IsPrefixOperation(scanner->LookForward(1).type) && opsCount < MAX_PREFIX_OPERATIONS)
 	{
-		lex = scanner->NextScan();										// Scan ++, --, +, -
-		ops.push(lex);
-		lex = scanner->LookForward(1);
+		opsPos[opsCount++] = scanner->GetCurPos();
+		scanner->NextScan();										// Scan ++, --, +, -
 	}
-	auto value = PostfixExpr();
 
-	while (!ops.empty())
-	{
-		lex = ops.top();
-		value = semTree->PerformPrefixOperation(lex.type, value);
+	// ++ and -- store their result while the operand is still a variable
+	Address operandVariable;
+	auto value = IsPrefixOperation(scanner->LookForward(1).type) ? PrefixExpr(&operandVariable) : PostfixExpr(&operandVariable);
 
-		ops.pop();
+	const auto& lexemes = scanner->GetLexemes();
+	while (opsCount > 0)
+	{
+		const auto pos = opsPos[--opsCount];
+		const auto operation = lexemes[pos].type;
+		value = semTree->PerformPrefixOperation(operation, value, pos);
+		if (operation == LexemeType::Inc || operation == LexemeType::Dec)
+		{
+			if (operandVariable.IsResolved())
+				semTree->SetVariableValue(operandVariable, value);
+		}
+		else
+			operandVariable = Address();
 	}
+
+	if (variable)
+		*variable = operandVariable;
 	return value;
 }
 
-std::shared_ptr<DataValue> SyntaxAnalyser::PostfixExpr()
+DataValue SyntaxAnalyser::PostfixExpr(Address* variable)
 {
-	auto lex = scanner->LookForward(1);
-	auto lex2 = scanner->LookForward(2);
-	if ((lex.type == LexemeType::Id || lex.type == LexemeType::Main)
-		&& lex2.type == LexemeType::OpenPar)							// func call
-	{
-		FuncCall();
-		return semTree->IsInterpretation ? std::make_shared<DataValue>(DataType::Void) : nullptr;
-	}
+	if (IsFuncCallForward())
+		return FuncCall();
 
-	return PrimExpr();
+	return PrimExpr(variable);
 }
 
-void SyntaxAnalyser::FuncCall()
+DataValue SyntaxAnalyser::FuncCall()
 {
-	auto lex = scanner->NextScan();							// Scan Id, main
-
-	auto funcNode = semTree->FindFunctionNodeUp(lex.str);
+	const auto idPos = scanner->GetCurPos();
+	const auto funcNode = semTree->ResolveFunction(scanner->NextScan().str, idPos);	// Scan Id, main
 
 	scanner->NextScan();											// Scan (
 
-	std::vector<std::shared_ptr<DataValue>> args;
-	lex = scanner->LookForward(1);
+	const auto argsBase = callArgs.size();
 	// work with arguments
-	if (lex.type != LexemeType::ClosePar)
+	if (scanner->LookForward(1).type != LexemeType::ClosePar)
 	{
+		const Lexeme* lex;
 		do
 		{
-			auto value = AssignExpr();
-			args.push_back(value);
+			callArgs.push_back(AssignExpr());
 
-			lex = scanner->NextScan();								// Scan ,
-		} while (lex.type == LexemeType::Comma);
-		CheckExpectedLexeme(lex, LexemeType::ClosePar);
+			lex = &scanner->NextScan();								// Scan ,
+		} while (lex->type == LexemeType::Comma);
+		CheckExpectedLexeme(*lex, LexemeType::ClosePar);
 
 	}
 	else
 		scanner->NextScan();
 
-	semTree->CheckValidFuncArgs(funcNode, args);
+	const auto args = callArgs.data() + argsBase;
+	const auto argsCount = callArgs.size() - argsBase;
+	semTree->CheckValidFuncArgs(funcNode, args, argsCount);
 
 	if (semTree->IsInterpretation)
 	{
+		const auto depth = semTree->GetCallDepth();
+		const auto effectFree = effectFreeFunctions.find(funcNode);
+		if (effectFree != effectFreeFunctions.end() && depth + effectFree->second < maxCallDepth)
+		{
+			if (callMemo)
+				callMemo->NoteCall(depth + effectFree->second);
+			skippedCallsCount++;
+			callArgs.resize(argsBase);
+			return DataValue(DataType::Void);
+		}
+		if (depth >= maxCallDepth || executionStack.IsExhausted())
+			throw StackOverflowException(funcNode->Data.GetIdentifier(), depth + 1);
+		if (callMemo)
+			callMemo->NoteCall(depth);
+		const auto isMemoized = callMemo && memoizedFunctions.count(funcNode) != 0;
+		if (isMemoized && callMemo->Enter(funcNode, args, argsCount, depth))
+		{
+			callArgs.resize(argsBase);
+			return DataValue(DataType::Void);
+		}
+
 		auto savedPos = scanner->GetCurPos();
-		auto savedNode = semTree->GetCurrentNode();
 
 		scanner->SetCurPos(semTree->GetFunctionPos(funcNode));
-		auto cloneFuncNode = semTree->CloneFunctionDefinition(funcNode);
-
-		semTree->SetCurrentNode(cloneFuncNode);
-		semTree->AssignParamsWithArgs(args);
+		semTree->EnterFunction(funcNode, args, argsCount);
 		CompStat();
-		semTree->DeleteFuncDefinition(cloneFuncNode);
+		semTree->LeaveFunction();
 
-		semTree->SetCurrentNode(savedNode);
 		scanner->SetCurPos(savedPos);
+		if (isMemoized)
+			callMemo->Leave();
 	}
+	callArgs.resize(argsBase);
+	return DataValue(DataType::Void);
 }
 
 
-std::shared_ptr<DataValue> SyntaxAnalyser::PrimExpr()
+DataValue SyntaxAnalyser::PrimExpr(Address* variable)
 {
-	auto lex = scanner->NextScan();								// Scan DecNum, HexNum, OctNum, Id, Main (
+	const auto lexPos = scanner->GetCurPos();
+	const auto& lex = scanner->NextScan();						// Scan DecNum, HexNum, OctNum, Id, Main (
 
 	if (lex.type == LexemeType::OpenPar)								// (expr)
 	{
-		auto resValue = AssignExpr();
-		lex = scanner->NextScan();
-		CheckExpectedLexeme(lex, LexemeType::ClosePar);
+		auto resValue = AssignExpr(variable);
+		CheckExpectedLexeme(scanner->NextScan(), LexemeType::ClosePar);
 		return resValue;
 	}
 
 	if (lex.type == LexemeType::Id || lex.type == LexemeType::Main)		// identifier
 	{
-		auto value = semTree->GetVariableValue(semTree->FindVariableNodeUp(lex.str));
-		return value;
+		const auto address = semTree->ResolveVariable(lex.str, lexPos);
+		if (variable)
+			*variable = address;
+		return semTree->GetVariableValue(address);
 	}
 
 	if (lex.type == LexemeType::DecimNum || lex.type == LexemeType::HexNum
@@ -431,8 +789,38 @@ bool SyntaxAnalyser::IsTypeForward(LexemeType type, int distance) const
 	return lex.type == type;
 }
 
+bool SyntaxAnalyser::IsFuncCallForward() const
+{
+	const auto lexType = scanner->LookForward(1).type;
+	return (lexType == LexemeType::Id || lexType == LexemeType::Main)
+		&& scanner->LookForward(2).type == LexemeType::OpenPar;
+}
+
 
 bool SyntaxAnalyser::IsDataType(LexemeType code)
 {
 	return code == LexemeType::Int || code == LexemeType::Long;
 }
+
+int SyntaxAnalyser::GetBinaryPrecedence(LexemeType code)
+{
+	switch (code)
+	{
+	case LexemeType::E: case LexemeType::NE:
+		return 1;
+	case LexemeType::G: case LexemeType::GE: case LexemeType::L: case LexemeType::LE:
+		return 2;
+	case LexemeType::Plus: case LexemeType::Minus:
+		return 3;
+	case LexemeType::Mul: case LexemeType::Div: case LexemeType::Modul:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+bool SyntaxAnalyser::IsPrefixOperation(LexemeType code)
+{
+	return code == LexemeType::Inc || code == LexemeType::Dec
+		|| code == LexemeType::Plus || code == LexemeType::Minus;
+}
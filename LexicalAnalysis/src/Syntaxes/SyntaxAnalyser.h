@@ -1,46 +1,187 @@
 #pragma once
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Bytecode/Bytecode.h"
+#include "Bytecode/Effects.h"
+#include "Bytecode/Inliner.h"
+#include "Bytecode/ParallelLoop.h"
+#include "Cache/ProgramCache.h"
+#include "Cache/Snapshot.h"
+#include "ExecutionStack.h"
 #include "Lexical/Scanner.h"
 #include "Semantics/SemanticTree.h"
+#include "CallMemo.h"
+#include "LoopSummarizer.h"
+#include "ThreadPool.h"
+
+// Interpreter runs main right out of its lexemes, Bytecode compiles main and the functions
+// it calls when main is reached and runs them on the virtual machine, Jit translates that
+// bytecode to x86-64 code and Aot to a C library built by the system compiler; both fall
+// back to the virtual machine where they cannot
+enum class ExecutionEngine
+{
+	Interpreter, Bytecode, Jit, Aot
+};
 
 class SyntaxAnalyser
 {
 public:
-	SyntaxAnalyser(const std::istream& srcStream)
-		: scanner(std::make_unique<Scanner>(srcStream)),
-		semTree(std::make_unique<SemanticTree>())
-	{}
-	void PrintAnalysis();
+	explicit SyntaxAnalyser(const std::istream& srcStream, const std::string& cacheDirectory = "");
+	void PrintAnalysis(TreeFormat format = TreeFormat::Text);
 
 	void Program();
+	void Check();
 
 	SemanticTree* GetSemTree() { return semTree.get(); }
+	const Scanner* GetScanner() const { return scanner.get(); }
+
+	const std::unordered_map<size_t, size_t>& GetCheckedBodies() const { return checkedBodies; }
+	void SetCheckedBodies(std::unordered_map<size_t, size_t> bodies) { checkedBodies = std::move(bodies); }
+
+	// Program resumes from the snapshot at path if it was made for it, otherwise
+	// the state before the declaration of main is saved there
+	void SetSnapshotPath(const std::string& path) { snapshot = std::make_unique<Snapshot>(path); }
+	bool IsSnapshotRestored() const { return isSnapshotRestored; }
+
+	// Deeper calls stop the program with StackOverflowException, the native stack is reserved for this depth
+	void SetMaxCallDepth(size_t depth);
+	size_t GetMaxCallDepth() const { return maxCallDepth; }
+
+	static const size_t DEFAULT_MAX_CALL_DEPTH = 100000;
+
+	void SetExecutionEngine(ExecutionEngine executionEngine) { engine = executionEngine; }
+	const BytecodeProgram* GetBytecode() const { return bytecode.get(); }
+	// Libraries built by Aot are kept there; the cache directory if there is one, otherwise a temporary one
+	void SetAotDirectory(const std::string& directory) { aotDirectory = directory; }
+
+	// An interpreted for loop that has run this many iterations, over all of its runs, is compiled
+	// and its current run goes on in the virtual machine; 0 keeps every loop interpreted
+	void SetOsrThreshold(size_t iterations) { osrThreshold = iterations; }
+	size_t GetCompiledLoopsCount() const;
+
+	static const size_t DEFAULT_OSR_THRESHOLD = 1000;
+
+	// The rest of a compiled loop whose iterations depend on each other only through sums and
+	// products into globals is split between this many threads, see AnalyseParallelLoop;
+	// 1 keeps every loop on the running thread
+	void SetThreadsCount(size_t count) { threadsCount = count; }
+	size_t GetParallelLoopsCount() const { return parallelLoopsCount; }
+
+	static const size_t MIN_PARALLEL_ITERATIONS = 4096;		// Of a thread
+
+	// Compiled code has the calls of small functions replaced with their code, see InlineCalls
+	void SetInlineThresholds(InlineThresholds thresholds) { inlineThresholds = thresholds; }
+	const std::vector<InlinedCall>& GetInlinedCalls() const { return inlinedCalls; }
+
+	// Calls of functions that store no globals, raise no errors and surely return are skipped by the
+	// interpreter and removed from compiled code, see AnalyseEffects
+	void SetCallElimination(bool isEnabled) { isCallElimination = isEnabled; }
+	size_t GetSkippedCallsCount() const { return skippedCallsCount; }
+
+	// Interpreted calls of functions that store globals or may raise are kept, up to capacity of
+	// them, and equal ones replayed, see CallMemo; 0 turns it off
+	void SetMemoization(size_t capacity) { memoCapacity = capacity; }
+	MemoStats GetMemoStats() const { return callMemo ? callMemo->GetStats() : MemoStats(); }
+
+	// An interpreted loop that counts to a fixed bound and only adds up and scales variables is
+	// computed at once when it starts, see LoopSummarizer
+	void SetLoopSummarization(bool isEnabled) { isLoopSummarization = isEnabled; }
+	size_t GetSummarizedLoopsCount() const { return summarizedLoopsCount; }
+
+	// Grammar shared with the bytecode compiler
+	static bool IsDataType(LexemeType code);
+	static int GetBinaryPrecedence(LexemeType code);
+	static bool IsPrefixOperation(LexemeType code);
+
+	static const int BINARY_PRECEDENCE_LEVELS = 4;
+	static const int MAX_PREFIX_OPERATIONS = 16;
 private:
+	void TranslationUnit();
 	void FuncDecl();
+	void CheckFuncBody();
+	void RunBytecode(const Node* funcNode);
+	void FoldKnownGlobals(BytecodeProgram& program) const;
+	void AnalyseCalls(const Node* funcNode);
+	// Only readGlobals are logged as read, the others are passed on to a program that never loads them
+	template <class Machine> void RunMachine(Machine& machine, const BytecodeProgram& program, const std::vector<bool>& readGlobals);
 	void DataDecl();
-	void Params(const Node* funcNode) const;
+	void Params(Node* funcNode) const;
 	void Stat();
 	void CompStat();
 	void For();
-	void FuncCall();
+	struct LoopProfile;
+	void RunCompiledLoop(LoopProfile& loop, size_t bodyPos, size_t stepPos, size_t condPos);
+	bool RunParallelLoop(const LoopProfile& loop, const std::vector<bool>& assignedSlots, size_t depth);
+	DataValue FuncCall();
 
 
-	std::shared_ptr<DataValue> AssignExpr();
-	std::shared_ptr<DataValue> EqualExpr();
-	std::shared_ptr<DataValue> CmpExpr();
-	std::shared_ptr<DataValue> AddExpr();
-	std::shared_ptr<DataValue> MultExpr();
-	std::shared_ptr<DataValue> PrefixExpr();
-	std::shared_ptr<DataValue> PostfixExpr();
-	std::shared_ptr<DataValue> PrimExpr();
+	// variable receives the address whose value is the result, if the expression is a variable
+	DataValue AssignExpr(Address* variable = nullptr);
+	DataValue BinaryExpr(Address* variable = nullptr);
+	DataValue PrefixExpr(Address* variable = nullptr);
+	DataValue PostfixExpr(Address* variable = nullptr);
+	DataValue PrimExpr(Address* variable = nullptr);
 
 
 	static void CheckExpectedLexeme(const Lexeme& givenLexeme, LexemeType expected);
 	bool IsTypeForward(LexemeType type, int distance = 1) const;
-	static bool IsDataType(LexemeType code);
+	bool IsFuncCallForward() const;
 
 
 	std::unique_ptr<Scanner> scanner;
 	std::unique_ptr<SemanticTree> semTree;
+
+	std::unique_ptr<ProgramCache> cache;
+	bool isCacheLoaded = false;
+	std::unordered_map<size_t, size_t> checkedBodies;		// Function body start -> end positions
+
+	std::unique_ptr<Snapshot> snapshot;
+	bool isSnapshotRestored = false;
+
+	bool isCheckOnly = false;
+	std::vector<DataValue> callArgs;						// Arguments of the calls being evaluated, innermost on top
+
+	ExecutionEngine engine = ExecutionEngine::Interpreter;
+	std::unique_ptr<BytecodeProgram> bytecode;
+	std::string aotDirectory;
+
+	struct LoopProfile
+	{
+		size_t Iterations = 0;
+		std::unique_ptr<BytecodeProgram> Program;
+		std::vector<bool> AssignedSlots;					// Slots that held values when it was compiled
+		size_t CallDepth = 0;								// Its inlined and removed calls are valid in frames up to this depth
+		bool DependsOnDepth = false;
+		size_t CallsHeight = 0;								// Longest chain of calls its code makes
+		std::vector<bool> ReadGlobals;						// Globals its code and callees may load
+		std::unique_ptr<ParallelLoop> Parallel;
+		bool IsSummarizable = true;
+	};
+	std::unordered_map<size_t, LoopProfile> loops;			// Position of the for -> its profile
+	size_t osrThreshold = DEFAULT_OSR_THRESHOLD;
+
+	size_t threadsCount = std::thread::hardware_concurrency();
+	std::unique_ptr<ThreadPool> threadPool;
+	size_t parallelLoopsCount = 0;
+
+	InlineThresholds inlineThresholds;
+	std::vector<InlinedCall> inlinedCalls;
+
+	bool isCallElimination = true;
+	std::unordered_map<const Node*, size_t> effectFreeFunctions;	// Function -> longest chain of calls below it
+	size_t skippedCallsCount = 0;
+
+	size_t memoCapacity = 0;
+	std::unique_ptr<CallMemo> callMemo;
+	std::unordered_set<const Node*> memoizedFunctions;
+
+	bool isLoopSummarization = true;
+	std::unique_ptr<LoopSummarizer> loopSummarizer;
+	size_t summarizedLoopsCount = 0;
+
+	size_t maxCallDepth = DEFAULT_MAX_CALL_DEPTH;
+	ExecutionStack executionStack{ ExecutionStack::GetSizeForDepth(DEFAULT_MAX_CALL_DEPTH) };
 };
 
 
@@ -0,0 +1,73 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadsCount)
+{
+	for (size_t i = 0; i < threadsCount; i++)
+		threads.emplace_back(&ThreadPool::Work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isStopping = true;
+	}
+	started.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+}
+
+void ThreadPool::Run(size_t count, const std::function<void(size_t)>& part)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	job = &part;
+	partsCount = count;
+	nextPart = 0;
+	exception = nullptr;
+	started.notify_all();
+
+	RunParts(lock);
+	finished.wait(lock, [this] { return nextPart == partsCount && runningCount == 0; });
+	job = nullptr;
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+void ThreadPool::Work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		started.wait(lock, [this] { return isStopping || (job != nullptr && nextPart < partsCount); });
+		if (isStopping)
+			return;
+		RunParts(lock);
+	}
+}
+
+// Takes parts until none is left, the lock is released while one runs
+void ThreadPool::RunParts(std::unique_lock<std::mutex>& lock)
+{
+	while (nextPart < partsCount)
+	{
+		const auto index = nextPart++;
+		const auto& part = *job;
+		runningCount++;
+		lock.unlock();
+		std::exception_ptr partException;
+		try
+		{
+			part(index);
+		}
+		catch (...)
+		{
+			partException = std::current_exception();
+		}
+		lock.lock();
+		runningCount--;
+		if (partException && !exception)
+			exception = partException;
+	}
+	if (runningCount == 0)
+		finished.notify_all();
+}
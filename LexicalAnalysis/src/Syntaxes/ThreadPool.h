@@ -0,0 +1,36 @@
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that take the parts of a job together with its caller and wait for the next one
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t threadsCount);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs part(0) .. part(count - 1) and returns when all of them have;
+	// the first exception one raised is rethrown
+	void Run(size_t count, const std::function<void(size_t)>& part);
+
+	size_t GetThreadsCount() const { return threads.size() + 1; }
+
+private:
+	void Work();
+	void RunParts(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable started, finished;
+	bool isStopping = false;
+
+	const std::function<void(size_t)>* job = nullptr;
+	size_t partsCount = 0, nextPart = 0, runningCount = 0;
+	std::exception_ptr exception;
+};
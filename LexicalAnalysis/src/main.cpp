@@ -1,13 +1,127 @@
 ﻿#include <iostream>
 #include <fstream>
+#include <thread>
+#include "Bytecode/Disassembler.h"
+#include "Daemon/AnalysisDaemon.h"
 #include "Syntaxes/SyntaxAnalyser.h"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
-int main()
+// Usage: LexicalAnalysis [source file] [--cache <directory>] [--snapshot <file>] [--tree text|json|binary]
+//                        [--max-depth <calls>] [--engine interpreter|bytecode|jit|aot] [--disasm]
+//                        [--osr-threshold <iterations>] [--no-loop-summary]
+//                        [--inline-size <instructions>] [--inline-single-call-size <instructions>] [--inline-report]
+//                        [--no-call-elimination] [--memoize <calls>] [--memo-stats] [--threads <count>]
+//        LexicalAnalysis --daemon
+int main(int argc, char* argv[])
 {
 	setlocale(LC_ALL, "rus");
+	std::string sourcePath = "tested.cpp", cacheDirectory, snapshotPath;
+	auto treeFormat = TreeFormat::Text;
+	size_t maxCallDepth = SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH;
+	auto engine = ExecutionEngine::Interpreter;
+	auto isDisassembled = false;
+	size_t osrThreshold = SyntaxAnalyser::DEFAULT_OSR_THRESHOLD;
+	auto isLoopSummarization = true;
+	InlineThresholds inlineThresholds;
+	auto isInlineReported = false;
+	auto isCallElimination = true;
+	size_t memoCapacity = 0;
+	auto isMemoReported = false;
+	size_t threadsCount = std::thread::hardware_concurrency();
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--daemon")
+		{
+			AnalysisDaemon daemon;
+			daemon.Run(std::cin, std::cout);
+			return 0;
+		}
+		if (arg == "--cache" && i + 1 < argc)
+			cacheDirectory = argv[++i];
+		else if (arg == "--snapshot" && i + 1 < argc)
+			snapshotPath = argv[++i];
+		else if (arg == "--max-depth" && i + 1 < argc)
+			maxCallDepth = std::stoul(argv[++i]);
+		else if (arg == "--engine" && i + 1 < argc)
+		{
+			const std::string name = argv[++i];
+			if (name == "interpreter")
+				engine = ExecutionEngine::Interpreter;
+			else if (name == "bytecode")
+				engine = ExecutionEngine::Bytecode;
+			else if (name == "jit")
+				engine = ExecutionEngine::Jit;
+			else if (name == "aot")
+				engine = ExecutionEngine::Aot;
+			else
+			{
+				std::cerr << "Unknown engine " << name << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "--osr-threshold" && i + 1 < argc)
+			osrThreshold = std::stoul(argv[++i]);
+		else if (arg == "--no-loop-summary")
+			isLoopSummarization = false;
+		else if (arg == "--inline-size" && i + 1 < argc)
+			inlineThresholds.MaxSize = std::stoul(argv[++i]);
+		else if (arg == "--inline-single-call-size" && i + 1 < argc)
+			inlineThresholds.MaxSingleCallSize = std::stoul(argv[++i]);
+		else if (arg == "--inline-report")
+			isInlineReported = true;
+		else if (arg == "--no-call-elimination")
+			isCallElimination = false;
+		else if (arg == "--memoize" && i + 1 < argc)
+			memoCapacity = std::stoul(argv[++i]);
+		else if (arg == "--memo-stats")
+			isMemoReported = true;
+		else if (arg == "--threads" && i + 1 < argc)
+			threadsCount = std::stoul(argv[++i]);
+		else if (arg == "--disasm")
+			isDisassembled = true;
+		else if (arg == "--tree" && i + 1 < argc)
+		{
+			if (!TreePrinter::ParseFormat(argv[++i], treeFormat))
+			{
+				std::cerr << "Unknown tree format " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else
+			sourcePath = arg;
+	}
+
 	std::ofstream fout("output.txt");
-	std::ifstream fin("tested.cpp");
-	SyntaxAnalyser analyser(fin);
-	analyser.PrintAnalysis();
+	std::ifstream fin(sourcePath);
+	SyntaxAnalyser analyser(fin, cacheDirectory);
+	if (!snapshotPath.empty())
+		analyser.SetSnapshotPath(snapshotPath);
+	analyser.SetMaxCallDepth(maxCallDepth);
+	analyser.SetExecutionEngine(engine);
+	analyser.SetOsrThreshold(osrThreshold);
+	analyser.SetLoopSummarization(isLoopSummarization);
+	analyser.SetInlineThresholds(inlineThresholds);
+	analyser.SetCallElimination(isCallElimination);
+	analyser.SetMemoization(memoCapacity);
+	analyser.SetThreadsCount(threadsCount);
+#ifdef _WIN32
+	if (treeFormat == TreeFormat::Binary)
+		_setmode(_fileno(stdout), _O_BINARY);		// Keeps bytes of the records from newline translation
+#endif
+	analyser.PrintAnalysis(treeFormat);
+	if (isDisassembled && analyser.GetBytecode())
+		Disassemble(*analyser.GetBytecode());
+	if (isInlineReported)
+		PrintInlineReport(analyser.GetInlinedCalls(), analyser.GetScanner()->GetLexemes());
+	if (isMemoReported)
+	{
+		const auto stats = analyser.GetMemoStats();
+		std::cout << "Memoized calls: " << stats.Hits << " hits, " << stats.Misses << " misses, "
+			<< stats.Evictions << " evictions" << std::endl;
+	}
 	return 0;
 }
@@ -3,18 +3,18 @@
 
 #include "Syntaxes/SyntaxAnalyser.h"
 
-inline SyntaxAnalyser RunSyntaxAnalyser(std::string src)
+inline SyntaxAnalyser RunSyntaxAnalyser(std::string src, std::string cacheDirectory = "")
 {
 	std::stringstream ss(src);
-	SyntaxAnalyser sa(ss);
+	SyntaxAnalyser sa(ss, cacheDirectory);
 	sa.Program();
 	return sa;
 }
 
 inline std::shared_ptr<DataValue> GetValueOfVariable(SyntaxAnalyser& sa, std::string id)
 {
-	auto node = sa.GetSemTree()->FindVariableNodeUp(id);
-	return sa.GetSemTree()->GetVariableValue(node);
+	const auto address = sa.GetSemTree()->FindVariable(id);
+	return std::make_shared<DataValue>(sa.GetSemTree()->GetVariableValue(address));
 }
 
 
@@ -2,7 +2,17 @@
 #include "CppUnitTest.h"
 #include "HelperFunctions.h"
 
+#include "Aot/AotMachine.h"
+#include "Bytecode/Disassembler.h"
+#include "Daemon/AnalysisDaemon.h"
+#include "Daemon/Json.h"
+#include "Jit/Assembler.h"
 #include "Exceptions/AnalysisExceptions.h"
+
+#include <fstream>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 namespace InterpretationTests
@@ -95,6 +105,38 @@ namespace InterpretationTests
 			auto resVal = GetValueOfVariable(sa, "res");
 			Assert::AreEqual(resVal->intVal, 20);
 		}
+
+		TEST_METHOD(LocalsKeptAcrossNestedCalls)
+		{
+			auto sa = RunSyntaxAnalyser(
+				R"(
+					int  res = 0;
+					void deep(int n) {
+						int a = n;
+						for (int loops = 1; n < 50 * loops; --loops)
+							deep(n + 1);
+						res = res + a - n;
+					}
+					void main() { int x = 7; deep(0); res = res + x; })");
+			auto resVal = GetValueOfVariable(sa, "res");
+			Assert::AreEqual(resVal->intVal, 7);
+		}
+
+		TEST_METHOD(DeepRecursion)
+		{
+			std::stringstream ss(R"(
+				long res = 0;
+				void deep(long n) {
+					for (int loops = 1; n < 300000L * loops; --loops)
+						deep(n + 1);
+					res = res + n;
+				}
+				void main() { deep(1); })");
+			SyntaxAnalyser sa(ss);
+			sa.SetMaxCallDepth(300000);
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->longVal, 300000LL * 300001LL / 2);
+		}
 	};
 
 	TEST_CLASS(Expressions)
@@ -294,6 +336,44 @@ namespace InterpretationTests
 			Assert::AreEqual(res->intVal, 2);
 		}
 
+		TEST_METHOD(IncDecOnlyStoreToVariable)
+		{
+			auto sa = RunSyntaxAnalyser(
+				R"(
+					int a = 1, b = 1, c, d;
+					void main() { c = -++a; d = ++-b; ++(a); }
+				)"
+			);
+			Assert::AreEqual(GetValueOfVariable(sa, "a")->intVal, 3);
+			Assert::AreEqual(GetValueOfVariable(sa, "b")->intVal, 1);
+			Assert::AreEqual(GetValueOfVariable(sa, "c")->intVal, -2);
+			Assert::AreEqual(GetValueOfVariable(sa, "d")->intVal, 0);
+		}
+
+		TEST_METHOD(OperandKeepsValueBeforeIncrement)
+		{
+			auto sa = RunSyntaxAnalyser(
+				R"(
+					int a = 1, b;
+					void main() { b = a + ++a; }
+				)"
+			);
+			Assert::AreEqual(GetValueOfVariable(sa, "a")->intVal, 2);
+			Assert::AreEqual(GetValueOfVariable(sa, "b")->intVal, 3);
+		}
+
+		TEST_METHOD(UnaryOperationsKeepLong)
+		{
+			auto sa = RunSyntaxAnalyser(
+				R"(
+					long c, d;
+					void main() { c = -4294967297L; d = +4294967297L; }
+				)"
+			);
+			Assert::AreEqual(GetValueOfVariable(sa, "c")->longVal, -4294967297LL);
+			Assert::AreEqual(GetValueOfVariable(sa, "d")->longVal, 4294967297LL);
+		}
+
 		TEST_METHOD(PassExprToFunc)
 		{
 			auto sa = RunSyntaxAnalyser(
@@ -414,5 +494,913 @@ namespace InterpretationTests
 			Assert::AreEqual(res10->intVal, 3628800);
 		}
 	};
-}
 
+	TEST_CLASS(Cache)
+	{
+		TEST_METHOD(CachedProgramGivesSameResult)
+		{
+			const auto src = R"(
+					int res = 0;
+					void add(int p) { for (int i = 0; i < p; ++i) ++res; }
+					void main() { add(3); add(4); })";
+			for (int run = 0; run < 2; run++)
+			{
+				auto sa = RunSyntaxAnalyser(src, "TestsProgramCache");
+				auto resVal = GetValueOfVariable(sa, "res");
+				Assert::AreEqual(resVal->intVal, 7);
+			}
+		}
+
+		TEST_METHOD(CachedProgramKeepsSemanticChecks)
+		{
+			const auto src = R"(
+					void foo(int a) {}
+					void main() { foo(1, 2); })";
+			for (int run = 0; run < 2; run++)
+				Assert::ExpectException<WrongArgsCountException>([src] {
+					RunSyntaxAnalyser(src, "TestsProgramCache"); });
+		}
+	};
+
+	TEST_CLASS(Daemon)
+	{
+		static bool Contains(const std::string& response, const std::string& part)
+		{
+			return response.find(part) != std::string::npos;
+		}
+
+		static std::string Open(AnalysisDaemon& daemon, const std::string& method, const std::string& text)
+		{
+			return daemon.HandleRequest("{\"id\":1,\"method\":\"" + method + "\",\"uri\":\"a\",\"text\":" + Json::Quote(text) + "}");
+		}
+
+		TEST_METHOD(RechecksOnlyChangedBodies)
+		{
+			AnalysisDaemon daemon;
+			const std::string add = "int res = 0; void add(int p) { res = res + p; }";
+			auto response = Open(daemon, "open", add + "void main() { add(3); add(4); }");
+			Assert::IsTrue(Contains(response, R"("ok":true,"diagnostics":[],"checkedBodies":2,"reusedBodies":0)"));
+			response = daemon.HandleRequest(R"({"id":2,"method":"check","uri":"a"})");
+			Assert::IsTrue(Contains(response, R"("diagnostics":[],"checkedBodies":2,"reusedBodies":0)"));
+
+			response = Open(daemon, "change", add + "void main() { add(5); }");
+			Assert::IsTrue(Contains(response, R"("diagnostics":[],"checkedBodies":1,"reusedBodies":1)"));
+			response = Open(daemon, "change", "int res = 0; void add(long p) { res = res + p; } void main() { add(5); }");
+			Assert::IsTrue(Contains(response, R"("checkedBodies":2,"reusedBodies":0)"));		// main calls the changed add
+			response = Open(daemon, "change", "long res = 0L; void add(long p) { res = res + p; } void main() { add(5); }");
+			Assert::IsTrue(Contains(response, R"("checkedBodies":1,"reusedBodies":1)"));
+		}
+
+		TEST_METHOD(ReportsDiagnostics)
+		{
+			AnalysisDaemon daemon;
+			auto response = Open(daemon, "open", "void main() { int x = y; }");
+			Assert::IsTrue(Contains(response, R"("ok":true,"diagnostics":[{"row":1,"column":24,"message":)"));
+			Assert::IsFalse(Contains(response, "checkedBodies"));				// It stopped partway
+
+			response = Open(daemon, "change", "void add(int p) { p = p + 1; } void main() { add(1); int x = y; }");
+			Assert::IsTrue(Contains(response, R"(],"reusedBodies":0,)"));
+			Assert::IsFalse(Contains(response, "checkedBodies"));
+			response = Open(daemon, "change", "void add(int p) { p = p + 1; } void main() { add(1); }");
+			Assert::IsTrue(Contains(response, R"("checkedBodies":1,"reusedBodies":1)"));
+		}
+
+		TEST_METHOD(RunsDocuments)
+		{
+			AnalysisDaemon daemon;
+			Open(daemon, "open", "int res = 0, unset; void add(int p) { res = res + p; } void main() { add(3); add(4); }");
+			const auto response = daemon.HandleRequest(R"({"id":2,"method":"run","uri":"a"})");
+			Assert::IsTrue(Contains(response, R"("globals":[{"id":"res","type":"Int","value":7},{"id":"unset","type":"Int","value":null}])"));
+		}
+
+		TEST_METHOD(ClosesDocuments)
+		{
+			AnalysisDaemon daemon;
+			Open(daemon, "open", "void main() {}");
+			Assert::IsTrue(Contains(daemon.HandleRequest(R"({"id":2,"method":"close","uri":"a"})"), R"({"id":2,"ok":true,)"));
+			for (const std::string method : { "check", "run", "close" })
+				Assert::IsTrue(Contains(daemon.HandleRequest(R"({"id":3,"method":")" + method + R"(","uri":"a"})"),
+					R"({"id":3,"ok":false,"error":"unknown document a",)"));
+		}
+
+		TEST_METHOD(RejectsMalformedRequests)
+		{
+			AnalysisDaemon daemon;
+			for (const std::string request : { "check", "{\"id\":1,", "{\"id\":[1]}", "[]", "{\"id\":1 \"method\":\"check\"}" })
+				Assert::AreEqual(0, daemon.HandleRequest(request).find(R"({"id":null,"ok":false,"error":"malformed request",)"));
+			Open(daemon, "open", "void main() {}");
+			Assert::IsTrue(Contains(daemon.HandleRequest(R"({"id":2,"method":"fly","uri":"a"})"),
+				R"({"id":2,"ok":false,"error":"unknown method fly",)"));
+			Assert::IsTrue(Contains(daemon.HandleRequest(R"({"id":3,"method":"fly"})"),
+				R"({"id":3,"ok":false,"error":"unknown method fly",)"));
+		}
+
+		TEST_METHOD(StopsAtShutdown)
+		{
+			AnalysisDaemon daemon;
+			std::stringstream in("\n" R"({"id":1,"method":"shutdown"})" "\n" R"({"id":2,"method":"check","uri":"a"})" "\n");
+			std::stringstream out;
+			daemon.Run(in, out);
+			Assert::IsTrue(daemon.IsShutdown());
+			std::string line;
+			Assert::IsTrue(static_cast<bool>(std::getline(out, line)));
+			Assert::IsTrue(Contains(line, R"({"id":1,"ok":true,)"));
+			Assert::IsFalse(static_cast<bool>(std::getline(out, line)));
+		}
+
+		TEST_METHOD(EchoesRequestIds)
+		{
+			AnalysisDaemon daemon;
+			for (const std::string id : { "\"abc\"", "\"4\\\"2\"", "42", "null" })
+			{
+				std::map<std::string, std::string> response, tokens;
+				Assert::IsTrue(Json::ParseObject(daemon.HandleRequest("{\"id\":" + id + ",\"method\":\"check\",\"uri\":\"a\"}"),
+					response, &tokens));
+				Assert::AreEqual(id, tokens["id"]);
+			}
+		}
+	};
+
+	TEST_CLASS(Snapshot)
+	{
+		static SyntaxAnalyser RunWithSnapshot(const std::string& src)
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetSnapshotPath("TestsSnapshot.lxs");
+			sa.Program();
+			return sa;
+		}
+
+		TEST_METHOD(ResumesProgramWithSameDeclarations)
+		{
+			std::remove("TestsSnapshot.lxs");
+			const std::string setup = R"(
+					int base = 6 * 7, counter;
+					long big = 5000000000L;
+					void add(int p) { counter = counter + p; })";
+
+			auto first = RunWithSnapshot(setup + "void main() { counter = 0; add(base); }");
+			Assert::IsFalse(first.IsSnapshotRestored());
+			Assert::AreEqual(GetValueOfVariable(first, "counter")->intVal, 42);
+
+			auto second = RunWithSnapshot(setup + "void main() { counter = 1; add(big / 1000000000L); }");
+			Assert::IsTrue(second.IsSnapshotRestored());
+			Assert::AreEqual(GetValueOfVariable(second, "counter")->intVal, 6);
+			Assert::AreEqual(GetValueOfVariable(second, "big")->longVal, 5000000000LL);
+
+			auto changed = RunWithSnapshot("int base = 1, counter; void main() { counter = base; }");
+			Assert::IsFalse(changed.IsSnapshotRestored());
+			Assert::AreEqual(GetValueOfVariable(changed, "counter")->intVal, 1);
+		}
+	};
+
+	TEST_CLASS(Bytecode)
+	{
+		static SyntaxAnalyser Run(const std::string& src, ExecutionEngine engine, InlineThresholds thresholds = {})
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(engine);
+			sa.SetInlineThresholds(thresholds);
+			sa.Program();
+			return sa;
+		}
+
+		template<class Exception>
+		static size_t GetErrorPosition(const std::string& src, ExecutionEngine engine)
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(engine);
+			try
+			{
+				sa.Program();
+			}
+			catch (const Exception&)
+			{
+				return sa.GetScanner()->GetCurPos();
+			}
+			Assert::Fail(L"Exception is not thrown");
+			return 0;
+		}
+
+		TEST_METHOD(SameResultsAsInterpreter)
+		{
+			const auto src = R"(
+					int res = 0, calls = 0, fact10;
+					long big = 3000000000L, sum = 0;
+					void fib(int n)
+					{
+						++calls;
+						res = res + (n < 2) * n;
+						for (int go = n >= 2; go; go = 0)
+						{
+							fib(n - 1);
+							fib(n - 2);
+						}
+					}
+					void fact(int n) { fact10 = 1; for (int i = 2; i <= n; ++i) fact10 = fact10 * i; }
+					void main()
+					{
+						int negated;
+						fib(15);
+						fact(10);
+						for (int i = 0; i < 100; ++i)
+							sum = sum + big / (i + 1) - ++i % 7;
+						negated = -calls;
+						calls = negated;
+					})";
+			auto interpreted = Run(src, ExecutionEngine::Interpreter);
+			Assert::IsNull(interpreted.GetBytecode());
+			for (const auto engine : { ExecutionEngine::Bytecode, ExecutionEngine::Jit, ExecutionEngine::Aot })
+			{
+				auto compiled = Run(src, engine);
+				Assert::IsNotNull(compiled.GetBytecode());
+				for (const auto id : { "res", "calls", "fact10" })
+					Assert::AreEqual(GetValueOfVariable(interpreted, id)->intVal, GetValueOfVariable(compiled, id)->intVal);
+				Assert::AreEqual(GetValueOfVariable(interpreted, "sum")->longVal, GetValueOfVariable(compiled, "sum")->longVal);
+				Assert::AreEqual(GetValueOfVariable(compiled, "res")->intVal, 610);
+			}
+		}
+
+		TEST_METHOD(RaisesErrorsOfInterpreter)
+		{
+			const std::string division = R"(
+					int res = 1;
+					void foo(int p) { res = res / p; }
+					void main() { foo(2); foo(0); })";
+			const std::string uninitialized = R"(
+					int res;
+					void main() { int a; for (int i = 0; i < 3; ++i) for (int last = i == 2; last; last = 0) res = a; })";
+			const std::string recursion = R"(
+					void foo(int p) { foo(p + 1); }
+					void main() { foo(0); })";
+			const std::string constantDivision = R"(
+					int zero = 0, res = 1;
+					void main() { res = 2; res = (1 + 2) / (zero * 5); })";
+			const std::string redeclaration = R"(
+					int g = 0;
+					void main() { for (int i = 0; i < 3; i = i + 1) int x = i; g = 5; })";
+			for (const auto engine : { ExecutionEngine::Bytecode, ExecutionEngine::Jit, ExecutionEngine::Aot })
+			{
+				Assert::AreEqual(GetErrorPosition<DivisionOnZeroException>(division, ExecutionEngine::Interpreter),
+					GetErrorPosition<DivisionOnZeroException>(division, engine));
+				Assert::AreEqual(GetErrorPosition<UsingUninitializedVariableException>(uninitialized, ExecutionEngine::Interpreter),
+					GetErrorPosition<UsingUninitializedVariableException>(uninitialized, engine));
+				Assert::AreEqual(GetErrorPosition<StackOverflowException>(recursion, ExecutionEngine::Interpreter),
+					GetErrorPosition<StackOverflowException>(recursion, engine));
+				Assert::AreEqual(GetErrorPosition<DivisionOnZeroException>(constantDivision, ExecutionEngine::Interpreter),
+					GetErrorPosition<DivisionOnZeroException>(constantDivision, engine));
+				Assert::AreEqual(GetErrorPosition<RedefinedIdentifierException>(redeclaration, ExecutionEngine::Interpreter),
+					GetErrorPosition<RedefinedIdentifierException>(redeclaration, engine));
+			}
+		}
+
+		TEST_METHOD(RunsDeclarationBodyOnce)
+		{
+			const auto src = R"(
+					int g = 0;
+					void main() { for (int i = 0; i < 1; i = i + 1) int x = i; g = 5; })";
+			for (const auto engine : { ExecutionEngine::Interpreter, ExecutionEngine::Bytecode, ExecutionEngine::Jit, ExecutionEngine::Aot })
+			{
+				auto sa = Run(src, engine);
+				Assert::AreEqual(GetValueOfVariable(sa, "g")->intVal, 5);
+			}
+		}
+
+		TEST_METHOD(DisassemblesFunctions)
+		{
+			auto sa = Run(R"(
+					int res = 0;
+					void add(int p) { res = res + p; }
+					void main() { add(40); add(2); })", ExecutionEngine::Bytecode, { 0, 0 });
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 42);
+
+			std::stringstream listing;
+			Disassemble(*sa.GetBytecode(), listing);
+			const auto text = listing.str();
+			Assert::IsTrue(text.find("main") != std::string::npos);
+			Assert::IsTrue(text.find("Call") != std::string::npos);
+			Assert::IsTrue(text.find("AddInt") != std::string::npos);
+		}
+
+		TEST_METHOD(FoldsConstants)
+		{
+			auto sa = Run(R"(
+					int loops = 10, res, big;
+					long wide = 3000000000L;
+					void main()
+					{
+						for (int i = 0; i < 2 * 2; ++i)
+							res = 10 * loops + (1 + 2) * 3 - -0;
+						big = wide * 2 + 1;
+						for (int never = 1 - 1; never; never = 0)
+							res = 0;
+					})", ExecutionEngine::Bytecode);
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 109);
+			Assert::AreEqual(GetValueOfVariable(sa, "big")->intVal, static_cast<int>(6000000001LL));
+
+			std::stringstream listing;
+			Disassemble(*sa.GetBytecode(), listing);
+			const auto text = listing.str();
+			Assert::IsTrue(text.find("Mul") == std::string::npos);
+			Assert::IsTrue(text.find("LoadGlobal") == std::string::npos);
+		}
+
+		TEST_METHOD(InlinesSmallFunctions)
+		{
+			const auto src = R"(
+					int res = 0, x = 5;
+					long wide = 0;
+					void twice(int x) { x = x * 2; res = res + x; }
+					void scale(long w, int x) { int i = x; wide = wide + w * i; twice(i); }
+					void big(int n) { int x; for (int i = 0; i < n; ++i) { x = i; res = res + x; } }
+					void main()
+					{
+						int i = 3;
+						for (int k = 0; k < 4; ++k)
+						{
+							twice(x);
+							scale(3000000000L, k + i);
+						}
+						big(x);
+						res = res + x * 1000 + i * 100000;
+					})";
+			auto interpreted = Run(src, ExecutionEngine::Interpreter);
+			auto inlined = Run(src, ExecutionEngine::Bytecode, { 12, 64 });
+			Assert::AreEqual(GetValueOfVariable(interpreted, "res")->intVal, GetValueOfVariable(inlined, "res")->intVal);
+			Assert::AreEqual(GetValueOfVariable(interpreted, "wide")->longVal, GetValueOfVariable(inlined, "wide")->longVal);
+
+			std::vector<std::string> calls;
+			for (const auto& call : inlined.GetInlinedCalls())
+				calls.push_back(call.Callee + " into " + call.Caller);
+			const std::vector<std::string> expected = { "twice into scale", "twice into main", "scale into main", "big into main" };
+			Assert::IsTrue(calls == expected);
+			Assert::AreEqual(inlined.GetBytecode()->Functions.size(), static_cast<size_t>(1));
+		}
+
+		TEST_METHOD(KeepsRecursiveAndDeepCalls)
+		{
+			auto sa = Run(R"(
+					int res = 0;
+					void leaf() { res = res + 1; }
+					void down(int n) { leaf(); for (int go = n > 0; go; go = 0) down(n - 1); }
+					void main() { down(3); })", ExecutionEngine::Bytecode);
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 4);
+			for (const auto& call : sa.GetInlinedCalls())
+				Assert::IsTrue(call.Callee != "down" && call.Caller != "down");
+
+			// The call of leaf is made in the second frame, so it overflows and stays a call
+			const auto chain = R"(
+					int res = 0;
+					void leaf() { res = res + 1; }
+					void middle() { leaf(); }
+					void main() { middle(); })";
+			size_t positions[2];
+			for (const auto engine : { ExecutionEngine::Interpreter, ExecutionEngine::Bytecode })
+			{
+				std::stringstream ss(chain);
+				SyntaxAnalyser shallow(ss);
+				shallow.SetExecutionEngine(engine);
+				shallow.SetMaxCallDepth(1);
+				Assert::ExpectException<StackOverflowException>([&] { shallow.Program(); });
+				positions[engine == ExecutionEngine::Bytecode] = shallow.GetScanner()->GetCurPos();
+				Assert::IsTrue(shallow.GetInlinedCalls().empty());
+			}
+			Assert::AreEqual(positions[0], positions[1]);
+		}
+	};
+
+	TEST_CLASS(Jit)
+	{
+		static std::vector<uint8_t> Encode(void (*emit)(X64::Assembler&))
+		{
+			X64::Assembler assembler;
+			emit(assembler);
+			return assembler.Finish();
+		}
+
+		TEST_METHOD(EncodesInstructions)
+		{
+			using namespace X64;
+			Assert::IsTrue(Encode([](Assembler& a) { a.Mov(RAX, Mem{ RBP, -8 }); })
+				== std::vector<uint8_t>{ 0x48, 0x8B, 0x45, 0xF8 });
+			Assert::IsTrue(Encode([](Assembler& a) { a.Mov(Mem{ R12, 16 }, RAX); })
+				== std::vector<uint8_t>{ 0x49, 0x89, 0x44, 0x24, 0x10 });
+			Assert::IsTrue(Encode([](Assembler& a) { a.Add(RAX, Mem{ RBP, -1024 }, false); })
+				== std::vector<uint8_t>{ 0x03, 0x85, 0x00, 0xFC, 0xFF, 0xFF });
+			Assert::IsTrue(Encode([](Assembler& a) { a.SignExtendAccumulator(); a.Idiv(RCX); })
+				== std::vector<uint8_t>{ 0x48, 0x99, 0x48, 0xF7, 0xF9 });
+			Assert::IsTrue(Encode([](Assembler& a) { auto l = a.NewLabel(); a.Bind(l); a.Jcc(Less, l); })
+				== std::vector<uint8_t>{ 0x0F, 0x8C, 0xFA, 0xFF, 0xFF, 0xFF });
+		}
+
+		TEST_METHOD(DeepRecursion)
+		{
+			std::stringstream ss(R"(
+					int res = 0;
+					void deep(int n) { res = n; for (int go = n < 499999; go; go = 0) deep(n + 1); }
+					void main() { deep(0); })");
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(ExecutionEngine::Jit);
+			sa.SetMaxCallDepth(500000);
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 499999);
+		}
+	};
+
+	TEST_CLASS(Aot)
+	{
+		TEST_METHOD(LoadsCachedLibrary)
+		{
+			std::stringstream ss(R"(
+					int res = 0;
+					long big = 0;
+					void add(int p) { res = res + p; big = big + 1000000000L * p; }
+					void main() { for (int i = 1; i <= 10; ++i) add(i); })");
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(ExecutionEngine::Aot);
+			sa.SetAotDirectory("TestsAot");
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 55);
+			Assert::AreEqual(GetValueOfVariable(sa, "big")->longVal, 55000000000LL);
+
+			AotMachine machine(*sa.GetBytecode(), SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH, 0);
+			if (!machine.Compile("TestsAot"))
+				return;											// No C compiler, the program ran on the virtual machine
+			Assert::IsTrue(machine.IsCached());
+			machine.SetGlobal(0, DataValue(100));
+			machine.SetGlobal(1, DataValue(0LL));
+			machine.Run();
+			Assert::AreEqual(machine.GetGlobal(0).intVal, 155);
+		}
+
+		TEST_METHOD(RebuildsLibraryOfOtherSource)
+		{
+			std::stringstream ss(R"(
+					int res = 0;
+					void main() { for (int i = 1; i <= 10; ++i) res = res * 3 + i; })");
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(ExecutionEngine::Bytecode);
+			sa.Program();
+
+			AotMachine machine(*sa.GetBytecode(), SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH, 0);
+			if (!machine.Compile("TestsAot"))
+				return;
+			{
+				std::ofstream out(machine.GetSourcePath(), std::ios::trunc);
+				out << "int other;";								// Same hash, other program
+			}
+			AotMachine rebuilt(*sa.GetBytecode(), SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH, 0);
+			Assert::IsTrue(rebuilt.Compile("TestsAot"));
+			Assert::IsFalse(rebuilt.IsCached());
+			rebuilt.Run();
+			Assert::AreEqual(rebuilt.GetGlobal(0).intVal, GetValueOfVariable(sa, "res")->intVal);
+		}
+
+#ifndef _WIN32
+		TEST_METHOD(RefusesSharedDirectory)
+		{
+			std::stringstream ss("int res = 0; void main() { res = 42; }");
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(ExecutionEngine::Aot);
+			mkdir("TestsAotShared", 0777);
+			chmod("TestsAotShared", 0777);
+			sa.SetAotDirectory("TestsAotShared");
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 42);		// Ran on the virtual machine
+
+			AotMachine machine(*sa.GetBytecode(), SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH, 0);
+			Assert::IsFalse(machine.Compile("TestsAotShared"));
+		}
+
+		TEST_METHOD(PassesPathsToCompilerAsTheyAre)
+		{
+			std::stringstream ss("int res = 0; void main() { res = 42; }");
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(ExecutionEngine::Bytecode);
+			sa.Program();
+
+			std::remove("TestsAotInjected");
+			AotMachine machine(*sa.GetBytecode(), SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH, 0);
+			const auto isCompiled = machine.Compile("TestsAot \" $(touch TestsAotInjected) `touch TestsAotInjected`");
+			Assert::IsFalse(std::ifstream("TestsAotInjected").good());
+			if (!isCompiled)
+				return;
+			machine.Run();
+			Assert::AreEqual(machine.GetGlobal(0).intVal, 42);
+		}
+#endif
+	};
+
+	TEST_CLASS(Osr)
+	{
+		static SyntaxAnalyser Run(const std::string& src, size_t osrThreshold)
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetOsrThreshold(osrThreshold);
+			sa.Program();
+			return sa;
+		}
+
+		TEST_METHOD(HotLoopKeepsLocals)
+		{
+			const auto src = R"(
+					int res = 0, calls = 0;
+					long sum = 0;
+					void count(int p) { calls = calls + p; }
+					void main()
+					{
+						int a, b = 7;
+						for (int i = 0; i < 500; ++i)
+						{
+							sum = sum + i * 3000000L;
+							count(1);
+							b = b * 3 % 1000;
+						}
+						a = b;
+						for (int i = 0; i < 50; ++i)
+							for (int j = 0; j < 50; ++j)
+								res = res + a % (j + 1);
+					})";
+			auto interpreted = Run(src, 0);
+			auto tiered = Run(src, 10);
+			Assert::AreEqual(interpreted.GetCompiledLoopsCount(), static_cast<size_t>(0));
+			Assert::IsTrue(tiered.GetCompiledLoopsCount() > 0);
+			for (const auto id : { "res", "calls" })
+				Assert::AreEqual(GetValueOfVariable(interpreted, id)->intVal, GetValueOfVariable(tiered, id)->intVal);
+			Assert::AreEqual(GetValueOfVariable(interpreted, "sum")->longVal, GetValueOfVariable(tiered, "sum")->longVal);
+		}
+
+		TEST_METHOD(HotLoopRaisesErrorsOfInterpreter)
+		{
+			const std::string src = R"(
+					int res = 0;
+					void main() { for (int i = 100; i > -5; i = i - 1) res = res + 1000 / i; })";
+			size_t positions[2] = {};
+			int results[2] = {};
+			for (const size_t threshold : { 0, 10 })
+			{
+				std::stringstream ss(src);
+				SyntaxAnalyser sa(ss);
+				sa.SetOsrThreshold(threshold);
+				try
+				{
+					sa.Program();
+					Assert::Fail(L"Exception is not thrown");
+				}
+				catch (const DivisionOnZeroException&)
+				{
+					positions[threshold != 0] = sa.GetScanner()->GetCurPos();
+					results[threshold != 0] = GetValueOfVariable(sa, "res")->intVal;
+				}
+			}
+			Assert::AreEqual(positions[0], positions[1]);
+			Assert::AreEqual(results[0], results[1]);
+		}
+	};
+
+	TEST_CLASS(LoopSummary)
+	{
+		static SyntaxAnalyser Run(const std::string& src, bool isSummarized)
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetOsrThreshold(0);
+			sa.SetLoopSummarization(isSummarized);
+			sa.Program();
+			return sa;
+		}
+
+		TEST_METHOD(CountingLoopsKeepWraparound)
+		{
+			const auto src = R"(
+					int k = 7, sum = 0, fib = 0, next = 1, tmp;
+					long wide = 0, big = 3000000000L;
+					void main()
+					{
+						for (int i = 0; i < 100000; i = i + 1)
+						{
+							sum = sum + i * k;
+							wide = wide + big * i - k;
+						}
+						for (long i = 90; i >= -10; i = i - 3)
+						{
+							tmp = next;
+							next = fib + next;
+							fib = tmp;
+						}
+						for (int j = 0; j != 12; ++j)
+							for (int i = 2147483000; i < 2147483640; i = i + 5)
+								sum = sum - -i + j;
+					})";
+			auto interpreted = Run(src, false);
+			auto summarized = Run(src, true);
+			Assert::AreEqual(interpreted.GetSummarizedLoopsCount(), static_cast<size_t>(0));
+			Assert::AreEqual(summarized.GetSummarizedLoopsCount(), static_cast<size_t>(14));
+			for (const auto id : { "sum", "fib", "next", "tmp" })
+				Assert::AreEqual(GetValueOfVariable(interpreted, id)->intVal, GetValueOfVariable(summarized, id)->intVal);
+			Assert::AreEqual(GetValueOfVariable(interpreted, "wide")->longVal, GetValueOfVariable(summarized, "wide")->longVal);
+		}
+
+		TEST_METHOD(OtherLoopsAreInterpreted)
+		{
+			const auto src = R"(
+					int res = 0, calls = 0;
+					void count() { calls = calls + 1; }
+					void main()
+					{
+						for (int i = 0; i < 10; ++i) count();
+						for (int i = 0; i < 10; ++i) res = res + i * i;
+						for (int i = 0; i < 10; ++i) res = res + (i < 5);
+						for (int i = 1; i < 100; i = i * 2) res = res + i;
+						for (int i = 0; i < 10; ++i) { int t = i; res = res + t; }
+					})";
+			auto sa = Run(src, true);
+			Assert::AreEqual(sa.GetSummarizedLoopsCount(), static_cast<size_t>(0));
+			Assert::AreEqual(GetValueOfVariable(sa, "calls")->intVal, 10);
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 285 + 5 + 127 + 45);
+		}
+	};
+
+	TEST_CLASS(CallElimination)
+	{
+		TEST_METHOD(AnalysesEffects)
+		{
+			std::stringstream ss(R"(
+					int res = 0, zero = 0, limit = 10;
+					void pure(int a) { int t = a; for (int i = 0; i < limit; ++i) t = t * 3 + i / 7; }
+					void reads(long a) { long t = a + res; for (long i = 10; i >= -30; i = i - 4) t = t % 5; }
+					void writes() { res = res + 1; }
+					void calls() { reads(1); writes(); }
+					void divides(int a) { a = a / zero; }
+					void forever() { for (int i = 0; i <= 2147483647; ++i) pure(i); }
+					void unproven() { for (int i = 0; i != 10; ++i) pure(i); }
+					void waits() { unproven(); }
+					void recursive(int n) { for (int go = n > 0; go; go = 0) recursive(n - 1); }
+					void main() { pure(1); reads(2); calls(); divides(3); forever(); waits(); recursive(4); })");
+			SyntaxAnalyser sa(ss);
+			sa.SetExecutionEngine(ExecutionEngine::Bytecode);
+			sa.SetInlineThresholds({ 0, 0 });
+			sa.SetCallElimination(false);
+			Assert::ExpectException<DivisionOnZeroException>([&] { sa.Program(); });
+
+			const auto& program = *sa.GetBytecode();
+			const auto effects = AnalyseEffects(program);
+			const auto of = [&](const std::string& id) -> const FunctionEffects&
+			{
+				for (size_t i = 0; i < program.Functions.size(); i++)
+					if (program.Functions[i].Id == id)
+						return effects[i];
+				throw std::runtime_error(id);
+			};
+			const auto global = [&](const std::string& id)
+			{
+				for (size_t i = 0; i < program.Globals.size(); i++)
+					if (program.Globals[i].Id == id)
+						return i;
+				throw std::runtime_error(id);
+			};
+
+			Assert::IsTrue(of("pure").IsEffectFree());
+			Assert::IsTrue(of("reads").IsEffectFree());
+			Assert::IsTrue(of("reads").ReadGlobals[global("res")]);
+			Assert::IsFalse(of("writes").IsEffectFree());
+			Assert::IsTrue(of("calls").WrittenGlobals[global("res")] && of("calls").ReadGlobals[global("res")]);
+			Assert::IsTrue(of("divides").MayFail);
+			Assert::IsTrue(of("forever").MayNotTerminate);
+			Assert::IsTrue(of("unproven").MayNotTerminate);
+			Assert::IsTrue(of("waits").MayNotTerminate);
+			Assert::IsTrue(of("recursive").MayNotTerminate);
+			Assert::IsFalse(of("main").IsEffectFree());
+		}
+
+		TEST_METHOD(SkipsEffectFreeCalls)
+		{
+			const auto src = R"(
+					int res = 0, zero = 0;
+					void pure(int a) { int t = a; for (int i = 0; i < 100; ++i) t = t * 3 + i / 7; }
+					void outer(int a) { pure(a); pure(a + 1); }
+					void counts() { res = res + 1; }
+					void divides(int a) { int t = a / zero; }
+					void main()
+					{
+						for (int k = 0; k < 20; ++k)
+						{
+							outer(k);
+							counts();
+						}
+						divides(res);
+					})";
+			size_t positions[2];
+			for (const auto isEliminated : { false, true })
+			{
+				std::stringstream ss(src);
+				SyntaxAnalyser sa(ss);
+				sa.SetOsrThreshold(0);
+				sa.SetCallElimination(isEliminated);
+				Assert::ExpectException<DivisionOnZeroException>([&] { sa.Program(); });
+				positions[isEliminated] = sa.GetScanner()->GetCurPos();
+				Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 20);
+				Assert::AreEqual(sa.GetSkippedCallsCount(), static_cast<size_t>(isEliminated ? 20 : 0));
+			}
+			Assert::AreEqual(positions[0], positions[1]);
+		}
+	};
+
+	TEST_CLASS(Memoization)
+	{
+		static SyntaxAnalyser Run(const std::string& src, size_t capacity, size_t maxCallDepth = SyntaxAnalyser::DEFAULT_MAX_CALL_DEPTH)
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetOsrThreshold(0);
+			sa.SetMaxCallDepth(maxCallDepth);
+			sa.SetMemoization(capacity);
+			return sa;
+		}
+
+		TEST_METHOD(ReplaysRecursiveCalls)
+		{
+			const auto src = R"(
+					int res;
+					void fib(int n)
+					{
+						res = n;
+						for (int go = n > 1; go; go = 0)
+						{
+							fib(n - 1);
+							int prev = res;
+							fib(n - 2);
+							res = res + prev;
+						}
+					}
+					void main() { fib(20); })";
+			for (const size_t capacity : { 0, 2, 1000 })
+			{
+				auto sa = Run(src, capacity);
+				sa.Program();
+				Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 6765);
+				if (capacity == 1000)
+				{
+					Assert::AreEqual(sa.GetMemoStats().Hits, static_cast<size_t>(18));
+					Assert::AreEqual(sa.GetMemoStats().Misses, static_cast<size_t>(21));
+				}
+			}
+		}
+
+		TEST_METHOD(ReplaysCallsBranchingWithLoops)
+		{
+			const auto src = R"(
+					int res = 0;
+					void fib(int n)
+					{
+						for (int k = 0; k < (n < 2); k = k + 1)
+							res = n;
+						for (int k = 0; k < (n >= 2); k = k + 1)
+						{
+							fib(n - 1);
+							int prev = res;
+							fib(n - 2);
+							res = res + prev;
+						}
+					}
+					void main() { fib(20); })";
+			auto sa = Run(src, 1000);
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 6765);
+			Assert::IsTrue(sa.GetSummarizedLoopsCount() > 0);
+			Assert::AreEqual(sa.GetMemoStats().Hits, static_cast<size_t>(18));
+			Assert::AreEqual(sa.GetMemoStats().Misses, static_cast<size_t>(21));
+		}
+
+		TEST_METHOD(KeepsReadsOfLoops)
+		{
+			const auto src = R"(
+					int total = 1, sum = 0;
+					void twice(int n) { for (int k = 0; k < n; k = k + 1) total = total + total; }
+					void mix(int n) { for (int k = 0; k < n; k = k + 1) sum = sum + k % 7; }
+					void main() { twice(3); twice(3); mix(100); mix(100); })";
+			auto sa = Run(src, 1000);
+			sa.SetOsrThreshold(10);
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "total")->intVal, 64);
+			Assert::AreEqual(GetValueOfVariable(sa, "sum")->intVal, 590);
+			Assert::IsTrue(sa.GetSummarizedLoopsCount() > 0);
+			Assert::IsTrue(sa.GetCompiledLoopsCount() > 0);
+			Assert::AreEqual(sa.GetMemoStats().Hits, static_cast<size_t>(0));
+		}
+
+		TEST_METHOD(ReplaysOnlyEqualCalls)
+		{
+			const auto src = R"(
+					int res = 0, total = 0, zero = 0;
+					void square(int a) { res = a * a; }
+					void add(int a) { total = total + a * 2; }
+					void main()
+					{
+						for (int k = 0; k < 10; ++k)
+						{
+							square(k % 3);
+							add(1);
+						}
+						total = total / zero;
+					})";
+			size_t positions[2];
+			for (const size_t capacity : { 0, 1000 })
+			{
+				auto sa = Run(src, capacity);
+				Assert::ExpectException<DivisionOnZeroException>([&] { sa.Program(); });
+				positions[capacity != 0] = sa.GetScanner()->GetCurPos();
+				Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 0);
+				Assert::AreEqual(GetValueOfVariable(sa, "total")->intVal, 20);
+				Assert::AreEqual(sa.GetMemoStats().Hits, static_cast<size_t>(capacity != 0 ? 7 : 0));
+			}
+			Assert::AreEqual(positions[0], positions[1]);
+		}
+
+		TEST_METHOD(KeepsStackOverflows)
+		{
+			const auto src = R"(
+					int res = 0;
+					void leaf(int a) { res = res + a; }
+					void mid(int a) { res = 0; leaf(a); }
+					void deep(int a) { mid(a); }
+					void main() { mid(1); deep(1); })";
+			for (size_t maxCallDepth = 1; maxCallDepth <= 4; maxCallDepth++)
+			{
+				auto plain = Run(src, 0, maxCallDepth), memoized = Run(src, 1000, maxCallDepth);
+				auto isOverflowed = false;
+				try { plain.Program(); }
+				catch (const StackOverflowException&) { isOverflowed = true; }
+				if (isOverflowed)
+					Assert::ExpectException<StackOverflowException>([&] { memoized.Program(); });
+				else
+				{
+					memoized.Program();
+					Assert::AreEqual(memoized.GetMemoStats().Hits, static_cast<size_t>(1));
+				}
+				Assert::AreEqual(plain.GetScanner()->GetCurPos(), memoized.GetScanner()->GetCurPos());
+				Assert::AreEqual(GetValueOfVariable(plain, "res")->intVal, GetValueOfVariable(memoized, "res")->intVal);
+			}
+		}
+	};
+
+	TEST_CLASS(ParallelLoops)
+	{
+		static SyntaxAnalyser Run(const std::string& src, size_t threadsCount)
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetThreadsCount(threadsCount);
+			sa.SetLoopSummarization(false);
+			sa.Program();
+			return sa;
+		}
+
+		TEST_METHOD(SplitsReductions)
+		{
+			const auto src = R"(
+					int sum = 0, prod = 1, count = 5, k = 7;
+					long wide = 1000;
+					void main()
+					{
+						for (long i = 0; i < 100000; i = i + 1)
+						{
+							int t = i * k;
+							sum = sum + t * t;
+							prod = prod * (2 * t + 1);
+							wide = wide - t * i;
+							++count;
+						}
+					})";
+			auto sequential = Run(src, 1), parallel = Run(src, 4);
+			Assert::AreEqual(sequential.GetParallelLoopsCount(), static_cast<size_t>(0));
+			Assert::AreEqual(parallel.GetParallelLoopsCount(), static_cast<size_t>(1));
+			for (const auto id : { "sum", "prod", "count" })
+				Assert::AreEqual(GetValueOfVariable(sequential, id)->intVal, GetValueOfVariable(parallel, id)->intVal);
+			Assert::AreEqual(GetValueOfVariable(sequential, "wide")->longVal, GetValueOfVariable(parallel, "wide")->longVal);
+			Assert::AreEqual(GetValueOfVariable(parallel, "count")->intVal, 100005);
+		}
+
+		TEST_METHOD(KeepsDependentLoops)
+		{
+			const auto src = R"(
+					int last = 0, sum = 0, copy = 0, x = 1, acc = 0, zero = 1;
+					void main()
+					{
+						for (int i = 0; i < 100000; ++i) last = i;
+						for (int i = 0; i < 100000; ++i) { sum = sum + i; copy = sum; }
+						for (int i = 0; i < 100000; ++i) x = x * 3 + i;
+						for (int i = 0; i < 100000; ++i) acc = acc + i / zero;
+					})";
+			auto sequential = Run(src, 1), parallel = Run(src, 4);
+			Assert::AreEqual(parallel.GetCompiledLoopsCount(), static_cast<size_t>(4));
+			Assert::AreEqual(parallel.GetParallelLoopsCount(), static_cast<size_t>(0));
+			for (const auto id : { "last", "sum", "copy", "x", "acc" })
+				Assert::AreEqual(GetValueOfVariable(sequential, id)->intVal, GetValueOfVariable(parallel, id)->intVal);
+		}
+	};
+}
@@ -109,6 +109,31 @@ namespace SemanticTests
 				void main(){ foo(1); }
 			)");
 		}
+
+		TEST_METHOD(CallerVariableNotVisible)
+		{
+			ExpectException<UndefinedIdentifierException>(R"(
+				void foo(){ a = 1; }
+				void main(){ int a; foo(); }
+			)");
+		}
+
+		TEST_METHOD(UndefinedVariableInNotCalledFunction)
+		{
+			ExpectException<UndefinedIdentifierException>(R"(
+				void foo(){ a = 1; }
+				void main(){}
+			)");
+		}
+
+		TEST_METHOD(LaterGlobalNotVisible)
+		{
+			ExpectException<UndefinedIdentifierException>(R"(
+				void foo(){ a = 1; }
+				int a;
+				void main(){ foo(); }
+			)");
+		}
 	};
 
 	TEST_CLASS(UncastableVariable)
@@ -189,6 +214,15 @@ namespace SemanticTests
 				void main(){ int a = 1 > foo(); }
 			)");
 		}
+
+		TEST_METHOD(InvalidOperandInNotCalledFunction)
+		{
+			ExpectException<InvalidOperandsException>(R"(
+				void foo(){}
+				void bar(){ int a = 1 - foo(); }
+				void main(){}
+			)");
+		}
 	};
 
 	TEST_CLASS(DivisionOnZero)
@@ -343,4 +377,100 @@ namespace SemanticTests
 			)");
 		}
 	};
+
+	TEST_CLASS(StackOverflow)
+	{
+		TEST_METHOD(EndlessRecursion)
+		{
+			ExpectException<StackOverflowException>(R"(
+				void foo(int n){ foo(n + 1); }
+				void main(){ foo(0); }
+			)");
+		}
+
+		TEST_METHOD(ConfiguredDepth)
+		{
+			const std::string src = R"(
+				int res = 0;
+				void foo(int n){ for (int loops = 1; n < 10 * loops; --loops) foo(n + 1); res = n; }
+				void main(){ foo(1); }
+			)";
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss);
+			sa.SetMaxCallDepth(10);
+			sa.Program();
+			Assert::AreEqual(GetValueOfVariable(sa, "res")->intVal, 1);
+
+			Assert::ExpectException<StackOverflowException>([&src] {
+				std::stringstream ss(src);
+				SyntaxAnalyser sa(ss);
+				sa.SetMaxCallDepth(9);
+				sa.Program();
+			});
+		}
+	};
+
+	TEST_CLASS(TreePrinting)
+	{
+		TEST_METHOD(TextAndJsonLines)
+		{
+			auto sa = RunSyntaxAnalyser(R"(
+				long a = 5L;
+				void foo(int p) { int x = p; }
+				void main() { int z = 3; foo(z); { int w; } }
+			)");
+
+			// The same text as the tree of nodes printed recursively
+			std::stringstream text;
+			sa.GetSemTree()->Print(text);
+			Assert::AreEqual(std::string("()\n"
+				"Variable Node: Type = Long, Id = a, Value = 5, Is Initialized = 1\n"
+				"Function Node: Id = foo, Param Count = 1\n"
+				"\t()\n"
+				"\tVariable Node: Type = Int, Id = p, Value = 0, Is Initialized = 1\n"
+				"Function Node: Id = main, Param Count = 0\n"
+				"\t()\n"
+				"\t()\n"), text.str());
+
+			std::stringstream json;
+			sa.GetSemTree()->Print(json, TreeFormat::JsonLines);
+			std::string line;
+			std::getline(json, line);
+			std::getline(json, line);
+			Assert::AreEqual(std::string(R"({"depth":0,"kind":"var","id":"a","type":"Long","value":5,"initialized":true})"), line);
+		}
+	};
+
+	TEST_CLASS(ErrorPosition)
+	{
+		// Errors are reported at the column right after the last scanned lexeme
+		static std::string GetReportedPosition(const std::string& src, const std::string& cacheDirectory = "")
+		{
+			std::stringstream ss(src);
+			SyntaxAnalyser sa(ss, cacheDirectory);
+			std::stringstream out;
+			const auto coutBuffer = std::cout.rdbuf(out.rdbuf());
+			sa.PrintAnalysis();
+			std::cout.rdbuf(coutBuffer);
+			const auto report = out.str();
+			return report.substr(0, report.find(':'));
+		}
+
+		TEST_METHOD(AfterUndefinedIdentifier)
+		{
+			Assert::AreEqual(std::string("(2, 25)"), GetReportedPosition("int a = 1;\nvoid main() { int x = bbb; }"));
+		}
+
+		TEST_METHOD(AfterZeroDivisor)
+		{
+			Assert::AreEqual(std::string("(2, 27)"), GetReportedPosition("int a = 1;\nvoid main() { int x = 4 / 0; }"));
+		}
+
+		TEST_METHOD(AtEndOfFile)
+		{
+			Assert::AreEqual(std::string("(2, 0)"), GetReportedPosition("void main() {\n"));
+			Assert::AreEqual(std::string("(2, 0)"), GetReportedPosition("void main() {\n", "TestsProgramCache"));
+			Assert::AreEqual(std::string("(1, 14)"), GetReportedPosition("void main() {"));
+		}
+	};
 }